@@ -11,6 +11,10 @@ using GP::Epsilon;
 
 // GPMap
 #include "util/data_types.hpp"	// MatrixPtr, VectorPtr
+#include "util/async_logger.hpp"	// GPMAP_LOG_RATE_LIMITED
+#include "util/memory_usage.hpp"	// heapMemoryUsage
+#include "util/arena.hpp"				// Arena, ArenaScope
+#include "io/binary_io.hpp"			// writeBinary, readBinary
 
 namespace GPMap {
 
@@ -71,12 +75,121 @@ public:
 		return fIsIndependent;
 	}
 
+	/** @brief Memory usage in bytes including the object itself */
+	size_t memoryUsage() const
+	{
+		return sizeof(*this) + heapMemoryUsage();
+	}
+
+	/** @brief Clear the state to the uninitialized one */
+	void clearState()
+	{
+		m_pSumOfWeightedMeans.reset();
+		m_pSumOfInvCovs.reset();
+	}
+
+	/** @brief Heap bytes of the state, not including the object itself */
+	size_t heapMemoryUsage() const
+	{
+		return GPMap::heapMemoryUsage(m_pSumOfWeightedMeans) + GPMap::heapMemoryUsage(m_pSumOfInvCovs);
+	}
+
+	/** @brief		Write the state in a raw binary format
+	  * @details	It has the initialization flag followed by the sum of weighted means and the sum of inverse [co]variances.
+	  */
+	bool writeState(std::ostream &os) const
+	{
+		const unsigned char fInitialized = isInitialized() ? 1 : 0;
+		writeBinary(os, fInitialized);
+		if(fInitialized)
+		{
+			writeMatrixBinary(os, *m_pSumOfWeightedMeans);
+			writeMatrixBinary(os, *m_pSumOfInvCovs);
+		}
+		return os.good();
+	}
+
+	/** @brief Read the state written by writeState() */
+	bool readState(std::istream &is)
+	{
+		unsigned char fInitialized;
+		if(!readBinary(is, fInitialized)) return false;
+		if(!fInitialized)
+		{
+			m_pSumOfWeightedMeans.reset();
+			m_pSumOfInvCovs.reset();
+			return true;
+		}
+		return readMatrixBinary(is, m_pSumOfWeightedMeans) && readMatrixBinary(is, m_pSumOfInvCovs) && isInitialized();
+	}
+
+	/** @brief		Merge another BCM built from a disjoint set of observations
+	  * @details	Since each update adds the inverse [co]variance and the weighted mean of an expert
+	  *				and subtracts the prior inverse [co]variance, the sums of two BCMs are just added
+	  *				with one prior inverse [co]variance subtracted. The result is the same as
+	  *				updating a single BCM with all the experts of both, so merging is associative.
+	  */
+	void merge(const BCM &other)
+	{
+		// nothing to merge
+		if(!other.isInitialized()) return;
+
+		// copy
+		if(!isInitialized())
+		{
+			m_pSumOfWeightedMeans.reset(new Vector(*other.m_pSumOfWeightedMeans));
+			m_pSumOfInvCovs.reset(new Matrix(*other.m_pSumOfInvCovs));
+			return;
+		}
+
+		// check size
+		assert(m_pSumOfWeightedMeans->size() == other.m_pSumOfWeightedMeans->size());
+		assert(m_pSumOfInvCovs->rows() == other.m_pSumOfInvCovs->rows() &&
+				 m_pSumOfInvCovs->cols() == other.m_pSumOfInvCovs->cols());
+
+		// add up
+		(*m_pSumOfWeightedMeans)	+= (*other.m_pSumOfWeightedMeans);
+		(*m_pSumOfInvCovs)			+= (*other.m_pSumOfInvCovs);
+
+		// prior counted twice
+		if(m_fInvCov0) (*m_pSumOfInvCovs) -= (*m_pInvCov0);
+	}
+
 	/** @brief Reset the prior inverse covariance matrix */
 	static void resetPrior()
 	{
 		assert(m_fInvCov0);
 		m_fInvCov0 = 0;
 		m_pInvCov0.reset();
+		m_pCov0.reset();
+	}
+
+	/** @brief		Number of jittered Cholesky refactorizations since the last reset
+	  * @details	It is shared by all BCM leaf types, so the cost of each block can be measured by its difference.
+	  */
+	static size_t numCholeskyRetries()
+	{
+		return m_numCholeskyRetries;
+	}
+
+	/** @brief Reset the number of Cholesky retries */
+	static void resetCholeskyRetries()
+	{
+		m_numCholeskyRetries = 0;
+	}
+
+	/** @brief Count Cholesky retries of leaf types with their own factorization */
+	static void addCholeskyRetries(const size_t numRetries)
+	{
+		m_numCholeskyRetries += numRetries;
+	}
+
+	/** @brief		Get the prior covariance matrix or variance vector
+	  * @return		NULL if the prior is not set
+	  */
+	static MatrixConstPtr getPriorCov()
+	{
+		return m_pCov0;
 	}
 
 	/** @brief Set the prior inverse covariance matrix */
@@ -87,6 +200,7 @@ public:
 
 		// memory allocation
 		m_pInvCov0.reset(new Matrix(pCov->rows(), pCov->cols()));
+		m_pCov0 = pCov;
 
 		// variance vector
 		if(pCov->cols() == 1)
@@ -118,10 +232,10 @@ public:
 				factor = powf(10.f, static_cast<float>(num_iters)) * Epsilon<float>::value;
 				L.compute(*pCov + factor * Matrix::Identity(pCov->rows(), pCov->cols()));
 			}
+			m_numCholeskyRetries += static_cast<size_t>(num_iters + 1);
 			if(num_iters > 0)
 			{
-				LogFile logFile;
-				logFile << "BCM::Set::Iter: " << num_iters << "(" << factor << ")" << std::endl;
+				GPMAP_LOG_RATE_LIMITED(LOG_WARNING, 10, "BCM::Set::Iter: " << num_iters << "(" << factor << ")");
 			}
 //			if(L.info() != Eigen::/*ComputationInfo::*/Success)
 //			{
@@ -209,10 +323,10 @@ public:
 				factor = powf(10.f, static_cast<float>(num_iters)) * Epsilon<float>::value;
 				L.compute(*m_pSumOfInvCovs + factor * Matrix::Identity(m_pSumOfInvCovs->rows(), m_pSumOfInvCovs->cols()));
 			}
+			m_numCholeskyRetries += static_cast<size_t>(num_iters + 1);
 			if(num_iters > 0)
 			{
-				LogFile logFile;
-				logFile << "BCM::Get::Iter: " << num_iters << "(" << factor << ")" << std::endl;
+				GPMAP_LOG_RATE_LIMITED(LOG_WARNING, 10, "BCM::Get::Iter: " << num_iters << "(" << factor << ")");
 			}
 //			if(L.info() != Eigen::/*ComputationInfo::*/Success)
 //			{
@@ -277,8 +391,8 @@ public:
 
 			// set zero
 			m_pSumOfWeightedMeans->setZero();
-			//m_pSumOfInvCovs->setZero();
-			(*m_pSumOfInvCovs) = (*m_pInvCov0);
+			if(m_fInvCov0)	(*m_pSumOfInvCovs) = (*m_pInvCov0);
+			else				m_pSumOfInvCovs->setZero();
 		}
 		else
 		{
@@ -288,9 +402,11 @@ public:
 					 pCov->cols() == m_pSumOfInvCovs->cols());
 		}
 
-		// temporary variables
-		Vector weightedMean(pMean->size());				// weighted mean
-		Matrix invCov(pCov->rows(), pCov->cols());	// inverted cov
+		// temporary variables in the arena of the thread, released at the end of the update
+		Arena &arena = Arena::threadLocal();
+		ArenaScope scope(arena);
+		Eigen::Map<Vector> weightedMean(arena.allocate<float>(pMean->size()), pMean->size());										// weighted mean
+		Eigen::Map<Matrix> invCov(arena.allocate<float>(pCov->rows()*pCov->cols()), pCov->rows(), pCov->cols());	// inverted cov
 
 		// variance vector
 		if(isIndependent())
@@ -323,10 +439,10 @@ public:
 				factor = powf(10.f, static_cast<float>(num_iters)) * Epsilon<float>::value;
 				L.compute(*pCov + factor * Matrix::Identity(pCov->rows(), pCov->cols()));
 			}
+			m_numCholeskyRetries += static_cast<size_t>(num_iters + 1);
 			if(num_iters > 0)
 			{
-				LogFile logFile;
-				logFile << "BCM::Update::Iter: " << num_iters << "(" << factor << ")" << std::endl;
+				GPMAP_LOG_RATE_LIMITED(LOG_WARNING, 10, "BCM::Update::Iter: " << num_iters << "(" << factor << ")");
 			}
 //			if(L.info() != Eigen::/*ComputationInfo::*/Success)
 //			{
@@ -390,12 +506,20 @@ protected:
 	MatrixPtr m_pSumOfInvCovs;
 
 	/** @brief Prior inverse covariance matrices */
-	static MatrixPtr	m_pInvCov0;
-	static bool			m_fInvCov0;
+	static MatrixPtr			m_pInvCov0;
+	static bool					m_fInvCov0;
+
+	/** @brief Prior covariance matrix for leaf types with a different precision */
+	static MatrixConstPtr	m_pCov0;
+
+	/** @brief Number of jittered Cholesky refactorizations */
+	static size_t				m_numCholeskyRetries;
 };
 
-MatrixPtr	BCM::m_pInvCov0;
-bool			BCM::m_fInvCov0 = false;
+MatrixPtr		BCM::m_pInvCov0;
+bool				BCM::m_fInvCov0 = false;
+MatrixConstPtr	BCM::m_pCov0;
+size_t			BCM::m_numCholeskyRetries = 0;
 
 }
 
@@ -0,0 +1,387 @@
+#ifndef _BAYESIAN_COMMITTEE_MACHINE_MIXED_PRECISION_HPP_
+#define _BAYESIAN_COMMITTEE_MACHINE_MIXED_PRECISION_HPP_
+
+// STL
+#include <cmath>
+#include <limits>			// std::numeric_limits<T>::epsilon()
+#include <algorithm>		// std::max()
+
+// Boost
+#include <boost/shared_ptr.hpp>
+
+// Eigen
+#include <Eigen/Dense>
+
+// GP
+#include "GP.h"						// LogFile, Epsilon, Exception
+using GP::LogFile;
+using GP::Epsilon;
+
+// GPMap
+#include "util/data_types.hpp"	// MatrixPtr, VectorPtr
+#include "bcm/bcm.hpp"				// BCM::getPriorCov, BCM::addCholeskyRetries
+#include "util/async_logger.hpp"	// GPMAP_LOG_RATE_LIMITED
+#include "util/memory_usage.hpp"	// heapMemoryUsage
+#include "io/binary_io.hpp"			// writeBinary, readBinary
+
+namespace GPMap {
+
+/** @brief		Bayesian Committee Machine with double precision accumulation
+  * @details	GP predictions are computed in single precision as usual,
+  *				but their inversion and the sums of the inverse covariances and weighted means are in double precision.
+  *				Since the double precision Cholesky decomposition rarely fails,
+  *				only one retry with a jitter scaled by the average diagonal is tried
+  *				instead of refactorizing with growing jitters.
+  *				It has the same interface as BCM, so it can be used as OctreeGPMapContainer<BCM_MixedPrecision>.
+  */
+class BCM_MixedPrecision
+{
+public:
+	/** @brief Double precision types */
+	typedef Eigen::Matrix<double, Eigen::Dynamic, 1>					VectorD;
+	typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>	MatrixD;
+	typedef boost::shared_ptr<VectorD>										VectorDPtr;
+	typedef boost::shared_ptr<MatrixD>										MatrixDPtr;
+	typedef Eigen::LLT<MatrixD>												CholeskyFactorD;
+
+public:
+	/** @brief Comparison Operator */
+	inline bool operator==(const BCM_MixedPrecision &other) const
+	{
+		// memory check
+		if(!isInitialized() || !other.isInitialized()) return false;
+
+		// size check
+		if(D() != other.D() ||
+			isIndependent() != other.isIndependent()) return false;
+
+		// compare data only
+		return (m_pSumOfWeightedMeans->isApprox(*(other.m_pSumOfWeightedMeans)) &&
+						  m_pSumOfInvCovs->isApprox(*(other.m_pSumOfInvCovs)));
+	}
+
+	/** @brief Comparison Operator */
+	inline bool operator!=(const BCM_MixedPrecision &other) const
+	{
+		return !((*this) == other);
+	}
+
+	/** @brief Initialization check */
+	inline bool isInitialized() const
+	{
+		return (m_pSumOfWeightedMeans		&&		// memory for mean
+				  m_pSumOfInvCovs				&&		// memory for cov
+				  m_pSumOfWeightedMeans->size() == m_pSumOfInvCovs->rows()); // dimension
+	}
+
+	/** @brief Get the number of dimensions */
+	inline size_t D() const
+	{
+		// memory check
+		assert(isInitialized());
+
+		return m_pSumOfWeightedMeans->size();
+	}
+
+	/** @brief Check independent BCM */
+	inline size_t isIndependent() const
+	{
+		// memory check
+		assert(isInitialized());
+
+		// flag
+		const bool fIsIndependent = (m_pSumOfInvCovs->cols() == 1);
+
+		// if dependent, the cov should be square
+		if(!fIsIndependent)	assert(m_pSumOfInvCovs->rows() == m_pSumOfInvCovs->cols());
+
+		return fIsIndependent;
+	}
+
+	/** @brief Memory usage in bytes including the object itself */
+	size_t memoryUsage() const
+	{
+		return sizeof(*this) + heapMemoryUsage();
+	}
+
+	/** @brief Clear the state to the uninitialized one */
+	void clearState()
+	{
+		m_pSumOfWeightedMeans.reset();
+		m_pSumOfInvCovs.reset();
+	}
+
+	/** @brief Heap bytes of the state, not including the object itself */
+	size_t heapMemoryUsage() const
+	{
+		return GPMap::heapMemoryUsage(m_pSumOfWeightedMeans) + GPMap::heapMemoryUsage(m_pSumOfInvCovs);
+	}
+
+	/** @brief		Write the state in a raw binary format
+	  * @details	It has the initialization flag followed by the sums in double precision.
+	  */
+	bool writeState(std::ostream &os) const
+	{
+		const unsigned char fInitialized = isInitialized() ? 1 : 0;
+		writeBinary(os, fInitialized);
+		if(fInitialized)
+		{
+			writeMatrixBinary(os, *m_pSumOfWeightedMeans);
+			writeMatrixBinary(os, *m_pSumOfInvCovs);
+		}
+		return os.good();
+	}
+
+	/** @brief Read the state written by writeState() */
+	bool readState(std::istream &is)
+	{
+		unsigned char fInitialized;
+		if(!readBinary(is, fInitialized)) return false;
+		if(!fInitialized)
+		{
+			m_pSumOfWeightedMeans.reset();
+			m_pSumOfInvCovs.reset();
+			return true;
+		}
+		return readMatrixBinary(is, m_pSumOfWeightedMeans) && readMatrixBinary(is, m_pSumOfInvCovs) && isInitialized();
+	}
+
+	/** @brief		Merge another BCM built from a disjoint set of observations
+	  * @details	The sums are added with one prior inverse [co]variance subtracted as in BCM::merge().
+	  */
+	void merge(const BCM_MixedPrecision &other)
+	{
+		// nothing to merge
+		if(!other.isInitialized()) return;
+
+		// copy
+		if(!isInitialized())
+		{
+			m_pSumOfWeightedMeans.reset(new VectorD(*other.m_pSumOfWeightedMeans));
+			m_pSumOfInvCovs.reset(new MatrixD(*other.m_pSumOfInvCovs));
+			return;
+		}
+
+		// check size
+		assert(m_pSumOfWeightedMeans->size() == other.m_pSumOfWeightedMeans->size());
+		assert(m_pSumOfInvCovs->rows() == other.m_pSumOfInvCovs->rows() &&
+				 m_pSumOfInvCovs->cols() == other.m_pSumOfInvCovs->cols());
+
+		// add up
+		(*m_pSumOfWeightedMeans)	+= (*other.m_pSumOfWeightedMeans);
+		(*m_pSumOfInvCovs)			+= (*other.m_pSumOfInvCovs);
+
+		// prior counted twice
+		const MatrixD *pInvCov0 = getPriorInvCov();
+		if(pInvCov0) (*m_pSumOfInvCovs) -= (*pInvCov0);
+	}
+
+	/** @brief Get means and variances */
+	bool get(VectorPtr &pMean, MatrixPtr &pVar) const
+	{
+		// memory check
+		if(!isInitialized()) return false;
+
+		// memory allocation
+		if(!pMean || pMean->size() != m_pSumOfWeightedMeans->size())
+			pMean.reset(new Vector(m_pSumOfWeightedMeans->size()));
+
+		if(!pVar  || pVar->rows()  != m_pSumOfInvCovs->rows()
+					 || pVar->cols()  != 1)
+			pVar.reset(new Matrix(m_pSumOfInvCovs->rows(), 1));
+
+		// variance vector
+		if(isIndependent())
+		{
+			// variance
+			VectorD var(m_pSumOfInvCovs->rows());
+			invertVariances(m_pSumOfInvCovs->col(0), var);
+
+			// mean
+			(*pVar)	= var.cast<float>();
+			(*pMean)	= var.cwiseProduct(*m_pSumOfWeightedMeans).cast<float>();
+		}
+
+		// covariance matrix
+		else
+		{
+			// cholesky factor of the covariance matrix
+			CholeskyFactorD L;
+			factorize(*m_pSumOfInvCovs, L, "BCM_MixedPrecision::Get", "BCM_MixedPrecision::Get::NumericalIssue");
+
+			// Sigma
+			const size_t dim = m_pSumOfInvCovs->rows();
+			(*pVar)	= L.solve(MatrixD::Identity(dim, dim)).diagonal().cast<float>();	// (LL')*inv(Cov) = I
+
+			// mean
+			(*pMean)	= L.solve(*m_pSumOfWeightedMeans).cast<float>();							// (LL')*x = mean
+		}
+
+		return true;
+	}
+
+	/** @brief Update the mean and [co]variance */
+	void update(const VectorConstPtr &pMean, const MatrixConstPtr &pCov)
+	{
+		// memory check
+		assert(pMean && pMean->size() > 0 &&
+				 pCov  && pCov->rows()  > 0 &&
+							 pCov->cols()  > 0 &&
+				 pMean->size() == pCov->rows() &&
+				 (pCov->cols() == 1 || pCov->rows() == pCov->cols()));
+
+		// prior
+		const MatrixD *pInvCov0 = getPriorInvCov();
+
+		// initialization
+		if(!isInitialized())
+		{
+			// memory allocation
+			m_pSumOfWeightedMeans.reset(new VectorD(pMean->size()));
+			m_pSumOfInvCovs.reset(new MatrixD(pCov->rows(), pCov->cols()));
+
+			// set zero
+			m_pSumOfWeightedMeans->setZero();
+			if(pInvCov0)	(*m_pSumOfInvCovs) = (*pInvCov0);
+			else				m_pSumOfInvCovs->setZero();
+		}
+		else
+		{
+			// check size
+			assert(pMean->size() == m_pSumOfWeightedMeans->size());
+			assert(pCov->rows() == m_pSumOfInvCovs->rows() &&
+					 pCov->cols() == m_pSumOfInvCovs->cols());
+		}
+
+		// variance vector
+		if(isIndependent())
+		{
+			// inv(Sigma)
+			VectorD invVar(pCov->rows());
+			invertVariances(pCov->col(0).cast<double>(), invVar);
+
+			// add up
+			m_pSumOfInvCovs->col(0)		+= invVar;
+			(*m_pSumOfWeightedMeans)	+= invVar.cwiseProduct(pMean->cast<double>());
+		}
+
+		// covariance matrix
+		else
+		{
+			// cholesky factor of the covariance matrix
+			CholeskyFactorD L;
+			factorize(pCov->cast<double>(), L, "BCM_MixedPrecision::Update", "BCM_MixedPrecision::Update::NumericalIssue");
+
+			// add up
+			const size_t dim = D();
+			(*m_pSumOfInvCovs)			+= L.solve(MatrixD::Identity(dim, dim));	// (LL')*inv(Cov) = I
+			(*m_pSumOfWeightedMeans)	+= L.solve(pMean->cast<double>());			// (LL')x = b
+		}
+
+		// zero variance
+		if(pInvCov0) (*m_pSumOfInvCovs) -= (*pInvCov0);
+	}
+
+protected:
+	/** @brief		Cholesky decomposition with a single retry
+	  * @details	If it fails, a jitter scaled by the average diagonal is added only once.
+	  * @throw		GP::Exception if it still fails
+	  */
+	static void factorize(const MatrixD &A, CholeskyFactorD &L, const char *tag, const char *errorMessage)
+	{
+		// first trial
+		L.compute(A);
+		if(L.info() == Eigen::Success) return;
+
+		// single retry with a jitter
+		const double scale	= std::max<double>(1.0, A.diagonal().cwiseAbs().mean());
+		const double jitter	= JITTER_ * scale;
+		L.compute(A + jitter * MatrixD::Identity(A.rows(), A.cols()));
+		BCM::addCholeskyRetries(1);
+
+		// log
+		GPMAP_LOG_RATE_LIMITED(LOG_WARNING, 10, tag << "::Retry: " << jitter);
+
+		// fail
+		if(L.info() != Eigen::Success)
+		{
+			GP::Exception e;
+			e = errorMessage;
+			throw e;
+		}
+	}
+
+	/** @brief Invert a variance vector in a stable way */
+	template <typename Derived>
+	static void invertVariances(const Eigen::MatrixBase<Derived> &var, VectorD &invVar)
+	{
+		const double eps		= static_cast<double>(Epsilon<float>::value);
+		const double inv_eps	= 1.0 / eps;
+		for(int row = 0; row < var.rows(); row++)
+		{
+			invVar(row) = var(row) < eps ? inv_eps : 1.0 / var(row);
+		}
+	}
+
+	/** @brief		Prior inverse covariance matrix in double precision
+	  * @details	It is inverted from BCM::getPriorCov() only when the prior changes.
+	  * @return		NULL if the prior is not set
+	  */
+	static const MatrixD* getPriorInvCov()
+	{
+		// prior
+		MatrixConstPtr pCov0 = BCM::getPriorCov();
+		if(!pCov0)
+		{
+			m_pCov0Source.reset();
+			m_pInvCov0.reset();
+			return 0;
+		}
+
+		// cached
+		if(m_pInvCov0 && m_pCov0Source == pCov0) return m_pInvCov0.get();
+
+		// variance vector
+		m_pInvCov0.reset(new MatrixD(pCov0->rows(), pCov0->cols()));
+		if(pCov0->cols() == 1)
+		{
+			VectorD invVar(pCov0->rows());
+			invertVariances(pCov0->col(0).cast<double>(), invVar);
+			m_pInvCov0->col(0) = invVar;
+		}
+
+		// covariance matrix
+		else
+		{
+			CholeskyFactorD L;
+			factorize(pCov0->cast<double>(), L, "BCM_MixedPrecision::Set", "BCM_MixedPrecision::Set::NumericalIssue");
+			(*m_pInvCov0) = L.solve(MatrixD::Identity(pCov0->rows(), pCov0->cols()));	// (LL')*inv(Cov) = I
+		}
+		m_pCov0Source = pCov0;
+
+		return m_pInvCov0.get();
+	}
+
+protected:
+	/** @brief	Sum of weighted means with its inverse covariance matrix in double precision */
+	VectorDPtr m_pSumOfWeightedMeans;
+
+	/** @brief Sum of inverse covariance matrices in double precision */
+	MatrixDPtr m_pSumOfInvCovs;
+
+	/** @brief Prior inverse covariance matrix in double precision and its source in single precision */
+	static MatrixDPtr			m_pInvCov0;
+	static MatrixConstPtr	m_pCov0Source;
+
+	/** @brief Relative jitter for the single retry of the Cholesky decomposition */
+	static const double		JITTER_;
+};
+
+BCM_MixedPrecision::MatrixDPtr	BCM_MixedPrecision::m_pInvCov0;
+MatrixConstPtr						BCM_MixedPrecision::m_pCov0Source;
+const double						BCM_MixedPrecision::JITTER_ = 1e-6;	// round-off of single precision inputs
+
+}
+
+
+#endif
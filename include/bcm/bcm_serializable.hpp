@@ -64,6 +64,53 @@ public:
 		dump();
 	}
 
+	/** @brief Write the state in a raw binary format */
+	bool writeState(std::ostream &os)
+	{
+		// load if necessary
+		load();
+
+		// write
+		const bool ret = BCM::writeState(os);
+
+		// dump
+		dump();
+
+		return ret;
+	}
+
+	/** @brief Read the state written by writeState() */
+	bool readState(std::istream &is)
+	{
+		// discard the dumped data
+		load();
+
+		// read
+		const bool ret = BCM::readState(is);
+
+		// dump
+		dump();
+
+		return ret;
+	}
+
+	/** @brief		Merge another BCM built from a disjoint set of observations
+	  * @details	The other one is not const since its data may have been dumped.
+	  */
+	void merge(BCM_Serializable &other)
+	{
+		// load if necessary
+		load();
+		other.load();
+
+		// merge
+		BCM::merge(other);
+
+		// dump
+		dump();
+		other.dump();
+	}
+
 	///** @brief Comparison Operator */
 	//inline bool operator==(BCM_Serializable &other)
 	//{
@@ -87,6 +134,27 @@ public:
 	//	return !((*this) == other);
 	//}
 
+	/** @brief Clear the state to the uninitialized one and remove the dumped file */
+	void clearState()
+	{
+		if(m_fDumped && boost::filesystem::exists(mem2str()))
+			boost::filesystem::remove(mem2str());
+		m_fDumped = false;
+		BCM::clearState();
+	}
+
+	/** @brief Memory usage in bytes including the object itself */
+	size_t memoryUsage() const
+	{
+		return sizeof(*this) + heapMemoryUsage();
+	}
+
+	/** @brief Heap bytes of the state, which are none while it is dumped to a file */
+	size_t heapMemoryUsage() const
+	{
+		return m_fDumped ? 0 : BCM::heapMemoryUsage();
+	}
+
 protected:
 	/** @brief Convert the unique memory address to string */
 	inline std::string mem2str() const
@@ -11,6 +11,8 @@ using GP::Epsilon;
 
 // GPMap
 #include "util/data_types.hpp"	// MatrixPtr, VectorPtr
+#include "util/memory_usage.hpp"	// heapMemoryUsage
+#include "io/binary_io.hpp"			// writeBinary, readBinary
 
 namespace GPMap {
 
@@ -71,6 +73,54 @@ public:
 		return fIsIndependent;
 	}
 
+	/** @brief Memory usage in bytes including the object itself */
+	size_t memoryUsage() const
+	{
+		return sizeof(*this) + heapMemoryUsage();
+	}
+
+	/** @brief Clear the state to the uninitialized one */
+	void clearState()
+	{
+		m_pMean.reset();
+		m_pCov.reset();
+	}
+
+	/** @brief Heap bytes of the state, not including the object itself */
+	size_t heapMemoryUsage() const
+	{
+		return GPMap::heapMemoryUsage(m_pMean) + GPMap::heapMemoryUsage(m_pCov);
+	}
+
+	/** @brief		Write the state in a raw binary format
+	  * @details	It has the initialization flag followed by the mean vector and the [co]variance.
+	  */
+	bool writeState(std::ostream &os) const
+	{
+		const unsigned char fInitialized = isInitialized() ? 1 : 0;
+		writeBinary(os, fInitialized);
+		if(fInitialized)
+		{
+			writeMatrixBinary(os, *m_pMean);
+			writeMatrixBinary(os, *m_pCov);
+		}
+		return os.good();
+	}
+
+	/** @brief Read the state written by writeState() */
+	bool readState(std::istream &is)
+	{
+		unsigned char fInitialized;
+		if(!readBinary(is, fInitialized)) return false;
+		if(!fInitialized)
+		{
+			m_pMean.reset();
+			m_pCov.reset();
+			return true;
+		}
+		return readMatrixBinary(is, m_pMean) && readMatrixBinary(is, m_pCov) && isInitialized();
+	}
+
 	/** @brief Get means and variances */
 	bool get(VectorPtr &pMean, MatrixPtr &pVar) const
 	{
@@ -0,0 +1,207 @@
+#ifndef _GPMAP_BENCHMARK_REPORT_HPP_
+#define _GPMAP_BENCHMARK_REPORT_HPP_
+
+// STL
+#include <string>
+#include <vector>
+#include <utility>		// std::pair
+#include <sstream>		// std::stringstream
+#include <algorithm>		// std::find
+#include <fstream>
+#include <iomanip>		// std::setprecision
+#include <limits>			// std::numeric_limits<T>::digits10
+
+// GPMap
+#include "util/timer.hpp"		// CPU_Times
+
+namespace GPMap {
+
+/** @brief		Named metrics of a benchmark */
+class BenchmarkRecord
+{
+public:
+	typedef std::pair<std::string, double>	Metric;
+	typedef std::vector<Metric>				MetricList;
+
+public:
+	/** @brief Constructor */
+	explicit BenchmarkRecord(const std::string &strName = std::string())
+		: m_strName(strName)
+	{
+	}
+
+	/** @brief Constructor with the elapsed times of a stage and the number of processed items */
+	BenchmarkRecord(const std::string &strName, const CPU_Times &elapsed, const size_t numItems)
+		: m_strName(strName)
+	{
+		add("wall_sec",	elapsed.wall_clock_time());
+		add("user_sec",	elapsed.user_cpu_time());
+		add("system_sec",	elapsed.system_cpu_time());
+		add("items",		static_cast<double>(numItems));
+		add("items_per_sec", elapsed.wall_clock_time() > 0.f ? static_cast<double>(numItems) / elapsed.wall_clock_time() : 0.0);
+	}
+
+	/** @brief Add a metric */
+	BenchmarkRecord& add(const std::string &strMetric, const double value)
+	{
+		m_metrics.push_back(Metric(strMetric, value));
+		return *this;
+	}
+
+	/** @brief Name */
+	const std::string& name() const		{ return m_strName; }
+
+	/** @brief Metrics */
+	const MetricList& metrics() const	{ return m_metrics; }
+
+	/** @brief		Value of a metric
+	  * @return		False if there is no such metric
+	  */
+	bool get(const std::string &strMetric, double &value) const
+	{
+		for(size_t i = 0; i < m_metrics.size(); i++)
+		{
+			if(m_metrics[i].first != strMetric) continue;
+			value = m_metrics[i].second;
+			return true;
+		}
+		return false;
+	}
+
+protected:
+	/** @brief Name */
+	std::string		m_strName;
+
+	/** @brief Metrics in the insertion order */
+	MetricList		m_metrics;
+};
+
+/** @brief		Machine-readable benchmark results
+  * @details	The records are saved as a CSV file whose columns are the union of the metrics in the first-seen order,
+  *				or as a JSON file with the parameters of the run.
+  */
+class BenchmarkReport
+{
+public:
+	/** @brief Add a parameter of the run */
+	void setParameter(const std::string &strName, const std::string &strValue)
+	{
+		for(size_t i = 0; i < m_parameters.size(); i++)
+		{
+			if(m_parameters[i].first != strName) continue;
+			m_parameters[i].second = strValue;
+			return;
+		}
+		m_parameters.push_back(std::make_pair(strName, strValue));
+	}
+
+	/** @brief Add a parameter of the run */
+	template <typename T>
+	void setParameter(const std::string &strName, const T &value)
+	{
+		std::stringstream ss;
+		ss << value;
+		setParameter(strName, ss.str());
+	}
+
+	/** @brief Add a record */
+	void add(const BenchmarkRecord &record)
+	{
+		m_records.push_back(record);
+	}
+
+	/** @brief Records */
+	const std::vector<BenchmarkRecord>& records() const
+	{
+		return m_records;
+	}
+
+	/** @brief Save as a CSV file */
+	bool saveAsCSV(const std::string &strFilePath) const
+	{
+		std::ofstream fout(strFilePath.c_str());
+		if(!fout) return false;
+		fout << std::setprecision(std::numeric_limits<double>::digits10);
+
+		// columns
+		std::vector<std::string> columns;
+		for(size_t i = 0; i < m_records.size(); i++)
+		{
+			const BenchmarkRecord::MetricList &metrics = m_records[i].metrics();
+			for(size_t j = 0; j < metrics.size(); j++)
+				if(std::find(columns.begin(), columns.end(), metrics[j].first) == columns.end()) columns.push_back(metrics[j].first);
+		}
+
+		// header
+		fout << "name";
+		for(size_t j = 0; j < columns.size(); j++) fout << "," << columns[j];
+		fout << std::endl;
+
+		// rows
+		double value;
+		for(size_t i = 0; i < m_records.size(); i++)
+		{
+			fout << m_records[i].name();
+			for(size_t j = 0; j < columns.size(); j++)
+			{
+				fout << ",";
+				if(m_records[i].get(columns[j], value)) fout << value;
+			}
+			fout << std::endl;
+		}
+
+		return true;
+	}
+
+	/** @brief Save as a JSON file */
+	bool saveAsJSON(const std::string &strFilePath) const
+	{
+		std::ofstream fout(strFilePath.c_str());
+		if(!fout) return false;
+		fout << std::setprecision(std::numeric_limits<double>::digits10);
+
+		// parameters
+		fout << "{" << std::endl << "\t\"parameters\": {";
+		for(size_t i = 0; i < m_parameters.size(); i++)
+			fout << (i > 0 ? "," : "") << std::endl << "\t\t\"" << escape(m_parameters[i].first) << "\": \"" << escape(m_parameters[i].second) << "\"";
+		fout << std::endl << "\t}," << std::endl;
+
+		// records
+		fout << "\t\"records\": [";
+		for(size_t i = 0; i < m_records.size(); i++)
+		{
+			fout << (i > 0 ? "," : "") << std::endl << "\t\t{\"name\": \"" << escape(m_records[i].name()) << "\"";
+			const BenchmarkRecord::MetricList &metrics = m_records[i].metrics();
+			for(size_t j = 0; j < metrics.size(); j++)
+				fout << ", \"" << escape(metrics[j].first) << "\": " << metrics[j].second;
+			fout << "}";
+		}
+		fout << std::endl << "\t]" << std::endl << "}" << std::endl;
+
+		return true;
+	}
+
+protected:
+	/** @brief Escape a JSON string */
+	static std::string escape(const std::string &str)
+	{
+		std::string escaped;
+		for(size_t i = 0; i < str.size(); i++)
+		{
+			if(str[i] == '"' || str[i] == '\\') escaped += '\\';
+			escaped += str[i];
+		}
+		return escaped;
+	}
+
+protected:
+	/** @brief Parameters of the run */
+	std::vector<std::pair<std::string, std::string> >	m_parameters;
+
+	/** @brief Records */
+	std::vector<BenchmarkRecord>								m_records;
+};
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef _GPMAP_MICRO_BENCHMARK_HPP_
+#define _GPMAP_MICRO_BENCHMARK_HPP_
+
+// STL
+#include <string>
+#include <cstddef>		// size_t
+
+// Boost
+#include <boost/chrono.hpp>		// boost::chrono::high_resolution_clock
+
+// GPMap
+#include "benchmark/benchmark_report.hpp"	// BenchmarkRecord
+
+namespace GPMap {
+
+/** @brief		Counter of heap allocations
+  * @details	The counter is incremented by the allocation hook of a benchmark executable.
+  *				Without a hook, allocations per operation are reported as zero.
+  *				Eigen allocates the coefficients of dynamic matrices with its own aligned malloc, not new,
+  *				so the hook should wrap malloc (glibc) or be a CRT allocation hook (MSVC debug)
+  *				to count the matrix buffers. A replaced global operator new misses them.
+  */
+class AllocationCounter
+{
+public:
+	/** @brief Count an allocation */
+	static inline void allocate(const size_t numBytes)
+	{
+		m_numAllocations++;
+		m_numAllocatedBytes += numBytes;
+	}
+
+	/** @brief Reset the counter */
+	static inline void reset()
+	{
+		m_numAllocations		= 0;
+		m_numAllocatedBytes	= 0;
+	}
+
+	/** @brief Number of allocations since the last reset */
+	static inline size_t numAllocations()		{ return m_numAllocations; }
+
+	/** @brief Number of allocated bytes since the last reset */
+	static inline size_t numAllocatedBytes()	{ return m_numAllocatedBytes; }
+
+protected:
+	static size_t m_numAllocations;
+	static size_t m_numAllocatedBytes;
+};
+
+size_t AllocationCounter::m_numAllocations		= 0;
+size_t AllocationCounter::m_numAllocatedBytes	= 0;
+
+/** @brief		Run a micro-benchmark
+  * @details	The operation is a functor with
+  *				- void operator()()			one call, which may consist of several operations
+  *				- size_t numOps() const		number of operations per call
+  *				- size_t numBytes() const	estimated bytes read and written per operation
+  *				It is called once to warm up caches and lazily allocated memory,
+  *				then it is timed over numCalls calls.
+  * @return		ns/op, allocations/op, allocated bytes/op, bytes touched/op and the bandwidth
+  */
+template <typename Operation>
+BenchmarkRecord microBenchmark(const std::string &strName, Operation &op, const size_t numCalls)
+{
+	typedef boost::chrono::high_resolution_clock Clock;
+
+	// warm up
+	op();
+
+	// run
+	AllocationCounter::reset();
+	const Clock::time_point start = Clock::now();
+	for(size_t i = 0; i < numCalls; i++) op();
+	const Clock::time_point end = Clock::now();
+	const size_t numAllocations		= AllocationCounter::numAllocations();
+	const size_t numAllocatedBytes	= AllocationCounter::numAllocatedBytes();
+
+	// per operation
+	const double numOps		= static_cast<double>(numCalls) * static_cast<double>(op.numOps());
+	const double ns			= static_cast<double>(boost::chrono::duration_cast<boost::chrono::nanoseconds>(end - start).count());
+	const double nsPerOp		= numOps > 0.0 ? ns / numOps : 0.0;
+
+	BenchmarkRecord record(strName);
+	record.add("ops",						numOps);
+	record.add("ns_per_op",				nsPerOp);
+	record.add("allocs_per_op",		numOps > 0.0 ? static_cast<double>(numAllocations)		/ numOps : 0.0);
+	record.add("alloc_bytes_per_op",	numOps > 0.0 ? static_cast<double>(numAllocatedBytes)	/ numOps : 0.0);
+	record.add("bytes_per_op",			static_cast<double>(op.numBytes()));
+	record.add("gb_per_sec",			nsPerOp > 0.0 ? static_cast<double>(op.numBytes()) / nsPerOp : 0.0);	// bytes/ns = GB/s
+	return record;
+}
+
+}
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef _GPMAP_SYNTHETIC_SCENE_HPP_
+#define _GPMAP_SYNTHETIC_SCENE_HPP_
+
+// STL
+#include <cmath>			// sqrt, cos, sin, log, fabs
+#include <vector>
+#include <limits>			// std::numeric_limits<T>::max()
+#include <algorithm>		// std::min, std::max
+
+// Eigen
+#include <Eigen/Dense>
+
+// PCL
+#include <pcl/point_types.h>		// pcl::PointXYZ
+#include <pcl/point_cloud.h>		// pcl::PointCloud
+
+// GPMap
+#include "util/data_types.hpp"	// PointXYZCloud, PointXYZCloudPtr, PointXYZVList
+#include "util/random.hpp"			// RandomGenerator
+
+namespace GPMap {
+
+/** @brief		Scene of analytic signed distance functions for synthetic scans
+  * @details	The scene is the union of spheres, planes and boxes.
+  *				Scans are simulated by sphere tracing rays from sensor positions,
+  *				so the density and the noise of the observations can be controlled.
+  */
+class SyntheticScene
+{
+public:
+	/** @brief Shape types */
+	enum ShapeType
+	{
+		SPHERE,	// center, radius
+		PLANE,	// point, unit normal
+		BOX		// center, half extents
+	};
+
+	/** @brief Shape */
+	struct Shape
+	{
+		ShapeType			type;
+		Eigen::Vector3f	center;
+		Eigen::Vector3f	param;
+	};
+	typedef std::vector<Shape> ShapeList;
+
+public:
+	/** @brief Add a sphere */
+	void addSphere(const Eigen::Vector3f &center, const float radius)
+	{
+		Shape shape;
+		shape.type		= SPHERE;
+		shape.center	= center;
+		shape.param		= Eigen::Vector3f(radius, 0.f, 0.f);
+		m_shapes.push_back(shape);
+	}
+
+	/** @brief Add a plane */
+	void addPlane(const Eigen::Vector3f &point, const Eigen::Vector3f &normal)
+	{
+		Shape shape;
+		shape.type		= PLANE;
+		shape.center	= point;
+		shape.param		= normal.normalized();
+		m_shapes.push_back(shape);
+	}
+
+	/** @brief Add a box */
+	void addBox(const Eigen::Vector3f &center, const Eigen::Vector3f &halfExtents)
+	{
+		Shape shape;
+		shape.type		= BOX;
+		shape.center	= center;
+		shape.param		= halfExtents;
+		m_shapes.push_back(shape);
+	}
+
+	/** @brief		Default scene in a unit cube
+	  * @details	A ground plane, a sphere and a box
+	  */
+	static SyntheticScene defaultScene()
+	{
+		SyntheticScene scene;
+		scene.addPlane	(Eigen::Vector3f(0.f, 0.f, 0.f),		Eigen::Vector3f(0.f, 0.f, 1.f));
+		scene.addSphere(Eigen::Vector3f(-0.2f, 0.f, 0.25f),	0.25f);
+		scene.addBox	(Eigen::Vector3f(0.25f, 0.1f, 0.15f),	Eigen::Vector3f(0.15f, 0.2f, 0.15f));
+		return scene;
+	}
+
+	/** @brief Number of shapes */
+	size_t size() const
+	{
+		return m_shapes.size();
+	}
+
+	/** @brief Signed distance at a point (positive outside) */
+	float sdf(const Eigen::Vector3f &p) const
+	{
+		float d = std::numeric_limits<float>::max();
+		for(size_t i = 0; i < m_shapes.size(); i++)
+			d = std::min<float>(d, sdf(m_shapes[i], p));
+		return d;
+	}
+
+	/** @brief		Cast a ray by sphere tracing
+	  * @return		Distance to the hit point, or a negative value if the ray does not hit within the max range
+	  */
+	float castRay(const Eigen::Vector3f &origin, const Eigen::Vector3f &direction, const float maxRange) const
+	{
+		const float	EPSILON	= 1e-5f;
+		const int	MAX_STEPS	= 256;
+		float t(0.f);
+		for(int step = 0; step < MAX_STEPS && t < maxRange; step++)
+		{
+			const float d = sdf(origin + t * direction);
+			if(d < EPSILON) return t;
+			t += d;
+		}
+		return -1.f;
+	}
+
+	/** @brief Sensor positions on a circle around a target looking at it */
+	static void circularSensorPositions(const size_t				numScans,
+													const Eigen::Vector3f	&target,
+													const float					radius,
+													const float					height,
+													PointXYZVList				&sensorPositionList)
+	{
+		sensorPositionList.resize(numScans);
+		for(size_t i = 0; i < numScans; i++)
+		{
+			const float angle = 2.f * static_cast<float>(M_PI) * static_cast<float>(i) / static_cast<float>(numScans);
+			sensorPositionList[i] = pcl::PointXYZ(target.x() + radius * cos(angle),
+															  target.y() + radius * sin(angle),
+															  target.z() + height);
+		}
+	}
+
+	/** @brief		Simulate a scan
+	  * @details	Rays are cast on a regular grid of yaw and pitch angles around the direction to the target.
+	  *				Gaussian noise with the standard deviation is added to the range of each hit.
+	  * @return		Number of hit points
+	  */
+	size_t scan(const pcl::PointXYZ		&sensorPosition,
+					const Eigen::Vector3f	&target,
+					const size_t				numRaysPerAxis,
+					const float					fov,				// field of view in radian
+					const float					noiseStd,
+					const float					maxRange,
+					RandomGenerator			&rng,
+					PointXYZCloud				&hitPointCloud) const
+	{
+		// sensor frame
+		const Eigen::Vector3f origin(sensorPosition.x, sensorPosition.y, sensorPosition.z);
+		const Eigen::Vector3f forward	= (target - origin).normalized();
+		Eigen::Vector3f up(0.f, 0.f, 1.f);
+		if(fabs(forward.dot(up)) > 0.99f) up = Eigen::Vector3f(0.f, 1.f, 0.f);
+		const Eigen::Vector3f right	= forward.cross(up).normalized();
+		up = right.cross(forward);
+
+		// rays
+		hitPointCloud.points.clear();
+		hitPointCloud.points.reserve(numRaysPerAxis * numRaysPerAxis);
+		const float step = numRaysPerAxis > 1 ? fov / static_cast<float>(numRaysPerAxis - 1) : 0.f;
+		for(size_t i = 0; i < numRaysPerAxis; i++)
+		{
+			const float yaw = -0.5f * fov + step * static_cast<float>(i);
+			for(size_t j = 0; j < numRaysPerAxis; j++)
+			{
+				const float pitch = -0.5f * fov + step * static_cast<float>(j);
+				const Eigen::Vector3f direction = (forward + tan(yaw) * right + tan(pitch) * up).normalized();
+
+				// hit
+				const float range = castRay(origin, direction, maxRange);
+				if(range < 0.f) continue;
+
+				// noise
+				const Eigen::Vector3f hitPoint = origin + (range + noiseStd * gaussian(rng)) * direction;
+				hitPointCloud.points.push_back(pcl::PointXYZ(hitPoint.x(), hitPoint.y(), hitPoint.z()));
+			}
+		}
+		hitPointCloud.width		= static_cast<uint32_t>(hitPointCloud.points.size());
+		hitPointCloud.height		= 1;
+		hitPointCloud.is_dense	= true;
+
+		return hitPointCloud.points.size();
+	}
+
+protected:
+	/** @brief Signed distance of a shape */
+	static float sdf(const Shape &shape, const Eigen::Vector3f &p)
+	{
+		switch(shape.type)
+		{
+			case SPHERE:	return (p - shape.center).norm() - shape.param.x();
+			case PLANE:		return (p - shape.center).dot(shape.param);
+			case BOX:
+			{
+				const Eigen::Vector3f q = (p - shape.center).cwiseAbs() - shape.param;
+				return q.cwiseMax(Eigen::Vector3f::Zero()).norm() + std::min<float>(q.maxCoeff(), 0.f);
+			}
+		}
+		return std::numeric_limits<float>::max();
+	}
+
+	/** @brief Standard normal random number by the Box-Muller transform */
+	static float gaussian(RandomGenerator &rng)
+	{
+		const double u1 = std::max<double>(rng.uniform01(), std::numeric_limits<double>::min());
+		const double u2 = rng.uniform01();
+		return static_cast<float>(sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2));
+	}
+
+protected:
+	/** @brief Shapes */
+	ShapeList	m_shapes;
+};
+
+}
+
+#endif
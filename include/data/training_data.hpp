@@ -11,9 +11,13 @@
 
 namespace GPMap {
 
-/** @brief	Count the number of finite points */
-void numFinitePoints(const pcl::PointCloud<pcl::PointNormal>	&pointNormalCloud,
-							const Indices										&indices,
+/** @brief		Count the number of finite points in an index range
+  * @details	The point normal cloud can be a pcl::PointCloud<pcl::PointNormal> or a PointNormalPCDView.
+  */
+template <typename PointNormalCloudT, typename IndexIterator>
+void numFinitePoints(const PointNormalCloudT							&pointNormalCloud,
+							IndexIterator										first,
+							IndexIterator										last,
 							size_t												&Nf,	// number of function observation
 							size_t												&Nd)	// number of derivative observation
 {
@@ -21,7 +25,7 @@ void numFinitePoints(const pcl::PointCloud<pcl::PointNormal>	&pointNormalCloud,
 	Nf = 0;
 	Nd = 0;
 
-	for(Indices::const_iterator iter = indices.begin(); iter != indices.end(); ++iter)
+	for(IndexIterator iter = first; iter != last; ++iter)
 	{
 		// index
 		assert(*iter >= 0 && *iter < static_cast<int>(pointNormalCloud.points.size()));
@@ -38,18 +42,31 @@ void numFinitePoints(const pcl::PointCloud<pcl::PointNormal>	&pointNormalCloud,
 	}
 }
 
+/** @brief	Count the number of finite points */
+void numFinitePoints(const pcl::PointCloud<pcl::PointNormal>	&pointNormalCloud,
+							const Indices										&indices,
+							size_t												&Nf,	// number of function observation
+							size_t												&Nd)	// number of derivative observation
+{
+	numFinitePoints(pointNormalCloud, indices.begin(), indices.end(), Nf, Nd);
+}
+
 /** @brief	Generate training data from a surface normal cloud
   * @param[in] pPointNormalCloud		Function/derivative/all observations in pcl::PointCloud<pcl::PointNormal>
   *											Note that function observations are alse represented as point normals.
   *											Their x/y/z are hit points.
   *											Their normal_x/y/z are unit ray back vectors from hit points to sensor positions.
   *											Their curvature = -1, which can be used to check whether it is a function observation or a derivative one.
+  * @param[in] first, last			Index range, which can be a partition in a shared index buffer
+  * @details	The point normal cloud can be a pcl::PointCloud<pcl::PointNormal> or a PointNormalPCDView.
   * @Todo	Optimization or using getMatrixXfMap()
   */
-void generateTrainingData(const PointNormalCloudConstPtr		&pPointNormalCloud,
-								  const Indices							&indices,
-								  const float								gap,
-								  MatrixPtr &pX, MatrixPtr &pXd, VectorPtr &pYYd)
+template <typename PointNormalCloudT, typename IndexIterator>
+void generateTrainingDataFromCloud(const PointNormalCloudT		&pointNormalCloud,
+											  IndexIterator						first,
+											  IndexIterator						last,
+											  const float							gap,
+											  MatrixPtr &pX, MatrixPtr &pXd, VectorPtr &pYYd)
 {
 	// K: NN by NN, NN = N + Nd*D
 	// 
@@ -69,23 +86,27 @@ void generateTrainingData(const PointNormalCloudConstPtr		&pPointNormalCloud,
 	const size_t D = 3;	// number of dimensions
 	size_t Nf;				// number of function observations
 	size_t Nd;				// number of derivative observation
-	numFinitePoints(*pPointNormalCloud, indices, Nf, Nd);
+	numFinitePoints(pointNormalCloud, first, last, Nf, Nd);
 	const size_t N = 2*Nf + Nd;	// hit/empty points from function observations and virtual hit points from derivative observations
 
 	// memory allocation
-	pX.reset(new Matrix(N, 3));			// hit/empty points from function observations and virtual hit points from derivative observations
-	pXd.reset(new Matrix(Nd, 3));			// surface normals from derivative observations
-	pYYd.reset(new Vector(N + Nd*D));	// all
+	// buffers which are not shared with others are reused
+	if(pX   && pX.unique())		pX->resize(N, 3);
+	else								pX.reset(new Matrix(N, 3));			// hit/empty points from function observations and virtual hit points from derivative observations
+	if(pXd  && pXd.unique())	pXd->resize(Nd, 3);
+	else								pXd.reset(new Matrix(Nd, 3));			// surface normals from derivative observations
+	if(pYYd && pYYd.unique())	pYYd->resize(N + Nd*D);
+	else								pYYd.reset(new Vector(N + Nd*D));	// all
 		
 	// assignment
 	int i = 0;
-	for(Indices::const_iterator iter = indices.begin(); iter != indices.end(); ++iter)
+	for(IndexIterator iter = first; iter != last; ++iter)
 	{
 		// index
-		assert(*iter >= 0 && *iter < static_cast<int>(pPointNormalCloud->points.size()));
+		assert(*iter >= 0 && *iter < static_cast<int>(pointNormalCloud.points.size()));
 
 		// point normal
-		const pcl::PointNormal &pointNormal(pPointNormalCloud->points[*iter]);
+		const pcl::PointNormal &pointNormal(pointNormalCloud.points[*iter]);
 
 		// check finite
 		if(!pcl::isFinite<pcl::PointNormal>(pointNormal)) continue;
@@ -130,6 +151,26 @@ void generateTrainingData(const PointNormalCloudConstPtr		&pPointNormalCloud,
 	}
 }
 
+/** @brief	Generate training data from a surface normal cloud in an index range */
+template <typename IndexIterator>
+inline void generateTrainingData(const PointNormalCloudConstPtr		&pPointNormalCloud,
+											IndexIterator							first,
+											IndexIterator							last,
+											const float								gap,
+											MatrixPtr &pX, MatrixPtr &pXd, VectorPtr &pYYd)
+{
+	generateTrainingDataFromCloud(*pPointNormalCloud, first, last, gap, pX, pXd, pYYd);
+}
+
+/** @brief	Generate training data from a surface normal cloud */
+void generateTrainingData(const PointNormalCloudConstPtr		&pPointNormalCloud,
+								  const Indices							&indices,
+								  const float								gap,
+								  MatrixPtr &pX, MatrixPtr &pXd, VectorPtr &pYYd)
+{
+	generateTrainingData(pPointNormalCloud, indices.begin(), indices.end(), gap, pX, pXd, pYYd);
+}
+
 
 }
 
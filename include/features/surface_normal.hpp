@@ -5,6 +5,7 @@
 #include <limits>		// std::numeric_limits<T>::epsilon()
 #include <cmath>
 #include <vector>
+#include <algorithm>		// std::min
 
 // PCL
 #include <pcl/point_types.h>					// pcl::PointXYZ, pcl::Normal, pcl::PointNormal
@@ -79,55 +80,57 @@ inline bool normalizeNormalVector(NormalT &normal)
 	return false;
 }
 
+/** @brief		Normalize the normal vectors and remove the non-finite ones
+  * @details	The finite normals are compacted in place without a temporary cloud.
+  */
 template <typename NormalT>
 void normalizeNormalVectorCloud(typename pcl::PointCloud<NormalT>::Ptr &pNormalVectorCloud)
 {
 	if(!pNormalVectorCloud) return;
 
-	// new normal vector cloud
-	pcl::PointCloud<NormalT>::Ptr pTempNormalVectorCloud(new pcl::PointCloud<NormalT>());
-	pTempNormalVectorCloud->points.resize(pNormalVectorCloud->points.size());
-
 	// for each normal vector
 	size_t j = 0;
 	for(size_t i = 0; i < pNormalVectorCloud->points.size(); i++)
 	{
 		if(normalizeNormalVector(pNormalVectorCloud->points[i]))
 		{
-			pTempNormalVectorCloud->points[j++] = pNormalVectorCloud->points[i];
+			if(j != i) pNormalVectorCloud->points[j] = pNormalVectorCloud->points[i];
+			j++;
 		}
 	}
 
 	// Resize to the correct size
 	if (j != pNormalVectorCloud->points.size())
 	{
-		pTempNormalVectorCloud->points.resize(j);
+		pNormalVectorCloud->points.resize(j);
 	}
 
-	pTempNormalVectorCloud->height = 1;
-	pTempNormalVectorCloud->width  = static_cast<uint32_t>(j);
-
-	// swap
-	pNormalVectorCloud = pTempNormalVectorCloud;
+	pNormalVectorCloud->height = 1;
+	pNormalVectorCloud->width  = static_cast<uint32_t>(j);
 }
 
+/** @brief Number of points in a batch of the point-wise kernels */
+const int KERNEL_BATCH_SIZE_ = 256;
+
 // check if n is consistently oriented towards the viewpoint and flip otherwise
 // angle between Psensor - Phit and Normal should be less than 90 degrees
 // dot(Psensor - Phit, Normal) > 0
+// the sign is multiplied without a branch, and the points are processed in parallel
 void flipSurfaceNormals(const pcl::PointXYZ							&sensorPosition,
 								pcl::PointCloud<pcl::PointNormal>		&pointNormals)
 {
-	pcl::PointCloud<pcl::PointNormal>::iterator iter;
-	for(iter	= pointNormals.begin(); iter != pointNormals.end(); iter++)
+	const int N = static_cast<int>(pointNormals.points.size());
+	#pragma omp parallel for schedule(static)
+	for(int i = 0; i < N; i++)
 	{
-		if((sensorPosition.x - iter->x) * iter->normal_x + 
-		   (sensorPosition.y - iter->y) * iter->normal_y + 
-		   (sensorPosition.z - iter->z) * iter->normal_z < 0)
-		{
-			iter->normal_x *= -1.f;
-			iter->normal_y *= -1.f;
-			iter->normal_z *= -1.f;
-		}
+		pcl::PointNormal &pointNormal = pointNormals.points[i];
+		const float dot = (sensorPosition.x - pointNormal.x) * pointNormal.normal_x + 
+								(sensorPosition.y - pointNormal.y) * pointNormal.normal_y + 
+								(sensorPosition.z - pointNormal.z) * pointNormal.normal_z;
+		const float sign = static_cast<float>(dot >= 0.f) * 2.f - 1.f;
+		pointNormal.normal_x *= sign;
+		pointNormal.normal_y *= sign;
+		pointNormal.normal_z *= sign;
 	}
 }
 
@@ -343,21 +346,123 @@ inline void unitBackRayVector(const PointT				&hitPoint,
 	P_O.curvature = -1.f;
 }
 
+/** @brief		Compute unit vectors from the hit points to the sensor position, P_O
+  * @details	Batches of points are processed in parallel.
+  *				In each batch, the ray back vectors are gathered into separate x/y/z arrays,
+  *				so the inverse lengths are computed in a vectorizable loop with one division per point,
+  *				and the results are written straight into the output point normals.
+  *				A hit point at the sensor position gives a non-finite normal, which pcl::isFinite rejects.
+  */
+void unitRayBackVectors(const pcl::PointCloud<pcl::PointXYZ>		&pointCloud,
+								const pcl::PointXYZ								&sensorPosition,
+								pcl::PointCloud<pcl::PointNormal>			&pointNormalCloud)
+{
+	// memory allocation
+	const int N = static_cast<int>(pointCloud.points.size());
+	pointNormalCloud.points.resize(N);
+	pointNormalCloud.width		= static_cast<uint32_t>(N);
+	pointNormalCloud.height		= 1;
+
+	// for each batch
+	const int NUM_BATCHES = (N + KERNEL_BATCH_SIZE_ - 1) / KERNEL_BATCH_SIZE_;
+	#pragma omp parallel for schedule(static)
+	for(int batch = 0; batch < NUM_BATCHES; batch++)
+	{
+		float dx[KERNEL_BATCH_SIZE_], dy[KERNEL_BATCH_SIZE_], dz[KERNEL_BATCH_SIZE_], inv_length[KERNEL_BATCH_SIZE_];
+		const int first	= batch * KERNEL_BATCH_SIZE_;
+		const int n			= std::min<int>(KERNEL_BATCH_SIZE_, N - first);
+
+		// vectors from the hit points to the origin (sensorPosition)
+		for(int j = 0; j < n; j++)
+		{
+			const pcl::PointXYZ &hitPoint = pointCloud.points[first + j];
+			dx[j] = sensorPosition.x - hitPoint.x;
+			dy[j] = sensorPosition.y - hitPoint.y;
+			dz[j] = sensorPosition.z - hitPoint.z;
+		}
+
+		// inverse lengths
+		for(int j = 0; j < n; j++)
+			inv_length[j] = 1.f / sqrt(dx[j]*dx[j] + dy[j]*dy[j] + dz[j]*dz[j]);
+
+		// hit points and unit vectors
+		for(int j = 0; j < n; j++)
+		{
+			const pcl::PointXYZ	&hitPoint	= pointCloud.points[first + j];
+			pcl::PointNormal		&P_O			= pointNormalCloud.points[first + j];
+			P_O.x				= hitPoint.x;
+			P_O.y				= hitPoint.y;
+			P_O.z				= hitPoint.z;
+			P_O.normal_x	= dx[j] * inv_length[j];
+			P_O.normal_y	= dy[j] * inv_length[j];
+			P_O.normal_z	= dz[j] * inv_length[j];
+			P_O.curvature	= -1.f;
+		}
+	}
+}
+
 /** @brief Compute unit vectors from the hit points to the sensor position, P_O */
 pcl::PointCloud<pcl::PointNormal>::Ptr unitRayBackVectors(const pcl::PointCloud<pcl::PointXYZ>		&pointCloud,
 																			 const pcl::PointXYZ								&sensorPosition)
 {
 	// memory allocation
 	pcl::PointCloud<pcl::PointNormal>::Ptr pPointNormalCloud(new pcl::PointCloud<pcl::PointNormal>());
-	pPointNormalCloud->resize(pointCloud.size());
 
 	// unit vectors
-	for(size_t i = 0; i < pointCloud.points.size(); i++)
-		unitBackRayVector(pointCloud.points[i], sensorPosition, pPointNormalCloud->points[i]);
+	unitRayBackVectors(pointCloud, sensorPosition, *pPointNormalCloud);
 
 	return pPointNormalCloud;
 }
 
+/** @brief		Pipeline processor for the function and derivative observations of a hit point cloud
+  * @details	The first output is the unit ray back vectors
+  *				and the second one is the surface normals by moving least squares, if requested.
+  */
+class FuncDerObservationProcessor
+{
+public:
+	/** @brief Constructor */
+	FuncDerObservationProcessor(const PointXYZVList		&sensorPositionList,
+										 const float				searchRadius)
+		: m_sensorPositionList(sensorPositionList),
+		  m_searchRadius(searchRadius)
+	{
+	}
+
+	/** @brief Process the i-th observation */
+	void operator()(const size_t														i,
+						 const pcl::PointCloud<pcl::PointXYZ>::Ptr					&pHitPointCloud,
+						 std::vector<pcl::PointCloud<pcl::PointNormal>::Ptr>	&outputCloudPtrList) const
+	{
+		// check
+		assert(i < m_sensorPositionList.size());
+
+		// function observations: unit ray back vectors
+		if(outputCloudPtrList.size() > 0)
+			outputCloudPtrList[0] = unitRayBackVectors(*pHitPointCloud, m_sensorPositionList[i]);
+
+		// derivative observations: surface normals
+		if(outputCloudPtrList.size() > 1)
+		{
+			// estimate the surface normals
+			outputCloudPtrList[1] = smoothAndNormalEstimation(pHitPointCloud, m_searchRadius);
+
+			// normalize
+			normalizeNormalVectorCloud<pcl::PointNormal>(outputCloudPtrList[1]);
+
+			// flip toward the sensor position
+			flipSurfaceNormals(m_sensorPositionList[i], *(outputCloudPtrList[1]));
+		}
+	}
+
+protected:
+	/** @brief Sensor positions of the observations */
+	PointXYZVList	m_sensorPositionList;
+
+	/** @brief Search radius for moving least squares */
+	float				m_searchRadius;
+};
+
 /** @brief Compute unit vectors from the hit points to the sensor position, P_O */
 void unitRayBackVectors(const std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr>	&pointCloudPtrList,
 								const PointXYZVList													&sensorPositionList,
@@ -366,16 +471,15 @@ void unitRayBackVectors(const std::vector<pcl::PointCloud<pcl::PointXYZ>::Ptr>	&
 	// resize
 	pointNormalCloudPtrList.resize(pointCloudPtrList.size());
 
-	// for each point cloud
-	for(size_t i = 0; i < pointCloudPtrList.size(); i++)
-	{
-		std::cout << "Calculate unit ray back vectors: " << i << " ... ";
-
-		// calculate unit ray back vectors
+	// calculate unit ray back vectors of the point clouds concurrently
+	const int NUM_CLOUDS = static_cast<int>(pointCloudPtrList.size());
+	#pragma omp parallel for schedule(dynamic)
+	for(int i = 0; i < NUM_CLOUDS; i++)
 		pointNormalCloudPtrList[i] = unitRayBackVectors(*pointCloudPtrList[i], sensorPositionList[i]);
 
-		std::cout << pointNormalCloudPtrList[i]->size() << " normals." << std::endl;
-	}
+	// log
+	for(size_t i = 0; i < pointCloudPtrList.size(); i++)
+		std::cout << "Calculate unit ray back vectors: " << i << " ... " << pointNormalCloudPtrList[i]->size() << " normals." << std::endl;
 }
 
 }
@@ -1,6 +1,16 @@
 #ifndef FILTERS_FOR_POINT_CLOUDS_HPP
 #define FILTERS_FOR_POINT_CLOUDS_HPP
 
+// STL
+#include <cmath>			// floor
+#include <vector>
+#include <algorithm>		// std::min, std::sort
+
+// Boost
+#include <boost/cstdint.hpp>				// boost::int64_t
+#include <boost/functional/hash.hpp>		// boost::hash_combine
+#include <boost/unordered_map.hpp>		// boost::unordered_map
+
 // PCL
 #include <pcl/point_types.h>
 #include <pcl/point_cloud.h>
@@ -9,7 +19,6 @@
 #include <pcl/filters/crop_box.h>
 #include <pcl/filters/conditional_removal.h>
 #include <pcl/filters/passthrough.h>
-#include <pcl/filters/voxel_grid.h>
 //#include <pcl/filters/normal_refinement.h>
 //#include <pcl/filters/impl/normal_refinement.hpp>
 
@@ -190,19 +199,152 @@ rangeRemoval(typename pcl::PointCloud<PointT>::ConstPtr cloud,
 	return cloud_filtered;
 }
 
+/** @brief		Integer coordinates of a voxel
+  * @details	They are 64-bit integers, so the extent of a point cloud is not bounded
+  *				unlike the 32-bit voxel index of pcl::VoxelGrid.
+  */
+struct VoxelCoordinates
+{
+	boost::int64_t x, y, z;
+
+	inline bool operator==(const VoxelCoordinates &other) const
+	{
+		return x == other.x && y == other.y && z == other.z;
+	}
+
+	/** @brief Order of pcl::VoxelGrid, where x changes fastest */
+	inline bool operator<(const VoxelCoordinates &other) const
+	{
+		if(z != other.z) return z < other.z;
+		if(y != other.y) return y < other.y;
+		return x < other.x;
+	}
+};
+
+/** @brief Hash of voxel coordinates */
+inline size_t hash_value(const VoxelCoordinates &voxel)
+{
+	size_t seed(0);
+	boost::hash_combine(seed, voxel.x);
+	boost::hash_combine(seed, voxel.y);
+	boost::hash_combine(seed, voxel.z);
+	return seed;
+}
+
+/** @brief Sum of the points in a voxel */
+struct VoxelCentroid
+{
+	double	x, y, z;		// sum
+	size_t	count;		// number of points
+	int		first;		// index of the first point
+};
+
+/** @brief Order of voxels by their coordinates */
+struct VoxelLess
+{
+	template <typename VoxelT>
+	inline bool operator()(const VoxelT &lhs, const VoxelT &rhs) const
+	{
+		return lhs.first < rhs.first;
+	}
+};
+
+/** @brief		Down-sample a point cloud with a hashed voxel grid
+  * @details	Each voxel is represented by the centroid of its finite points.
+  *				As in pcl::VoxelGrid, x/y/z are averaged,
+  *				but the other fields are those of the first point in the voxel.
+  *				The points are accumulated in a single parallel pass into a hash map per chunk of points,
+  *				and the chunks are merged in order, so the result does not depend on the number of threads.
+  *				The down-sampled points are in the order of pcl::VoxelGrid.
+  */
 template <typename PointT>
 typename pcl::PointCloud<PointT>::Ptr
 downSampling(const typename pcl::PointCloud<PointT>::ConstPtr		&pCloud,
 			  const float														leafSize)
 {
-	// build the filter
-	pcl::VoxelGrid<PointT> vg;
-	vg.setInputCloud(pCloud);
-	vg.setLeafSize(leafSize, leafSize, leafSize);
+	typedef boost::unordered_map<VoxelCoordinates, VoxelCentroid>	VoxelMap;
+	assert(leafSize > 0.f);
+
+	// chunks of points
+	const int	N						= static_cast<int>(pCloud->points.size());
+	const int	CHUNK_SIZE			= 65536;
+	const int	NUM_CHUNKS			= (N + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	const double inv_leafSize		= 1.0 / static_cast<double>(leafSize);
+
+	// accumulate
+	std::vector<VoxelMap> voxelMaps(NUM_CHUNKS);
+	#pragma omp parallel for schedule(dynamic)
+	for(int chunk = 0; chunk < NUM_CHUNKS; chunk++)
+	{
+		VoxelMap &voxelMap = voxelMaps[chunk];
+		const int last = std::min<int>(N, (chunk + 1) * CHUNK_SIZE);
+		VoxelCoordinates voxel;
+		for(int i = chunk * CHUNK_SIZE; i < last; i++)
+		{
+			// point
+			const PointT &point = pCloud->points[i];
+			if(!pcl::isFinite(point)) continue;
+
+			// voxel
+			voxel.x = static_cast<boost::int64_t>(floor(static_cast<double>(point.x) * inv_leafSize));
+			voxel.y = static_cast<boost::int64_t>(floor(static_cast<double>(point.y) * inv_leafSize));
+			voxel.z = static_cast<boost::int64_t>(floor(static_cast<double>(point.z) * inv_leafSize));
+
+			// sum
+			std::pair<typename VoxelMap::iterator, bool> result = voxelMap.insert(std::make_pair(voxel, VoxelCentroid()));
+			VoxelCentroid &centroid = result.first->second;
+			if(result.second)
+			{
+				centroid.x = centroid.y = centroid.z = 0.0;
+				centroid.count = 0;
+				centroid.first = i;
+			}
+			centroid.x += point.x;
+			centroid.y += point.y;
+			centroid.z += point.z;
+			centroid.count++;
+		}
+	}
 
-	// apply filter
-	pcl::PointCloud<PointT>::Ptr pFilteredCloud(new pcl::PointCloud<PointT>());
-	vg.filter(*pFilteredCloud);
+	// merge
+	for(int chunk = 1; chunk < NUM_CHUNKS; chunk++)
+	{
+		for(typename VoxelMap::const_iterator iter = voxelMaps[chunk].begin(); iter != voxelMaps[chunk].end(); ++iter)
+		{
+			std::pair<typename VoxelMap::iterator, bool> result = voxelMaps[0].insert(*iter);
+			if(result.second) continue;
+			VoxelCentroid &centroid = result.first->second;
+			centroid.x		+= iter->second.x;
+			centroid.y		+= iter->second.y;
+			centroid.z		+= iter->second.z;
+			centroid.count	+= iter->second.count;
+		}
+		VoxelMap().swap(voxelMaps[chunk]);
+	}
+
+	// sort the voxels
+	typedef std::pair<VoxelCoordinates, VoxelCentroid> Voxel;
+	std::vector<Voxel> voxels;
+	if(NUM_CHUNKS > 0) voxels.assign(voxelMaps[0].begin(), voxelMaps[0].end());
+	std::sort(voxels.begin(), voxels.end(), VoxelLess());
+
+	// centroids
+	typename pcl::PointCloud<PointT>::Ptr pFilteredCloud(new pcl::PointCloud<PointT>());
+	pFilteredCloud->header = pCloud->header;
+	pFilteredCloud->points.resize(voxels.size());
+	for(size_t i = 0; i < voxels.size(); i++)
+	{
+		const VoxelCentroid &centroid = voxels[i].second;
+		const double inv_count = 1.0 / static_cast<double>(centroid.count);
+		PointT &point = pFilteredCloud->points[i];
+		point		= pCloud->points[centroid.first];
+		point.x	= static_cast<float>(centroid.x * inv_count);
+		point.y	= static_cast<float>(centroid.y * inv_count);
+		point.z	= static_cast<float>(centroid.z * inv_count);
+	}
+	pFilteredCloud->width		= static_cast<uint32_t>(pFilteredCloud->points.size());
+	pFilteredCloud->height		= 1;
+	pFilteredCloud->is_dense	= true;
 
 	return pFilteredCloud;
 }
@@ -0,0 +1,104 @@
+#ifndef _GPMAP_BINARY_IO_HPP_
+#define _GPMAP_BINARY_IO_HPP_
+
+// STL
+#include <istream>
+#include <ostream>
+
+// Boost
+#include <boost/cstdint.hpp>			// boost::uint64_t
+#include <boost/shared_ptr.hpp>		// boost::shared_ptr
+
+// Eigen
+#include <Eigen/Dense>
+
+namespace GPMap {
+
+/** @brief		Raw binary I/O of plain values and Eigen matrices
+  * @details	Values are written in the native byte order without any conversion,
+  *				so the files are meant to be read on the same platform such as checkpoints.
+  *				Matrices are written with their rows and columns followed by the data in column-major order.
+  */
+
+/** @brief Write a plain value */
+template <typename T>
+inline void writeBinary(std::ostream &os, const T &value)
+{
+	os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/** @brief Read a plain value */
+template <typename T>
+inline bool readBinary(std::istream &is, T &value)
+{
+	is.read(reinterpret_cast<char*>(&value), sizeof(T));
+	return is.good();
+}
+
+/** @brief Write an Eigen matrix or vector */
+template <typename Derived>
+inline void writeMatrixBinary(std::ostream &os, const Eigen::PlainObjectBase<Derived> &m)
+{
+	writeBinary(os, static_cast<boost::uint64_t>(m.rows()));
+	writeBinary(os, static_cast<boost::uint64_t>(m.cols()));
+	os.write(reinterpret_cast<const char*>(m.data()), sizeof(typename Derived::Scalar) * m.size());
+}
+
+/** @brief		Read an Eigen matrix or vector
+  * @details	The memory is reallocated only if the pointer is NULL or the size is different.
+  */
+template <typename MatrixT>
+inline bool readMatrixBinary(std::istream &is, boost::shared_ptr<MatrixT> &pMatrix)
+{
+	// size
+	boost::uint64_t rows, cols;
+	if(!readBinary(is, rows) || !readBinary(is, cols)) return false;
+	if(MatrixT::ColsAtCompileTime == 1 && cols != 1) return false;
+
+	// memory allocation
+	if(!pMatrix || static_cast<boost::uint64_t>(pMatrix->rows()) != rows
+					|| static_cast<boost::uint64_t>(pMatrix->cols()) != cols)
+		pMatrix.reset(new MatrixT(static_cast<typename MatrixT::Index>(rows), static_cast<typename MatrixT::Index>(cols)));
+
+	// data
+	is.read(reinterpret_cast<char*>(pMatrix->data()), sizeof(typename MatrixT::Scalar) * pMatrix->size());
+	return is.good();
+}
+
+/** @brief		Read an Eigen matrix or vector into an object
+  * @details	A dynamic size is resized, but a fixed size should match.
+  */
+template <typename Derived>
+inline bool readMatrixBinary(std::istream &is, Eigen::PlainObjectBase<Derived> &m)
+{
+	// size
+	boost::uint64_t rows, cols;
+	if(!readBinary(is, rows) || !readBinary(is, cols)) return false;
+	if((Derived::RowsAtCompileTime != Eigen::Dynamic && rows != static_cast<boost::uint64_t>(Derived::RowsAtCompileTime)) ||
+		(Derived::ColsAtCompileTime != Eigen::Dynamic && cols != static_cast<boost::uint64_t>(Derived::ColsAtCompileTime))) return false;
+	m.resize(static_cast<typename Derived::Index>(rows), static_cast<typename Derived::Index>(cols));
+
+	// data
+	is.read(reinterpret_cast<char*>(m.data()), sizeof(typename Derived::Scalar) * m.size());
+	return is.good();
+}
+
+/** @brief		64-bit FNV-1a hash of raw bytes
+  * @details	It can be chained by passing the previous hash as the seed,
+  *				so a fingerprint of several buffers, such as point clouds, is built incrementally.
+  */
+inline boost::uint64_t fingerprintBinary(const void *pData, const size_t numBytes, 
+													  boost::uint64_t seed = 0xcbf29ce484222325ULL)
+{
+	const unsigned char *pBytes = static_cast<const unsigned char*>(pData);
+	for(size_t i = 0; i < numBytes; i++)
+	{
+		seed ^= static_cast<boost::uint64_t>(pBytes[i]);
+		seed *= 0x100000001b3ULL;
+	}
+	return seed;
+}
+
+}
+
+#endif
@@ -21,6 +21,7 @@ using GP::LogFile;
 // GPMap
 #include "util/data_types.hpp"	// PointXYZVList
 #include "util/filesystem.hpp"	// extractFileExtension
+#include "io/pcd_view.hpp"			// loadMappedPCDFile
 
 namespace GPMap {
 
@@ -29,12 +30,16 @@ int loadPointCloud(typename pcl::PointCloud<PointT>::Ptr		&pPointCloud,
 						 const std::string								&strFilePath, 
 						 const bool											fAccumulation = false)
 {
+	// binary PCD files are read through a memory-mapped view without a temporary cloud
+	const std::string strFileExtension(extractFileExtension(strFilePath));
+	if(strFileExtension.compare(".pcd") == 0 &&
+		loadMappedPCDFile<PointT>(pPointCloud, strFilePath, fAccumulation)) return pPointCloud->size();
+
 	// point cloud
 	typename pcl::PointCloud<PointT>::Ptr pTempCloud(new pcl::PointCloud<PointT>());
 
 	// load the file based on the file extension
 	int result = -2;
-	const std::string strFileExtension(extractFileExtension(strFilePath));
 	if(strFileExtension.compare(".pcd") == 0)		result = pcl::io::loadPCDFile<PointT>(strFilePath.c_str(), *pTempCloud);
 	if(strFileExtension.compare(".ply") == 0)		result = pcl::io::loadPLYFile<PointT>(strFilePath.c_str(), *pTempCloud);
 	
@@ -90,9 +95,17 @@ void loadPointCloud(std::vector<typename pcl::PointCloud<PointT>::Ptr>		&pPointC
 	// resize
 	pPointClouds.resize(strFileNames.size());
 
-	// load files
+	// load files concurrently
+	const int NUM_FILES = static_cast<int>(strFileNames.size());
+	std::vector<int> numPoints(strFileNames.size());
+	#pragma omp parallel for schedule(dynamic)
+	for(int i = 0; i < NUM_FILES; i++)
+		numPoints[i] = loadPointCloud<PointT>(pPointClouds[i], strPrefix + strFileNames[i] + strSuffix);
+
+	// log file
+	LogFile logFile;
 	for(size_t i = 0; i < strFileNames.size(); i++)
-		loadPointCloud<PointT>(pPointClouds[i], strFileNames[i], strPrefix, strSuffix);
+		logFile << "Loading " << strFileNames[i] << " ... " << numPoints[i] << " points." << std::endl;
 }
 
 template <typename PointT>
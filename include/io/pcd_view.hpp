@@ -0,0 +1,315 @@
+#ifndef _POINT_CLOUD_PCD_VIEW_HPP_
+#define _POINT_CLOUD_PCD_VIEW_HPP_
+
+// STL
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstring>		// memcpy
+
+// Boost
+#include <boost/iostreams/device/mapped_file.hpp>	// boost::iostreams::mapped_file_source
+
+// PCL
+#include <pcl/point_types.h>		// pcl::PointNormal
+#include <pcl/point_cloud.h>		// pcl::PointCloud
+
+// GPMap
+#include "util/data_types.hpp"	// PointNormalCloudPtr
+
+namespace GPMap {
+
+/** @brief		Read-only view of a binary PCD file of pcl::PointNormal points
+  * @details	The file is memory-mapped and each point is decoded from the mapped bytes on access,
+  *				so the points are neither loaded into a temporary cloud nor copied.
+  *				It has the same points[i] and points.size() interface as pcl::PointCloud,
+  *				so generic code such as numFinitePoints() and generateTrainingData() can index it directly.
+  *				Only uncompressed binary files with float fields are supported.
+  */
+class PointNormalPCDView
+{
+public:
+	/** @brief Point list decoded from the mapped memory */
+	class PointList
+	{
+	public:
+		/** @brief Constructor */
+		PointList()
+			: m_pData(0), m_stride(0), m_size(0)
+		{
+			for(size_t j = 0; j < NUM_FIELDS_; j++) m_offsets[j] = 0;
+		}
+
+		/** @brief Number of points */
+		inline size_t size() const
+		{
+			return m_size;
+		}
+
+		/** @brief i-th point */
+		inline pcl::PointNormal operator[](const size_t i) const
+		{
+			assert(i < m_size);
+			const char *pPoint = m_pData + i * m_stride;
+			float values[NUM_FIELDS_];
+			for(size_t j = 0; j < NUM_FIELDS_; j++) memcpy(&values[j], pPoint + m_offsets[j], sizeof(float));
+
+			pcl::PointNormal point;
+			point.x			= values[0];
+			point.y			= values[1];
+			point.z			= values[2];
+			point.normal_x	= values[3];
+			point.normal_y	= values[4];
+			point.normal_z	= values[5];
+			point.curvature	= values[6];
+			return point;
+		}
+
+	protected:
+		friend class PointNormalPCDView;
+
+		/** @brief Number of fields: x, y, z, normal_x, normal_y, normal_z, curvature */
+		static const size_t NUM_FIELDS_ = 7;
+
+		/** @brief First byte of the data */
+		const char	*m_pData;
+
+		/** @brief Bytes per point */
+		size_t		m_stride;
+
+		/** @brief Number of points */
+		size_t		m_size;
+
+		/** @brief Byte offsets of the fields in a point */
+		size_t		m_offsets[NUM_FIELDS_];
+	};
+
+public:
+	/** @brief Constructor */
+	PointNormalPCDView()
+	{
+	}
+
+	/** @brief Constructor */
+	explicit PointNormalPCDView(const std::string &strFilePath)
+	{
+		open(strFilePath);
+	}
+
+	/** @brief		Map a binary PCD file
+	  * @return		False if the file cannot be mapped or is not a binary PCD file of point normals
+	  */
+	bool open(const std::string &strFilePath)
+	{
+		// reset
+		close();
+
+		// map
+		try
+		{
+			m_file.open(strFilePath);
+		}
+		catch(std::exception &)
+		{
+			return false;
+		}
+		if(!m_file.is_open()) return false;
+
+		// header
+		if(!parseHeader())
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	/** @brief Unmap the file */
+	void close()
+	{
+		if(m_file.is_open()) m_file.close();
+		points = PointList();
+	}
+
+	/** @brief Check if a file is mapped */
+	bool isOpen() const
+	{
+		return m_file.is_open() && points.m_pData != 0;
+	}
+
+	/** @brief Number of points */
+	size_t size() const
+	{
+		return points.size();
+	}
+
+public:
+	/** @brief Points */
+	PointList points;
+
+protected:
+	/** @brief Parse the header and locate the fields */
+	bool parseHeader()
+	{
+		const char *pBegin	= m_file.data();
+		const char *pEnd		= pBegin + m_file.size();
+
+		// fields
+		std::vector<std::string>	fieldNames;
+		std::vector<size_t>			fieldSizes, fieldCounts;
+		std::vector<char>				fieldTypes;
+		size_t numPoints(0), width(0), height(1);
+
+		// for each line
+		const char *pLine = pBegin;
+		while(pLine < pEnd)
+		{
+			// line
+			const char *pLineEnd = pLine;
+			while(pLineEnd < pEnd && *pLineEnd != '\n') pLineEnd++;
+			std::istringstream line(std::string(pLine, pLineEnd));
+			pLine = (pLineEnd < pEnd) ? pLineEnd + 1 : pEnd;
+
+			// keyword
+			std::string strKeyword;
+			if(!(line >> strKeyword) || strKeyword[0] == '#') continue;
+
+			if(strKeyword == "FIELDS")
+			{
+				std::string strName;
+				while(line >> strName) fieldNames.push_back(strName);
+			}
+			else if(strKeyword == "SIZE")
+			{
+				size_t value;
+				while(line >> value) fieldSizes.push_back(value);
+			}
+			else if(strKeyword == "TYPE")
+			{
+				char value;
+				while(line >> value) fieldTypes.push_back(value);
+			}
+			else if(strKeyword == "COUNT")
+			{
+				size_t value;
+				while(line >> value) fieldCounts.push_back(value);
+			}
+			else if(strKeyword == "WIDTH")	line >> width;
+			else if(strKeyword == "HEIGHT")	line >> height;
+			else if(strKeyword == "POINTS")	line >> numPoints;
+			else if(strKeyword == "DATA")
+			{
+				// binary only
+				std::string strData;
+				line >> strData;
+				if(strData != "binary") return false;
+
+				// data starts at the next line
+				return locateFields(fieldNames, fieldSizes, fieldTypes, fieldCounts,
+										  numPoints > 0 ? numPoints : width * height,
+										  pLine, pEnd);
+			}
+		}
+		return false;
+	}
+
+	/** @brief Byte offsets of the point normal fields */
+	bool locateFields(const std::vector<std::string>	&fieldNames,
+							const std::vector<size_t>			&fieldSizes,
+							const std::vector<char>				&fieldTypes,
+							std::vector<size_t>					fieldCounts,
+							const size_t							numPoints,
+							const char								*pData,
+							const char								*pEnd)
+	{
+		// check
+		if(fieldCounts.empty()) fieldCounts.assign(fieldNames.size(), 1);
+		if(fieldNames.size() != fieldSizes.size() ||
+			fieldNames.size() != fieldTypes.size() ||
+			fieldNames.size() != fieldCounts.size()) return false;
+
+		// field names
+		static const char *FIELD_NAMES[PointList::NUM_FIELDS_] = {"x", "y", "z", "normal_x", "normal_y", "normal_z", "curvature"};
+		bool fFound[PointList::NUM_FIELDS_] = {false, false, false, false, false, false, false};
+
+		// offsets
+		PointList pointList;
+		size_t offset(0);
+		for(size_t i = 0; i < fieldNames.size(); i++)
+		{
+			for(size_t j = 0; j < PointList::NUM_FIELDS_; j++)
+			{
+				if(fieldNames[i] != FIELD_NAMES[j]) continue;
+				if(fieldTypes[i] != 'F' || fieldSizes[i] != sizeof(float)) return false;
+				pointList.m_offsets[j]	= offset;
+				fFound[j]					= true;
+			}
+			offset += fieldSizes[i] * fieldCounts[i];
+		}
+		for(size_t j = 0; j < PointList::NUM_FIELDS_; j++)
+			if(!fFound[j]) return false;
+
+		// size check
+		if(static_cast<size_t>(pEnd - pData) < numPoints * offset) return false;
+
+		// points
+		pointList.m_pData		= pData;
+		pointList.m_stride	= offset;
+		pointList.m_size		= numPoints;
+		points = pointList;
+		return true;
+	}
+
+protected:
+	/** @brief Memory-mapped file */
+	boost::iostreams::mapped_file_source	m_file;
+};
+
+/** @brief		Load a binary PCD file through a memory-mapped view
+  * @details	Only the finite points are appended to the point cloud,
+  *				so neither a temporary cloud nor NaN removal is needed.
+  * @return		False if the file is not supported, in which case the point cloud is not changed
+  */
+template <typename PointT>
+inline bool loadMappedPCDFile(typename pcl::PointCloud<PointT>::Ptr	&pPointCloud,
+										const std::string							&strFilePath,
+										const bool									fAccumulation = false)
+{
+	return false;
+}
+
+/** @brief		Load a binary PCD file of point normals through a memory-mapped view */
+template <>
+inline bool loadMappedPCDFile<pcl::PointNormal>(PointNormalCloudPtr		&pPointCloud,
+																const std::string			&strFilePath,
+																const bool					fAccumulation)
+{
+	// view
+	PointNormalPCDView view;
+	if(!view.open(strFilePath)) return false;
+
+	// number of finite points
+	size_t numFinitePoints(0);
+	for(size_t i = 0; i < view.points.size(); i++)
+		if(pcl::isFinite<pcl::PointNormal>(view.points[i])) numFinitePoints++;
+
+	// point cloud
+	if(!fAccumulation || !pPointCloud) pPointCloud.reset(new PointNormalCloud());
+
+	// append the finite points
+	pPointCloud->points.reserve(pPointCloud->points.size() + numFinitePoints);
+	for(size_t i = 0; i < view.points.size(); i++)
+	{
+		const pcl::PointNormal point = view.points[i];
+		if(pcl::isFinite<pcl::PointNormal>(point)) pPointCloud->points.push_back(point);
+	}
+	pPointCloud->width		= static_cast<uint32_t>(pPointCloud->points.size());
+	pPointCloud->height		= 1;
+	pPointCloud->is_dense	= true;
+
+	return true;
+}
+
+}
+
+#endif
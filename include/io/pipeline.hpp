@@ -0,0 +1,249 @@
+#ifndef _POINT_CLOUD_PIPELINE_HPP_
+#define _POINT_CLOUD_PIPELINE_HPP_
+
+// STL
+#include <string>
+#include <vector>
+#include <algorithm>		// std::max
+
+// Boost
+#include <boost/thread/thread.hpp>		// boost::thread, boost::thread_group
+#include <boost/thread/mutex.hpp>		// boost::mutex
+#include <boost/bind.hpp>					// boost::bind
+
+// PCL
+#include <pcl/point_cloud.h>				// pcl::PointCloud
+
+// GP
+#include "gp.h"								// LogFile
+using GP::LogFile;
+
+// GPMap
+#include "util/data_types.hpp"			// StringList
+#include "util/timer.hpp"					// CPU_Times, CPU_Timer
+#include "util/bounded_queue.hpp"		// BoundedQueue
+#include "io/io.hpp"							// loadPointCloud, savePointCloud
+
+namespace GPMap {
+
+/** @brief		Elapsed times of the pipeline stages
+  * @details	Each stage time is the sum of the times of its tasks,
+  *				so the processing stage may exceed the wall-clock time of the whole pipeline.
+  */
+struct PipelineTimes
+{
+	/** @brief Constructor */
+	PipelineTimes()
+		: numObservations(0)
+	{
+		loadTimes.clear();
+		processTimes.clear();
+		saveTimes.clear();
+		totalTimes.clear();
+	}
+
+	size_t		numObservations;	// number of processed observations
+	CPU_Times	loadTimes;			// loading
+	CPU_Times	processTimes;		// processing
+	CPU_Times	saveTimes;			// saving
+	CPU_Times	totalTimes;			// whole pipeline
+};
+
+/** @brief		Load, process and save observation files concurrently
+  * @details	One thread loads the files in order, numWorkers threads process them
+  *				and one thread saves the outputs, connected with queues of depth queueDepth.
+  *				So at most about 2*queueDepth + numWorkers + 2 observations are in memory at once.
+  *				The processor is called as process(i, pInputCloud, outputCloudPtrList)
+  *				and fills one output cloud per output prefix/suffix pair.
+  *				If it uses OpenMP itself, fewer workers are usually better.
+  */
+template <typename InputPointT, typename OutputPointT, typename ProcessorT>
+class PointCloudPipeline
+{
+public:
+	typedef typename pcl::PointCloud<InputPointT>::Ptr		InputCloudPtr;
+	typedef typename pcl::PointCloud<OutputPointT>::Ptr		OutputCloudPtr;
+	typedef std::vector<OutputCloudPtr>								OutputCloudPtrList;
+
+protected:
+	/** @brief Observation in the pipeline */
+	struct Item
+	{
+		size_t					index;
+		InputCloudPtr			pInputCloud;
+		OutputCloudPtrList	outputCloudPtrList;
+	};
+	typedef boost::shared_ptr<Item>	ItemPtr;
+
+public:
+	/** @brief Constructor */
+	PointCloudPipeline(const ProcessorT		&processor,
+							 const size_t				numWorkers = 0,		// 0 for the number of hardware threads
+							 const size_t				queueDepth = 4)
+		: m_processor(processor),
+		  m_numWorkers(numWorkers > 0 ? numWorkers : std::max<size_t>(boost::thread::hardware_concurrency(), 1)),
+		  m_queueDepth(std::max<size_t>(queueDepth, 1))
+	{
+	}
+
+	/** @brief Run the pipeline */
+	PipelineTimes run(const StringList	&strFileNames,
+							const std::string	&strInputPrefix,
+							const std::string	&strInputSuffix,
+							const StringList	&strOutputPrefixes,
+							const StringList	&strOutputSuffixes,
+							const bool			fBinary = true)
+	{
+		// check
+		assert(strOutputPrefixes.size() == strOutputSuffixes.size());
+
+		// settings
+		m_pFileNames			= &strFileNames;
+		m_pInputPrefix			= &strInputPrefix;
+		m_pInputSuffix			= &strInputSuffix;
+		m_pOutputPrefixes		= &strOutputPrefixes;
+		m_pOutputSuffixes		= &strOutputSuffixes;
+		m_fBinary				= fBinary;
+		m_times					= PipelineTimes();
+
+		// queues
+		BoundedQueue<ItemPtr> inputQueue(m_queueDepth), outputQueue(m_queueDepth);
+
+		// timer - start
+		CPU_Timer timer;
+
+		// stages
+		boost::thread loader(boost::bind(&PointCloudPipeline::load, this, boost::ref(inputQueue)));
+		boost::thread_group workers;
+		for(size_t i = 0; i < m_numWorkers; i++)
+			workers.create_thread(boost::bind(&PointCloudPipeline::process, this, boost::ref(inputQueue), boost::ref(outputQueue)));
+		boost::thread saver(boost::bind(&PointCloudPipeline::save, this, boost::ref(outputQueue)));
+
+		// wait
+		loader.join();
+		workers.join_all();
+		outputQueue.close();
+		saver.join();
+
+		// timer - end
+		m_times.totalTimes = timer.elapsed();
+
+		// log
+		LogFile logFile;
+		logFile << "Pipeline: " << m_times.numObservations << " of " << strFileNames.size() << " observations with "
+				  << m_numWorkers << " workers and queue depth " << m_queueDepth << std::endl;
+		logFile << "Load - "		<< m_times.loadTimes		<< std::endl;
+		logFile << "Process - "	<< m_times.processTimes	<< std::endl;
+		logFile << "Save - "		<< m_times.saveTimes		<< std::endl;
+		logFile << "Total - "	<< m_times.totalTimes	<< std::endl;
+
+		return m_times;
+	}
+
+protected:
+	/** @brief Loading stage */
+	void load(BoundedQueue<ItemPtr> &inputQueue)
+	{
+		for(size_t i = 0; i < m_pFileNames->size(); i++)
+		{
+			// load
+			CPU_Timer timer;
+			ItemPtr pItem(new Item());
+			pItem->index = i;
+			loadPointCloud<InputPointT>(pItem->pInputCloud, *m_pInputPrefix + (*m_pFileNames)[i] + *m_pInputSuffix);
+			m_times.loadTimes += timer.elapsed();
+
+			// next stage
+			if(!inputQueue.push(pItem)) break;
+		}
+		inputQueue.close();
+	}
+
+	/** @brief Processing stage */
+	void process(BoundedQueue<ItemPtr> &inputQueue, BoundedQueue<ItemPtr> &outputQueue)
+	{
+		ItemPtr pItem;
+		while(inputQueue.pop(pItem))
+		{
+			// process
+			CPU_Timer timer;
+			pItem->outputCloudPtrList.resize(m_pOutputSuffixes->size());
+			m_processor(pItem->index, pItem->pInputCloud, pItem->outputCloudPtrList);
+			pItem->pInputCloud.reset();
+			const CPU_Times elapsed = timer.elapsed();
+
+			// time
+			{
+				boost::mutex::scoped_lock lock(m_mutex);
+				m_times.processTimes += elapsed;
+			}
+
+			// next stage
+			if(!outputQueue.push(pItem)) break;
+		}
+	}
+
+	/** @brief Saving stage */
+	void save(BoundedQueue<ItemPtr> &outputQueue)
+	{
+		ItemPtr pItem;
+		while(outputQueue.pop(pItem))
+		{
+			// save
+			CPU_Timer timer;
+			for(size_t j = 0; j < pItem->outputCloudPtrList.size(); j++)
+			{
+				if(!pItem->outputCloudPtrList[j]) continue;
+				savePointCloud<OutputPointT>(pItem->outputCloudPtrList[j],
+													  (*m_pOutputPrefixes)[j] + (*m_pFileNames)[pItem->index] + (*m_pOutputSuffixes)[j],
+													  m_fBinary);
+			}
+			m_times.saveTimes += timer.elapsed();
+			m_times.numObservations++;
+		}
+	}
+
+protected:
+	/** @brief Processor */
+	ProcessorT				m_processor;
+
+	/** @brief Number of processing threads */
+	const size_t			m_numWorkers;
+
+	/** @brief Depth of the queues between stages */
+	const size_t			m_queueDepth;
+
+	/** @brief Settings of the current run */
+	const StringList		*m_pFileNames;
+	const std::string		*m_pInputPrefix;
+	const std::string		*m_pInputSuffix;
+	const StringList		*m_pOutputPrefixes;
+	const StringList		*m_pOutputSuffixes;
+	bool						m_fBinary;
+
+	/** @brief Elapsed times */
+	PipelineTimes			m_times;
+
+	/** @brief Mutex for the processing times */
+	boost::mutex			m_mutex;
+};
+
+/** @brief Load, process and save observation files concurrently */
+template <typename InputPointT, typename OutputPointT, typename ProcessorT>
+PipelineTimes processPointClouds(const ProcessorT		&processor,
+											const StringList		&strFileNames,
+											const std::string		&strInputPrefix,
+											const std::string		&strInputSuffix,
+											const StringList		&strOutputPrefixes,
+											const StringList		&strOutputSuffixes,
+											const size_t			numWorkers = 0,
+											const size_t			queueDepth = 4,
+											const bool				fBinary = true)
+{
+	PointCloudPipeline<InputPointT, OutputPointT, ProcessorT> pipeline(processor, numWorkers, queueDepth);
+	return pipeline.run(strFileNames, strInputPrefix, strInputSuffix, strOutputPrefixes, strOutputSuffixes, fBinary);
+}
+
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef _POINT_CLOUD_SLAB_STREAM_HPP_
+#define _POINT_CLOUD_SLAB_STREAM_HPP_
+
+// STL
+#include <cmath>			// floor
+#include <cassert>		// assert
+#include <vector>
+#include <limits>			// std::numeric_limits<T>::max()
+#include <algorithm>		// std::min(), max()
+
+// Boost
+#include <boost/cstdint.hpp>		// boost::uint32_t
+
+// PCL
+#include <pcl/point_types.h>		// pcl::PointXYZ, pcl::PointNormal
+#include <pcl/point_cloud.h>		// pcl::PointCloud
+
+// GPMap
+#include "util/data_types.hpp"	// PointNormalCloud, PointNormalCloudPtr
+#include "io/pcd_view.hpp"			// PointNormalPCDView
+#include "util/async_logger.hpp"	// GPMAP_LOG_WARNING
+
+namespace GPMap {
+
+/** @brief		Stream of spatially sorted chunks of a memory-mapped observation file
+  * @details	The observations are split into slabs of a block size along the x axis,
+  *				where the slab boundaries coincide with the block boundaries of OctreeGPMap.
+  *				This relies on OctreeGPMap::defineBoundingBox() keeping the blocks on the global grid of multiples of the block size,
+  *				whatever the bounding box of the band is.
+  *				Since a block is predicted with the points in its 3x3x3 neighboring blocks,
+  *				the blocks in slabs [first, last] are completely predicted from the band of slabs [first-1, last+1].
+  *				Only the band is copied into memory, so the peak memory is bounded by the working band
+  *				in addition to the point indices grouped by slabs, which are 4 bytes per point.
+  *				The indices are built once in the constructor, so loading a band reads only its points from the mapped file.
+  */
+class PointNormalSlabStream
+{
+public:
+	/** @brief Constructor */
+	PointNormalSlabStream(const PointNormalPCDView &view, const double SLAB_SIZE)
+		: m_view(view),
+		  SLAB_SIZE_(SLAB_SIZE),
+		  m_minSlab(0),
+		  m_numPoints(0),
+		  m_min_pt(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()),
+		  m_max_pt(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max())
+	{
+		assert(SLAB_SIZE_ > 0.0);
+
+		// bounding box
+		for(size_t i = 0; i < m_view.points.size(); i++)
+		{
+			const pcl::PointNormal point = m_view.points[i];
+			if(!pcl::isFinite<pcl::PointNormal>(point)) continue;
+			m_min_pt.x = std::min<float>(m_min_pt.x, point.x);		m_max_pt.x = std::max<float>(m_max_pt.x, point.x);
+			m_min_pt.y = std::min<float>(m_min_pt.y, point.y);		m_max_pt.y = std::max<float>(m_max_pt.y, point.y);
+			m_min_pt.z = std::min<float>(m_min_pt.z, point.z);		m_max_pt.z = std::max<float>(m_max_pt.z, point.z);
+			m_numPoints++;
+		}
+		if(m_numPoints == 0) return;
+
+		// number of points in each slab
+		m_minSlab = slab(m_min_pt.x);
+		m_slabOffsets.assign(slab(m_max_pt.x) - m_minSlab + 2, 0);
+		for(size_t i = 0; i < m_view.points.size(); i++)
+		{
+			const pcl::PointNormal point = m_view.points[i];
+			if(!pcl::isFinite<pcl::PointNormal>(point)) continue;
+			m_slabOffsets[slab(point.x) - m_minSlab + 1]++;
+		}
+
+		// offset of the first point of each slab
+		for(size_t i = 1; i < m_slabOffsets.size(); i++) m_slabOffsets[i] += m_slabOffsets[i - 1];
+
+		// point indices grouped by slabs in ascending order in each slab
+		assert(m_view.points.size() <= static_cast<size_t>(std::numeric_limits<boost::uint32_t>::max()));
+		m_indices.resize(m_numPoints);
+		std::vector<size_t> next(m_slabOffsets.begin(), m_slabOffsets.end() - 1);
+		for(size_t i = 0; i < m_view.points.size(); i++)
+		{
+			const pcl::PointNormal point = m_view.points[i];
+			if(!pcl::isFinite<pcl::PointNormal>(point)) continue;
+			m_indices[next[slab(point.x) - m_minSlab]++] = static_cast<boost::uint32_t>(i);
+		}
+	}
+
+	/** @brief Number of finite points */
+	size_t numPoints() const
+	{
+		return m_numPoints;
+	}
+
+	/** @brief Number of slabs */
+	int numSlabs() const
+	{
+		return static_cast<int>(m_slabOffsets.size()) - 1;
+	}
+
+	/** @brief Bounding box of the finite points */
+	const pcl::PointXYZ& minPoint() const	{ return m_min_pt; }
+	const pcl::PointXYZ& maxPoint() const	{ return m_max_pt; }
+
+	/** @brief Number of points in the slabs [first, last] which are clipped to the valid range */
+	size_t numPointsInSlabs(int first, int last) const
+	{
+		first	= std::max<int>(first, 0);
+		last	= std::min<int>(last,  numSlabs() - 1);
+		if(first > last) return 0;
+		return m_slabOffsets[last + 1] - m_slabOffsets[first];
+	}
+
+	/** @brief		Next chunk of slabs
+	  * @details	Slabs are added to the chunk from the first one
+	  *				until the number of points in the band exceeds the limit.
+	  *				A chunk has at least one slab regardless of the limit,
+	  *				since a slab cannot be split without breaking the block boundaries,
+	  *				so a warning is logged when the band of a single slab exceeds the limit.
+	  * @return		False if there is no more slab
+	  */
+	bool nextChunk(const int first, const size_t maxNumPointsInBand, int &last) const
+	{
+		if(first >= numSlabs()) return false;
+		last = first;
+		while(last + 1 < numSlabs() &&
+				numPointsInSlabs(first - 1, last + 2) <= maxNumPointsInBand) last++;
+
+		// dense slab
+		const size_t numPointsInBand = numPointsInSlabs(first - 1, last + 1);
+		if(numPointsInBand > maxNumPointsInBand)
+		{
+			GPMAP_LOG_WARNING("PointNormalSlabStream: the band of the slab " << first << " has " << numPointsInBand
+									<< " points, exceeding the limit " << maxNumPointsInBand << "; use a smaller block size or a larger limit");
+		}
+		return true;
+	}
+
+	/** @brief		Copy the finite points in the band of the slabs [first-1, last+1]
+	  * @return		Number of points in the band
+	  */
+	size_t loadBand(const int first, const int last, PointNormalCloudPtr &pBandCloud) const
+	{
+		// memory allocation
+		pBandCloud.reset(new PointNormalCloud());
+		pBandCloud->points.reserve(numPointsInSlabs(first - 1, last + 1));
+
+		// copy the points of the band only
+		const int bandFirst	= std::max<int>(first - 1, 0);
+		const int bandLast	= std::min<int>(last + 1,  numSlabs() - 1);
+		if(bandFirst <= bandLast)
+		{
+			for(size_t i = m_slabOffsets[bandFirst]; i < m_slabOffsets[bandLast + 1]; i++)
+				pBandCloud->points.push_back(m_view.points[m_indices[i]]);
+		}
+		pBandCloud->width		= static_cast<uint32_t>(pBandCloud->points.size());
+		pBandCloud->height	= 1;
+		pBandCloud->is_dense	= true;
+
+		return pBandCloud->points.size();
+	}
+
+	/** @brief Range of x coordinates of the slabs [first, last] */
+	void slabRange(const int first, const int last, double &minX, double &maxX) const
+	{
+		minX = static_cast<double>(m_minSlab + first)	* SLAB_SIZE_;
+		maxX = static_cast<double>(m_minSlab + last + 1)	* SLAB_SIZE_;
+	}
+
+protected:
+	/** @brief Global slab index of a x coordinate */
+	inline int slab(const float x) const
+	{
+		return static_cast<int>(floor(static_cast<double>(x) / SLAB_SIZE_));
+	}
+
+protected:
+	/** @brief Memory-mapped observations */
+	const PointNormalPCDView	&m_view;
+
+	/** @brief Slab size */
+	const double					SLAB_SIZE_;
+
+	/** @brief Global index of the first slab */
+	int								m_minSlab;
+
+	/** @brief Offset of the first point of each slab in the index list, with the total at the end */
+	std::vector<size_t>			m_slabOffsets;
+
+	/** @brief Indices of the finite points grouped by slabs */
+	std::vector<boost::uint32_t>	m_indices;
+
+	/** @brief Number of finite points */
+	size_t							m_numPoints;
+
+	/** @brief Bounding box of the finite points */
+	pcl::PointXYZ					m_min_pt;
+	pcl::PointXYZ					m_max_pt;
+};
+
+}
+
+#endif
@@ -17,6 +17,7 @@ using GP::Epsilon;
 
 // GPMap
 #include "util/color_map.hpp"		// ColorMap
+#include "util/memory_usage.hpp"	// heapMemoryUsage
 
 //#define AVOID_VERTEX_DUPLICATION
 
@@ -1063,6 +1064,20 @@ public:
 		}
 	}
 
+	/** @brief	Memory usage in bytes of the scalar field, the mesh and the color buffers */
+	size_t memoryUsage() const
+	{
+		return sizeof(*this)
+				 + heapMemoryUsage(m_gridScalarField)
+				 + heapMemoryUsage(m_vertices)
+				 + heapMemoryUsage(m_triangles)
+				 + heapMemoryUsage(m_vertexRGBColors)
+				 + heapMemoryUsage(m_vertexValuesForColor_X)
+				 + heapMemoryUsage(m_vertexValuesForColor_Y)
+				 + heapMemoryUsage(m_vertexValuesForColor_Z)
+				 + heapMemoryUsage(m_vertexValuesForColor_V);
+	}
+
 protected:
 	// fGetOffset finds the approximate point of intersection of the surface
 	// between two points with the values fValue1 and fValue2
@@ -4,11 +4,18 @@
 // STL
 #include <string>
 #include <vector>
+#include <deque>
 #include <algorithm>					// min, max
 #include <fstream>
 #include <cmath>						// logf
 #include <limits>						// std::numeric_limits<float>::digits10
 											// std::numeric_limits<T>::min(), max()
+#include <utility>					// std::pair
+#include <iterator>					// std::back_inserter
+
+// Boost
+#include <boost/cstdint.hpp>			// boost::uint64_t
+#include <boost/unordered_map.hpp>	// boost::unordered_map
 
 // PCL
 #include <pcl/point_types.h>		// pcl::PointXYZ, pcl::Normal, pcl::PointNormal
@@ -25,6 +32,7 @@ using GP::LogFile;
 
 // GPMap
 #include "util/data_types.hpp"	// PointXYZCloud
+#include "util/morton.hpp"			// mortonEncode, mortonDecode
 #include "util/timer.hpp"			// Times
 #include "util/color_map.hpp"		// ColorMap
 #include "plsc/plsc.hpp"			// PLSC
@@ -82,6 +90,37 @@ void pcd2pc(const pcl::PointCloud<PointT>	&pointCloud,
 		pc.push_back(pointCloud.points[i].x, pointCloud.points[i].y, pointCloud.points[i].z);
 }
 
+/** @brief Pruning policy when the memory usage of an octomap exceeds its budget */
+enum OctoMapPruningPolicy
+{
+	OCTOMAP_PRUNE_LOSSLESS,								// prune identical children only
+	OCTOMAP_PRUNE_MAX_LIKELIHOOD_OUTSIDE_RECENT	// also convert leaves outside the recently updated region to max-likelihood
+};
+
+/** @brief Statistics of octomap updates */
+struct OctoMapUpdateStats
+{
+	/** @brief Constructor */
+	OctoMapUpdateStats()
+		: numUpdates(0),
+		  memoryUsage(0),
+		  numLeafNodes(0),
+		  numPrunings(0),
+		  numLossyPrunings(0),
+		  numMaxLikelihoodLeafNodes(0)
+	{
+		pruningTimes.clear();
+	}
+
+	size_t		numUpdates;						// number of updates
+	size_t		memoryUsage;					// memory usage after the last update [bytes]
+	size_t		numLeafNodes;					// number of leaf nodes after the last update
+	size_t		numPrunings;					// number of prunings due to the memory budget
+	size_t		numLossyPrunings;				// number of prunings which converted leaves to max-likelihood
+	size_t		numMaxLikelihoodLeafNodes;	// number of leaves converted to max-likelihood
+	CPU_Times	pruningTimes;					// accumulated time for pruning
+};
+
 class NO_COLOR {};
 class COLOR {};
 template <typename ColorT> struct OctomapType {};
@@ -93,13 +132,53 @@ class OctoMap
 {
 protected:
 	typedef typename OctomapType<ColorT>::OctomapT	MyOctomapT;
+
+	/** @brief	Key codes with their multiplicity */
+	typedef std::vector<boost::uint64_t>						KeyCodeList;
+	typedef std::pair<boost::uint64_t, unsigned int>	KeyCount;
+	typedef std::vector<KeyCount>								KeyCountList;
+
+	/** @brief	Key codes with point indices */
+	typedef std::pair<boost::uint64_t, size_t>			KeyIndex;
+	typedef std::vector<KeyIndex>								KeyIndexList;
+
+	/** @brief	Axis-aligned bounding box (min, max) */
+	typedef std::pair<octomap::point3d, octomap::point3d>	Region;
+	typedef std::deque<Region>										RegionList;
+
+	/** @brief	Key codes with log-odds values */
+	typedef std::pair<boost::uint64_t, float>				KeyValue;
+	typedef std::vector<KeyValue>								KeyValueList;
+
+	/** @brief	Chunk of rays of an observation */
+	struct RayChunk
+	{
+		size_t	scan;		// index of the observation
+		size_t	first;	// index of the first ray
+		size_t	last;		// one past the index of the last ray
+	};
+
+	/** @brief	GP cell traversed by the rays of the observations */
+	struct RayCell
+	{
+		size_t			index;			// index of the point in the GPMap
+		unsigned int	numFree;			// number of observations in which it is free
+		unsigned int	numOccupied;	// number of observations in which it is occupied
+	};
+	typedef std::vector<RayCell>	RayCellList;
 public:
 	/** @brief Constructor */
 	OctoMap(const double resolution,
 			  const bool	FLAG_SIMPLE_UPDATE = false)
 		:	m_resolution(resolution),
 			m_pOctree(new MyOctomapT(resolution)),
-			FLAG_SIMPLE_UPDATE_(FLAG_SIMPLE_UPDATE)
+			FLAG_SIMPLE_UPDATE_(FLAG_SIMPLE_UPDATE),
+			m_memoryBudget(500000000),
+			m_pruningPolicy(OCTOMAP_PRUNE_MAX_LIKELIHOOD_OUTSIDE_RECENT),
+			m_numRecentScans(10),
+			m_pruningTargetRatio(0.8f),
+			m_fTouchedAll(false),
+			m_memoryUsageAfterPruning(0)
 	{
 	}
 
@@ -109,10 +188,20 @@ public:
 			  const bool				FLAG_SIMPLE_UPDATE = false)
 		:	m_resolution(resolution),
 			m_pOctree(new MyOctomapT(resolution)),
-			FLAG_SIMPLE_UPDATE_(FLAG_SIMPLE_UPDATE)
+			FLAG_SIMPLE_UPDATE_(FLAG_SIMPLE_UPDATE),
+			m_memoryBudget(500000000),
+			m_pruningPolicy(OCTOMAP_PRUNE_MAX_LIKELIHOOD_OUTSIDE_RECENT),
+			m_numRecentScans(10),
+			m_pruningTargetRatio(0.8f),
+			m_fTouchedAll(false),
+			m_memoryUsageAfterPruning(0)
 	{
 		// load octomap
 		m_pOctree->readBinary(strFileName);
+
+		// the whole tree is touched
+		m_fTouchedAll = true;
+		m_memoryUsageAfterPruning = 0;
 	}
 
 	/** @brief			Constructor 
@@ -125,7 +214,13 @@ public:
 			  const bool											FLAG_SIMPLE_UPDATE = false)
 		:	m_resolution(resolution),
 			m_pOctree(new MyOctomapT(resolution)),
-			FLAG_SIMPLE_UPDATE_(FLAG_SIMPLE_UPDATE)
+			FLAG_SIMPLE_UPDATE_(FLAG_SIMPLE_UPDATE),
+			m_memoryBudget(500000000),
+			m_pruningPolicy(OCTOMAP_PRUNE_MAX_LIKELIHOOD_OUTSIDE_RECENT),
+			m_numRecentScans(10),
+			m_pruningTargetRatio(0.8f),
+			m_fTouchedAll(false),
+			m_memoryUsageAfterPruning(0)
 	{
 		GPMap2Octomap(pointCloudGPMap, maxVarThld, fSetLogOddValue);
 	}
@@ -142,7 +237,13 @@ public:
 			  const bool											FLAG_SIMPLE_UPDATE = false)
 		:	m_resolution(resolution),
 			m_pOctree(new MyOctomapT(resolution)),
-			FLAG_SIMPLE_UPDATE_(FLAG_SIMPLE_UPDATE)
+			FLAG_SIMPLE_UPDATE_(FLAG_SIMPLE_UPDATE),
+			m_memoryBudget(500000000),
+			m_pruningPolicy(OCTOMAP_PRUNE_MAX_LIKELIHOOD_OUTSIDE_RECENT),
+			m_numRecentScans(10),
+			m_pruningTargetRatio(0.8f),
+			m_fTouchedAll(false),
+			m_memoryUsageAfterPruning(0)
 	{
 		GPMap2Octomap(pointCloudGPMap, minVarRangeForColor, maxVarRangeForColor, maxVarThld, fSetLogOddValue);
 	}
@@ -163,6 +264,27 @@ public:
 		m_pOctree->updateNode(x, y, z, occupied, lazy_eval);
 	}
 
+	/** @brief		Update nodes of the octomap in bulk
+	  * @details	The keys are sorted in Morton order and inserted lazily,
+	  *				then the inner nodes are updated and pruned once.
+	  */
+	void updateNodes(const PointXYZVList &points, const bool occupied)
+	{
+		// keys in Morton order
+		KeyIndexList keyIndices;
+		keyIndices.reserve(points.size());
+		for(size_t i = 0; i < points.size(); i++)
+			addKeyIndex(points[i].x, points[i].y, points[i].z, i, keyIndices);
+		std::sort(keyIndices.begin(), keyIndices.end());
+
+		// lazy insertion
+		for(size_t i = 0; i < keyIndices.size(); i++)
+			m_pOctree->updateNode(codeKey(keyIndices[i].first), occupied, true);
+
+		// inner nodes
+		finishBulkInsertion();
+	}
+
 	/** @brief	Update the octomap with a point cloud
 	  * @return	Elapsed time (user/system/wall cpu times)
 	  */
@@ -180,6 +302,9 @@ public:
 		//	pc.push_back(pointCloud.points[i].x, pointCloud.points[i].y, pointCloud.points[i].z);
 		pcd2pc<PointT1>(pointCloud, pc);
 
+		// recently updated region
+		addRecentRegion(pc, robotPosition);
+
 		// timer - start
 		CPU_Timer timer;
 
@@ -191,20 +316,37 @@ public:
 		CPU_Times elapsed = timer.elapsed();
 
 		// memory
-		std::cout << "memory usage: "		<< m_pOctree->memoryUsage()		<< std::endl;
-		std::cout << "leaf node count: " << m_pOctree->getNumLeafNodes() << std::endl;
-		if(m_pOctree->memoryUsage() > 500000000) // 900000000
-		{
-			m_pOctree->toMaxLikelihood();
-			m_pOctree->prune();
-			std::cout << "after pruned - memory usage: "		<< m_pOctree->memoryUsage()		<< std::endl;
-			std::cout << "after pruned - leaf node count: " << m_pOctree->getNumLeafNodes() << std::endl;
-		}
+		enforceMemoryBudget();
 
 		// return the elapsed time
 		return elapsed;
 	}
 
+	/** @brief		Set the memory budget
+	  * @details	When the memory usage exceeds the budget after an update, the octree is pruned losslessly and then,
+	  *				if the policy allows and it is still above the target ratio of the budget, converted to max-likelihood
+	  *				down to the target, so that the next pruning is not triggered by the next update.
+	  *				The recently updated region is the bounding box of the last observations.
+	  *				A zero budget means unlimited.
+	  */
+	void setMemoryBudget(const size_t						memoryBudget,
+								const OctoMapPruningPolicy		pruningPolicy = OCTOMAP_PRUNE_MAX_LIKELIHOOD_OUTSIDE_RECENT,
+								const size_t						numRecentScans = 10,
+								const float							pruningTargetRatio = 0.8f)
+	{
+		m_memoryBudget				= memoryBudget;
+		m_pruningPolicy			= pruningPolicy;
+		m_numRecentScans			= numRecentScans;
+		m_pruningTargetRatio		= std::min<float>(std::max<float>(pruningTargetRatio, 0.f), 1.f);
+		while(m_recentRegions.size() > m_numRecentScans) m_recentRegions.pop_front();
+	}
+
+	/** @brief Statistics of the updates */
+	const OctoMapUpdateStats& getUpdateStats() const
+	{
+		return m_updateStats;
+	}
+
 	/** @brief	Save the octomap as a binary file */
 	bool save(const std::string &strFileNameWithoutExtension)
 	{
@@ -230,7 +372,11 @@ public:
 		return true;
 	}
 
-	/** @brief	Evaluate the octomap */
+	/** @brief		Evaluate the octomap
+	  * @details	The rays of the observations are traced in parallel chunks
+	  *				and the cells of each observation are counted in parallel with thread-local counters.
+	  *				The octree is only read, so the result is the same as the serial evaluation.
+	  */
 	template <typename PointT1, typename PointT2>
 	bool evaluate(const std::vector<typename pcl::PointCloud<PointT1>::Ptr>			&pHitPointCloudPtrList,
 					  const std::vector<PointT2, Eigen::aligned_allocator<PointT2> >	&sensorPositionList,
@@ -238,7 +384,8 @@ public:
 					  unsigned int		&num_voxels_correct,
 					  unsigned int		&num_voxels_wrong,
 					  unsigned int		&num_voxels_unknown,
-					  const double		maxrange = -1)
+					  const double		maxrange = -1,
+					  const size_t		chunkSize = 4096)
 	{
 		// check size
 		assert(pHitPointCloudPtrList.size() == sensorPositionList.size());
@@ -252,46 +399,37 @@ public:
 		num_voxels_wrong = 0;
 		num_voxels_unknown = 0;
 
-		// for each observation
-		for(size_t i = 0; i < pHitPointCloudPtrList.size(); i++)
+		// octree - read only
+		const MyOctomapT &octree = *m_pOctree;
+
+		// for each group of observations
+		std::vector<KeyCodeList> freeCodesList, occupiedCodesList;
+		size_t firstScan = 0;
+		while(firstScan < pHitPointCloudPtrList.size())
 		{
-			// robot position
-			octomap::point3d robotPosition(sensorPositionList[i].x, sensorPositionList[i].y, sensorPositionList[i].z);
-
-			// point cloud
-			num_points += pHitPointCloudPtrList[i]->size();
-			octomap::Pointcloud pc;
-			//for(size_t j = 0; j < pHitPointCloudPtrList[i]->size(); j++)
-			//	pc.push_back(pHitPointCloudPtrList[i]->points[j].x, pHitPointCloudPtrList[i]->points[i].y, pHitPointCloudPtrList[i]->points[j].z);
-			pcd2pc<PointT1>(*(pHitPointCloudPtrList[i]), pc);
-
-			// free/occupied cells
-			octomap::KeySet free_cells, occupied_cells;
-			m_pOctree->computeUpdate(pc, robotPosition, free_cells, occupied_cells, maxrange);
-			
-			// count free cells
-			for(octomap::KeySet::iterator it = free_cells.begin(); it != free_cells.end(); ++it)
-			{
-				octomap::OcTreeNode* n = m_pOctree->search(*it);
-				if(n)
-				{
-					if(m_pOctree->isNodeOccupied(n))	num_voxels_wrong++;
-					else										num_voxels_correct++;
-				}
-				else											num_voxels_unknown++;
-			}
-			
-			// count occupied cells
-			for(octomap::KeySet::iterator it = occupied_cells.begin(); it != occupied_cells.end(); ++it)
+			// free/occupied cells of each observation
+			const size_t lastScan = computeScanKeyCodes<PointT1, PointT2>(pHitPointCloudPtrList, sensorPositionList, firstScan, maxrange, chunkSize,
+																								freeCodesList, occupiedCodesList);
+
+			// count cells of each observation
+			unsigned int num_correct(0), num_wrong(0), num_unknown(0);
+			const int numScans = static_cast<int>(lastScan - firstScan);
+			#pragma omp parallel for schedule(dynamic) reduction(+:num_correct, num_wrong, num_unknown)
+			for(int i = 0; i < numScans; i++)
 			{
-				octomap::OcTreeNode* n = m_pOctree->search(*it);
-				if(n)
-				{
-					if(m_pOctree->isNodeOccupied(n))	num_voxels_correct++;
-					else										num_voxels_wrong++;
-				}
-				else											num_voxels_unknown++;
+				countCells(octree, freeCodesList[i],		false,	num_correct, num_wrong, num_unknown);
+				countCells(octree, occupiedCodesList[i],	true,		num_correct, num_wrong, num_unknown);
 			}
+
+			// reduce
+			num_voxels_correct	+= num_correct;
+			num_voxels_wrong		+= num_wrong;
+			num_voxels_unknown	+= num_unknown;
+			for(size_t i = firstScan; i < lastScan; i++)
+				num_points += pHitPointCloudPtrList[i]->size();
+
+			// next group
+			firstScan = lastScan;
 		}
 
 		return true;
@@ -356,6 +494,9 @@ public:
 		m_pSensorPositionList		= pSensorPositionList;
 		m_fTrainByMinimizingSumNegLogPredProb = false;
 
+		// ray-traversal keys do not depend on the PLSC hyperparameters
+		cacheRayCells(*m_pPointNormalCloudGPMap, *m_pHitPointCloudPtrList, *m_pSensorPositionList);
+
 		// conversion from PLSC hyperparameters to a Dlib vector
 		GP::DlibVector hypDlib;
 		hypDlib.set_size(2);
@@ -377,6 +518,10 @@ public:
 		// remove the GPMap
 		m_pPointNormalCloudGPMap.reset();
 
+		// remove the cache
+		RayCellList().swap(m_rayCells);
+		m_numRayCellsUnknown = 0;
+
 		return negEvalAccu;
 	}
 
@@ -429,14 +574,34 @@ public:
 		}
 
 		// negative accuracy (=correct/(correct+wrong)) from evaluation
+		// which is the same as evaluate() with an octomap from the GPMap, but with the cached keys
 
-		// octomap
-		OctoMap octomap(m_resolution, *m_pPointNormalCloudGPMap);
+		// occupancy threshold
+		const float occThresLog = static_cast<float>(m_pOctree->getOccupancyThresLog());
 
 		// evaluate
-		unsigned int num_points, num_voxels_correct, num_voxels_wrong, num_voxels_unknown;
-		octomap.evaluate<pcl::PointXYZ, pcl::PointXYZ>(*m_pHitPointCloudPtrList, *m_pSensorPositionList,
-																	  num_points, num_voxels_correct, num_voxels_wrong, num_voxels_unknown);
+		unsigned int num_voxels_correct(0), num_voxels_wrong(0);
+		for(size_t i = 0; i < m_rayCells.size(); i++)
+		{
+			// GP cell
+			const RayCell				&cell		= m_rayCells[i];
+			const pcl::PointNormal	&point	= m_pPointNormalCloudGPMap->points[cell.index];
+
+			// PLSC
+			const float occupied_probabiliy = PLSC::occupancy(point.normal_x, point.normal_y);
+
+			// count cells
+			if(logodd(occupied_probabiliy) >= occThresLog)
+			{
+				num_voxels_correct	+= cell.numOccupied;
+				num_voxels_wrong		+= cell.numFree;
+			}
+			else
+			{
+				num_voxels_correct	+= cell.numFree;
+				num_voxels_wrong		+= cell.numOccupied;
+			}
+		}
 
 		// negative accuracy
 		GP::DlibScalar neg_accuracy = -static_cast<GP::DlibScalar>(num_voxels_correct)/static_cast<GP::DlibScalar>(num_voxels_correct + num_voxels_wrong);
@@ -468,114 +633,195 @@ protected:
 		return logf(p/(1-p));
 	}
 
-protected:
-	/** @brief	Resolution */
-	const double m_resolution;
+	/** @brief		Add the bounding box of an observation to the recently updated region
+	  * @details	It is also added to the region touched since the last pruning.
+	  */
+	void addRecentRegion(const octomap::Pointcloud &pc, const octomap::point3d &robotPosition)
+	{
+		// no region
+		if(m_memoryBudget == 0 || m_pruningPolicy != OCTOMAP_PRUNE_MAX_LIKELIHOOD_OUTSIDE_RECENT) return;
 
-	/** @brief	OctoMap */
-	boost::shared_ptr<MyOctomapT>			m_pOctree;
+		// bounding box of the rays
+		Region region(robotPosition, robotPosition);
+		for(size_t i = 0; i < pc.size(); i++)
+		{
+			for(unsigned int j = 0; j < 3; j++)
+			{
+				region.first(j)	= std::min<float>(region.first(j),	pc[i](j));
+				region.second(j)	= std::max<float>(region.second(j),	pc[i](j));
+			}
+		}
 
-	/** @brief	Flag for simple update */
-	const bool FLAG_SIMPLE_UPDATE_;
+		// touched since the last pruning
+		if(!m_fTouchedAll) m_touchedRegions.push_back(region);
 
-	/** @brief	GPMap as a point cloud for training PLSC hyperparameters */
-	pcl::PointCloud<pcl::PointNormal>::ConstPtr	m_pPointNormalCloudGPMap;
+		// the last observations
+		if(m_numRecentScans == 0) return;
+		m_recentRegions.push_back(region);
+		while(m_recentRegions.size() > m_numRecentScans) m_recentRegions.pop_front();
+	}
 
-	/** @brief	Hit point cloud list for training PLSC hyperparameters */
-	PointXYZCloudPtrList	*m_pHitPointCloudPtrList;
+	/** @brief Check if a cube overlaps with the recently updated region */
+	bool isInRecentRegion(const octomap::point3d &center, const double size) const
+	{
+		const float HALF_SIZE = static_cast<float>(size / 2.0);
+		for(typename RegionList::const_iterator it = m_recentRegions.begin(); it != m_recentRegions.end(); ++it)
+		{
+			if(center(0) + HALF_SIZE >= it->first(0) && center(0) - HALF_SIZE <= it->second(0) &&
+				center(1) + HALF_SIZE >= it->first(1) && center(1) - HALF_SIZE <= it->second(1) &&
+				center(2) + HALF_SIZE >= it->first(2) && center(2) - HALF_SIZE <= it->second(2)) return true;
+		}
+		return false;
+	}
 
-	/** @brief	Sensor position list for training PLSC hyperparameters */
-	PointXYZVList			*m_pSensorPositionList;
+	/** @brief Collect a leaf to convert to max-likelihood */
+	template <typename LeafIterator>
+	inline void addMaxLikelihoodLeaf(const LeafIterator &it, KeyValueList &keyValues) const
+	{
+		// pruned leaves above the maximum depth are already compact, and setting them by a key would expand them
+		if(it.getDepth() < m_pOctree->getTreeDepth()) return;
 
-	/** @brief	How to training PLSC hyperparameters */
-	bool m_fTrainByMinimizingSumNegLogPredProb;
+		// at the threshold or in the recently updated region
+		if(m_pOctree->isNodeAtThreshold(*it) || isInRecentRegion(it.getCoordinate(), it.getSize())) return;
 
-	/** @brief	Whether to consider both occupied and empty cells or occupied cells only
-	  *			when training PLSC hyperparameters */
-	bool	m_fConsiderBothOccupiedAndEmpty;
-};
+		keyValues.push_back(KeyValue(keyCode(it.getKey()),
+											  m_pOctree->isNodeOccupied(*it) ? m_pOctree->getClampingThresMaxLog() : m_pOctree->getClampingThresMinLog()));
+	}
 
-/** @brief	Convert a GPMap to an Octree based on PLSC */
-template <>
-void OctoMap<NO_COLOR>::GPMap2Octomap(const pcl::PointCloud<pcl::PointNormal>		&pointCloudGPMap,
-												  const float											maxVarThld,
-												  const bool											fSetLogOddValue)
-{
-	// set logodd value
-	if(fSetLogOddValue)
+	/** @brief		Convert the leaves touched since the last pruning, but outside the recently updated region, to max-likelihood
+	  * @details	Only the leaves in the bounding boxes of the observations since the last pruning are visited,
+	  *				since the others have been visited by the previous pruning without any change after that.
+	  *				The leaves are set by non-lazy setNodeValue() which updates and prunes only their paths to the root,
+	  *				instead of updateInnerOccupancy() and prune() over the whole tree.
+	  *				The recently updated region stays touched, so its leaves are visited by the next pruning.
+	  * @return		Number of converted leaves
+	  */
+	size_t toMaxLikelihoodOutsideRecentRegion()
 	{
-		// for each point
-		for(size_t i = 0; i < pointCloudGPMap.points.size(); i++)
+		// leaves to convert
+		KeyValueList keyValues;
+		if(m_fTouchedAll)
 		{
-			// point
-			const pcl::PointNormal &point = pointCloudGPMap.points[i];
+			for(typename MyOctomapT::leaf_iterator it = m_pOctree->begin_leafs(), end = m_pOctree->end_leafs(); it != end; ++it)
+				addMaxLikelihoodLeaf(it, keyValues);
+		}
+		else
+		{
+			for(typename RegionList::const_iterator region = m_touchedRegions.begin(); region != m_touchedRegions.end(); ++region)
+				for(typename MyOctomapT::leaf_bbx_iterator it = m_pOctree->begin_leafs_bbx(region->first, region->second), end = m_pOctree->end_leafs_bbx(); it != end; ++it)
+					addMaxLikelihoodLeaf(it, keyValues);
+		}
 
-			// variance check
-			if(point.normal_y > maxVarThld) continue;
+		// overlapping regions
+		std::sort(keyValues.begin(), keyValues.end());
+		keyValues.erase(std::unique(keyValues.begin(), keyValues.end()), keyValues.end());
 
-			// PLSC
-			const float occupied_probabiliy = PLSC::occupancy(point.normal_x, point.normal_y);
+		// convert
+		for(size_t i = 0; i < keyValues.size(); i++)
+			m_pOctree->setNodeValue(codeKey(keyValues[i].first), keyValues[i].second, false);
 
-			// set logodd value
-			m_pOctree->setNodeValue(static_cast<double>(point.x),
-											static_cast<double>(point.y), 
-											static_cast<double>(point.z), 
-											logodd(occupied_probabiliy));
-		}
+		// still touched
+		m_fTouchedAll		= false;
+		m_touchedRegions	= m_recentRegions;
+
+		return keyValues.size();
 	}
-	else
+
+	/** @brief		Keep the memory usage within the budget
+	  * @details	The octree is first pruned losslessly.
+	  *				The lossless pruning visits the whole tree, so it runs again only when
+	  *				the memory usage has grown by the margin between the budget and the target since the last one.
+	  *				Under the max-likelihood policy, if the octree is still above the target below the budget,
+	  *				the leaves outside the recently updated region are converted to max-likelihood.
+	  *				Since the leaves in the recently updated region are kept as long as possible,
+	  *				only the stable parts of the map lose their probabilities.
+	  *				If the max-likelihood conversion does not reach the target,
+	  *				the oldest observations are removed from the recently updated region one by one.
+	  */
+	void enforceMemoryBudget()
 	{
-		// for each point
-		for(size_t i = 0; i < pointCloudGPMap.points.size(); i++)
-		{
-			// point
-			const pcl::PointNormal &point = pointCloudGPMap.points[i];
+		// statistics
+		m_updateStats.numUpdates++;
+		m_updateStats.memoryUsage	= m_pOctree->memoryUsage();
+		m_updateStats.numLeafNodes	= m_pOctree->getNumLeafNodes();
 
-			// variance check
-			if(point.normal_y > maxVarThld) continue;
+		// within the budget
+		if(m_memoryBudget == 0 || m_updateStats.memoryUsage <= m_memoryBudget) return;
 
-			// PLSC
-			const float occupied_probabiliy = PLSC::occupancy(point.normal_x, point.normal_y);
+		// target
+		const size_t target = static_cast<size_t>(static_cast<double>(m_memoryBudget) * m_pruningTargetRatio);
 
-			// if occupied
-			if(occupied_probabiliy > 0.5f)
-			{
-				// set occupied
-				m_pOctree->updateNode(static_cast<double>(point.x), 
-											 static_cast<double>(point.y), 
-											 static_cast<double>(point.z),
-											 true);
-			}
-			else
+		// timer - start
+		CPU_Timer timer;
+
+		// lossless pruning
+		if(m_memoryUsageAfterPruning == 0 || m_updateStats.memoryUsage > m_memoryUsageAfterPruning + (m_memoryBudget - target))
+		{
+			m_pOctree->prune();
+			m_updateStats.numPrunings++;
+			m_memoryUsageAfterPruning = m_pOctree->memoryUsage();
+		}
+
+		// max-likelihood outside the recently updated region, shrinking it until the target
+		if(m_pruningPolicy == OCTOMAP_PRUNE_MAX_LIKELIHOOD_OUTSIDE_RECENT && m_pOctree->memoryUsage() > target)
+		{
+			m_updateStats.numMaxLikelihoodLeafNodes += toMaxLikelihoodOutsideRecentRegion();
+			while(m_pOctree->memoryUsage() > target && !m_recentRegions.empty())
 			{
-				// set occupied
-				m_pOctree->updateNode(static_cast<double>(point.x), 
-											 static_cast<double>(point.y), 
-											 static_cast<double>(point.z),
-											 false);
+				m_recentRegions.pop_front();
+				m_updateStats.numMaxLikelihoodLeafNodes += toMaxLikelihoodOutsideRecentRegion();
 			}
+			m_updateStats.numPrunings++;
+			m_updateStats.numLossyPrunings++;
+			m_memoryUsageAfterPruning = m_pOctree->memoryUsage();
 		}
+
+		// timer - end
+		m_updateStats.pruningTimes += timer.elapsed();
+
+		// statistics
+		m_updateStats.memoryUsage	= m_pOctree->memoryUsage();
+		m_updateStats.numLeafNodes	= m_pOctree->getNumLeafNodes();
 	}
-}
 
-/** @brief	Convert a GPMap to a ColorOctree based on PLSC */
-template <>
-void OctoMap<COLOR>::GPMap2Octomap(const pcl::PointCloud<pcl::PointNormal>		&pointCloudGPMap,
-											  const float											maxVarThld,
-											  const bool											fSetLogOddValue)
-{
-	// get min, max
-	float minMean, maxMean, minVar, maxVar;
-	getMinMaxMeanVarOfOccupiedCells(pointCloudGPMap, minMean, maxMean, minVar, maxVar);
+	/** @brief		Key code of a cell
+	  * @details	It is the Morton code of the key whose order is the depth-first order of the octree,
+	  *				so sorted key codes visit the octree nodes coherently.
+	  */
+	static inline boost::uint64_t keyCode(const octomap::OcTreeKey &key)
+	{
+		return mortonEncode(key[0], key[1], key[2]);
+	}
 
-	// color map
-	ColorMap colorMap(minVar, maxVar);
-	unsigned char r, g, b;
+	/** @brief Key of a key code */
+	static inline octomap::OcTreeKey codeKey(const boost::uint64_t code)
+	{
+		unsigned int x, y, z;
+		mortonDecode(code, x, y, z);
+		return octomap::OcTreeKey(static_cast<octomap::key_type>(x),
+										  static_cast<octomap::key_type>(y),
+										  static_cast<octomap::key_type>(z));
+	}
 
-	// set logodd value
-	if(fSetLogOddValue)
+	/** @brief Append the key code of a point with its index */
+	inline void addKeyIndex(const float x, const float y, const float z, const size_t index, KeyIndexList &keyIndices) const
 	{
-		// for each point
+		octomap::OcTreeKey key;
+		if(m_pOctree->coordToKeyChecked(static_cast<double>(x),
+												  static_cast<double>(y),
+												  static_cast<double>(z), key))
+			keyIndices.push_back(KeyIndex(keyCode(key), index));
+	}
+
+	/** @brief		Key codes of the GPMap points in Morton order
+	  * @details	Points in the same cell keep their order.
+	  */
+	void sortKeys(const pcl::PointCloud<pcl::PointNormal>	&pointCloudGPMap,
+					  const float										maxVarThld,
+					  KeyIndexList										&keyIndices) const
+	{
+		keyIndices.clear();
+		keyIndices.reserve(pointCloudGPMap.points.size());
 		for(size_t i = 0; i < pointCloudGPMap.points.size(); i++)
 		{
 			// point
@@ -584,61 +830,387 @@ void OctoMap<COLOR>::GPMap2Octomap(const pcl::PointCloud<pcl::PointNormal>		&poi
 			// variance check
 			if(point.normal_y > maxVarThld) continue;
 
-			// PLSC
-			const float occupied_probabiliy = PLSC::occupancy(point.normal_x, point.normal_y);
+			// key
+			addKeyIndex(point.x, point.y, point.z, i, keyIndices);
+		}
+		std::sort(keyIndices.begin(), keyIndices.end());
+	}
 
-			// set logodd value
-			m_pOctree->setNodeValue(static_cast<double>(point.x),
-											static_cast<double>(point.y), 
-											static_cast<double>(point.z), 
-											logodd(occupied_probabiliy));
+	/** @brief Whether the next key is the same */
+	static inline bool isOverwritten(const KeyIndexList &keyIndices, const size_t i)
+	{
+		return i + 1 < keyIndices.size() && keyIndices[i + 1].first == keyIndices[i].first;
+	}
 
-			// color based on the variance
-			colorMap.rgb(point.normal_y, r, g, b);
+	/** @brief Update the inner nodes and prune after lazy insertions */
+	void finishBulkInsertion()
+	{
+		m_pOctree->updateInnerOccupancy();
+		m_pOctree->prune();
 
-			// set color
-			m_pOctree->setNodeColor(point.x, point.y, point.z, r, g, b);
-		}
+		// the whole tree is touched
+		m_fTouchedAll = true;
+		m_touchedRegions.clear();
+		m_memoryUsageAfterPruning = 0;
 	}
-	else
+
+	/** @brief Sort key codes and remove duplicates */
+	static inline void sortUnique(KeyCodeList &codes)
 	{
-		// for each point
-		for(size_t i = 0; i < pointCloudGPMap.points.size(); i++)
+		std::sort(codes.begin(), codes.end());
+		codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+	}
+
+	/** @brief Count correct, wrong and unknown cells of an observation */
+	static void countCells(const MyOctomapT		&octree,
+								  const KeyCodeList		&codes,
+								  const bool				fOccupied,
+								  unsigned int				&num_voxels_correct,
+								  unsigned int				&num_voxels_wrong,
+								  unsigned int				&num_voxels_unknown)
+	{
+		for(size_t i = 0; i < codes.size(); i++)
 		{
-			// point
-			const pcl::PointNormal &point = pointCloudGPMap.points[i];
+			const typename MyOctomapT::NodeType *n = octree.search(codeKey(codes[i]));
+			if(n)
+			{
+				if(octree.isNodeOccupied(n) == fOccupied)	num_voxels_correct++;
+				else													num_voxels_wrong++;
+			}
+			else														num_voxels_unknown++;
+		}
+	}
 
-			// variance check
-			if(point.normal_y > maxVarThld) continue;
+	/** @brief		Free and occupied key codes of a chunk of rays
+	  * @details	It is the same as computeUpdate() of octomap before the free cells are made disjoint from the occupied ones,
+	  *				but it only reads the octree with its own key ray, so it is thread-safe.
+	  */
+	template <typename PointT>
+	void computeRayKeyCodes(const pcl::PointCloud<PointT>	&pointCloud,
+									const size_t							first,
+									const size_t							last,
+									const octomap::point3d				&origin,
+									const double							maxrange,
+									octomap::KeyRay						&keyray,
+									KeyCodeList								&freeCodes,
+									KeyCodeList								&occupiedCodes) const
+	{
+		// octree - read only
+		const MyOctomapT &octree = *m_pOctree;
 
-			// PLSC
-			const float occupied_probabiliy = PLSC::occupancy(point.normal_x, point.normal_y);
+		// for each ray
+		octomap::OcTreeKey key;
+		for(size_t i = first; i < last; i++)
+		{
+			// end point
+			const octomap::point3d point(pointCloud.points[i].x, pointCloud.points[i].y, pointCloud.points[i].z);
 
-			// if occupied
-			if(occupied_probabiliy > 0.5f)
+			// within the range
+			if(maxrange < 0.0 || (point - origin).norm() <= maxrange)
 			{
-				// set occupied
-				m_pOctree->updateNode(static_cast<double>(point.x), 
-											 static_cast<double>(point.y), 
-											 static_cast<double>(point.z),
-											 true);
+				// free cells
+				if(octree.computeRayKeys(origin, point, keyray))
+					for(typename octomap::KeyRay::const_iterator it = keyray.begin(); it != keyray.end(); ++it)
+						freeCodes.push_back(keyCode(*it));
+
+				// occupied end point
+				if(octree.coordToKeyChecked(point, key))
+					occupiedCodes.push_back(keyCode(key));
 			}
+
+			// out of the range
 			else
 			{
-				// set occupied
-				m_pOctree->updateNode(static_cast<double>(point.x), 
-											 static_cast<double>(point.y), 
-											 static_cast<double>(point.z),
-											 false);
+				// free cells up to the range
+				const octomap::point3d newEnd = origin + (point - origin).normalized() * static_cast<float>(maxrange);
+				if(octree.computeRayKeys(origin, newEnd, keyray))
+					for(typename octomap::KeyRay::const_iterator it = keyray.begin(); it != keyray.end(); ++it)
+						freeCodes.push_back(keyCode(*it));
 			}
+		}
 
-			// color based on the variance
-			colorMap.rgb(point.normal_y, r, g, b);
+		// sort
+		sortUnique(freeCodes);
+		sortUnique(occupiedCodes);
+	}
 
-			// set color
-			m_pOctree->setNodeColor(point.x, point.y, point.z, r, g, b);
+	/** @brief		Free and occupied key codes of a group of observations
+	  * @details	The observations from firstScan are grouped until the number of rays reaches a bound
+	  *				so that the memory for the key codes is bounded.
+	  *				The rays are split into chunks which are traced in parallel,
+	  *				then the chunks of each observation are merged in parallel.
+	  *				As in computeUpdate() of octomap, the free cells of an observation are disjoint from the occupied ones.
+	  * @return		One past the last observation of the group
+	  */
+	template <typename PointT1, typename PointT2>
+	size_t computeScanKeyCodes(const std::vector<typename pcl::PointCloud<PointT1>::Ptr>			&pHitPointCloudPtrList,
+										const std::vector<PointT2, Eigen::aligned_allocator<PointT2> >	&sensorPositionList,
+										const size_t				firstScan,
+										const double				maxrange,
+										const size_t				chunkSize,
+										std::vector<KeyCodeList>	&freeCodesList,
+										std::vector<KeyCodeList>	&occupiedCodesList) const
+	{
+		// maximum number of rays in a group
+		const size_t maxNumRays = 256 * std::max<size_t>(chunkSize, 1);
+
+		// group of observations and chunks of rays
+		std::vector<RayChunk>	chunks;
+		std::vector<size_t>		firstChunks;
+		size_t lastScan(firstScan), numRays(0);
+		while(lastScan < pHitPointCloudPtrList.size() &&
+				(lastScan == firstScan || numRays + pHitPointCloudPtrList[lastScan]->size() <= maxNumRays))
+		{
+			const size_t N = pHitPointCloudPtrList[lastScan]->size();
+			firstChunks.push_back(chunks.size());
+			for(size_t first = 0; first < N; first += std::max<size_t>(chunkSize, 1))
+			{
+				RayChunk chunk = {lastScan, first, std::min<size_t>(first + std::max<size_t>(chunkSize, 1), N)};
+				chunks.push_back(chunk);
+			}
+			numRays += N;
+			lastScan++;
+		}
+		firstChunks.push_back(chunks.size());
+		const int numScans	= static_cast<int>(lastScan - firstScan);
+		const int numChunks	= static_cast<int>(chunks.size());
+
+		// key codes of each chunk
+		std::vector<KeyCodeList> chunkFreeCodesList(chunks.size()), chunkOccupiedCodesList(chunks.size());
+		#pragma omp parallel
+		{
+			// thread-local key ray
+			octomap::KeyRay keyray;
+
+			#pragma omp for schedule(dynamic)
+			for(int c = 0; c < numChunks; c++)
+			{
+				const RayChunk &chunk	= chunks[c];
+				const PointT2 &sensor	= sensorPositionList[chunk.scan];
+				computeRayKeyCodes<PointT1>(*(pHitPointCloudPtrList[chunk.scan]), chunk.first, chunk.last,
+													 octomap::point3d(sensor.x, sensor.y, sensor.z), maxrange, keyray,
+													 chunkFreeCodesList[c], chunkOccupiedCodesList[c]);
+			}
+		}
+
+		// merge the chunks of each observation
+		freeCodesList.resize(numScans);
+		occupiedCodesList.resize(numScans);
+		#pragma omp parallel for schedule(dynamic)
+		for(int i = 0; i < numScans; i++)
+		{
+			// merge
+			KeyCodeList freeCodes, occupiedCodes;
+			for(size_t c = firstChunks[i]; c < firstChunks[i + 1]; c++)
+			{
+				freeCodes.insert(freeCodes.end(), chunkFreeCodesList[c].begin(), chunkFreeCodesList[c].end());
+				occupiedCodes.insert(occupiedCodes.end(), chunkOccupiedCodesList[c].begin(), chunkOccupiedCodesList[c].end());
+				KeyCodeList().swap(chunkFreeCodesList[c]);
+				KeyCodeList().swap(chunkOccupiedCodesList[c]);
+			}
+			if(firstChunks[i + 1] - firstChunks[i] > 1)
+			{
+				sortUnique(freeCodes);
+				sortUnique(occupiedCodes);
+			}
+
+			// prefer occupied cells over free ones
+			freeCodesList[i].clear();
+			std::set_difference(freeCodes.begin(), freeCodes.end(), occupiedCodes.begin(), occupiedCodes.end(),
+									  std::back_inserter(freeCodesList[i]));
+			occupiedCodesList[i].swap(occupiedCodes);
 		}
+
+		return lastScan;
 	}
+
+	/** @brief		Free and occupied cells of all observations with their multiplicity
+	  * @details	Each list is sorted by the key code.
+	  *				A cell is counted once per observation as in evaluate().
+	  */
+	void computeRayKeyCounts(const PointXYZCloudPtrList	&hitPointCloudPtrList,
+									 const PointXYZVList			&sensorPositionList,
+									 KeyCountList					&freeKeyCounts,
+									 KeyCountList					&occupiedKeyCounts,
+									 const double					maxrange = -1)
+	{
+		// check size
+		assert(hitPointCloudPtrList.size() == sensorPositionList.size());
+
+		// counts
+		typedef boost::unordered_map<boost::uint64_t, unsigned int> KeyCountMap;
+		KeyCountMap freeKeyCountMap, occupiedKeyCountMap;
+
+		// for each group of observations
+		std::vector<KeyCodeList> freeCodesList, occupiedCodesList;
+		size_t firstScan = 0;
+		while(firstScan < hitPointCloudPtrList.size())
+		{
+			// free/occupied cells of each observation
+			const size_t lastScan = computeScanKeyCodes<pcl::PointXYZ, pcl::PointXYZ>(hitPointCloudPtrList, sensorPositionList, firstScan, maxrange, 4096,
+																											 freeCodesList, occupiedCodesList);
+
+			// count
+			for(size_t i = 0; i < lastScan - firstScan; i++)
+			{
+				for(size_t j = 0; j < freeCodesList[i].size(); j++)			freeKeyCountMap[freeCodesList[i][j]]++;
+				for(size_t j = 0; j < occupiedCodesList[i].size(); j++)		occupiedKeyCountMap[occupiedCodesList[i][j]]++;
+			}
+
+			// next group
+			firstScan = lastScan;
+		}
+
+		// sorted lists
+		freeKeyCounts.assign(freeKeyCountMap.begin(), freeKeyCountMap.end());
+		occupiedKeyCounts.assign(occupiedKeyCountMap.begin(), occupiedKeyCountMap.end());
+		std::sort(freeKeyCounts.begin(), freeKeyCounts.end());
+		std::sort(occupiedKeyCounts.begin(), occupiedKeyCounts.end());
+	}
+
+	/** @brief		Cache the GP cells traversed by the rays of all observations
+	  * @details	The free and occupied keys depend only on the observations, not on the PLSC hyperparameters,
+	  *				so they are computed once and joined with the cells of the GPMap.
+	  *				As in GPMap2Octomap(), the last point in a cell determines its occupancy.
+	  *				Keys without any GP point are unknown regardless of PLSC.
+	  */
+	void cacheRayCells(const pcl::PointCloud<pcl::PointNormal>	&pointCloudGPMap,
+							 const PointXYZCloudPtrList					&hitPointCloudPtrList,
+							 const PointXYZVList								&sensorPositionList,
+							 const double										maxrange = -1)
+	{
+		// free/occupied keys
+		KeyCountList freeKeyCounts, occupiedKeyCounts;
+		computeRayKeyCounts(hitPointCloudPtrList, sensorPositionList, freeKeyCounts, occupiedKeyCounts, maxrange);
+
+		// GP cells sorted by the key code and then the point index
+		KeyIndexList gpKeyIndices;
+		sortKeys(pointCloudGPMap, std::numeric_limits<float>::max(), gpKeyIndices);
+
+		// merge join
+		m_rayCells.clear();
+		m_numRayCellsUnknown = 0;
+		size_t f(0), o(0), g(0);
+		while(f < freeKeyCounts.size() || o < occupiedKeyCounts.size())
+		{
+			// next key
+			boost::uint64_t code;
+			if(f >= freeKeyCounts.size())					code = occupiedKeyCounts[o].first;
+			else if(o >= occupiedKeyCounts.size())		code = freeKeyCounts[f].first;
+			else	code = std::min<boost::uint64_t>(freeKeyCounts[f].first, occupiedKeyCounts[o].first);
+
+			// multiplicity
+			const unsigned int numFree		= (f < freeKeyCounts.size()		&& freeKeyCounts[f].first		== code) ? freeKeyCounts[f++].second		: 0;
+			const unsigned int numOccupied	= (o < occupiedKeyCounts.size()	&& occupiedKeyCounts[o].first	== code) ? occupiedKeyCounts[o++].second	: 0;
+
+			// GP cell
+			while(g < gpKeyIndices.size() && gpKeyIndices[g].first < code) g++;
+			if(g < gpKeyIndices.size() && gpKeyIndices[g].first == code)
+			{
+				// last point in the cell
+				while(g + 1 < gpKeyIndices.size() && gpKeyIndices[g + 1].first == code) g++;
+				RayCell cell = {gpKeyIndices[g].second, numFree, numOccupied};
+				m_rayCells.push_back(cell);
+			}
+			else	m_numRayCellsUnknown += numFree + numOccupied;
+		}
+
+		// log
+		LogFile logFile;
+		logFile << "Ray cells: " << m_rayCells.size() << " known cells (" << freeKeyCounts.size() << " free, " << occupiedKeyCounts.size() << " occupied keys), "
+				  << m_numRayCellsUnknown << " unknown" << std::endl;
+	}
+
+protected:
+	/** @brief	Resolution */
+	const double m_resolution;
+
+	/** @brief	OctoMap */
+	boost::shared_ptr<MyOctomapT>			m_pOctree;
+
+	/** @brief	Flag for simple update */
+	const bool FLAG_SIMPLE_UPDATE_;
+
+	/** @brief	Memory budget in bytes, zero for unlimited */
+	size_t						m_memoryBudget;
+
+	/** @brief	Pruning policy when the memory usage exceeds the budget */
+	OctoMapPruningPolicy		m_pruningPolicy;
+
+	/** @brief	Number of the last observations in the recently updated region */
+	size_t						m_numRecentScans;
+
+	/** @brief	Bounding boxes of the last observations */
+	RegionList					m_recentRegions;
+
+	/** @brief	Target of pruning relative to the memory budget */
+	float							m_pruningTargetRatio;
+
+	/** @brief	Bounding boxes of the observations since the last pruning, or the whole tree after bulk insertions */
+	RegionList					m_touchedRegions;
+	bool							m_fTouchedAll;
+
+	/** @brief	Memory usage after the last lossless pruning */
+	size_t						m_memoryUsageAfterPruning;
+
+	/** @brief	Statistics of the updates */
+	OctoMapUpdateStats		m_updateStats;
+
+	/** @brief	GPMap as a point cloud for training PLSC hyperparameters */
+	pcl::PointCloud<pcl::PointNormal>::ConstPtr	m_pPointNormalCloudGPMap;
+
+	/** @brief	Hit point cloud list for training PLSC hyperparameters */
+	PointXYZCloudPtrList	*m_pHitPointCloudPtrList;
+
+	/** @brief	Sensor position list for training PLSC hyperparameters */
+	PointXYZVList			*m_pSensorPositionList;
+
+	/** @brief	Cached GP cells traversed by the rays for training PLSC hyperparameters */
+	RayCellList				m_rayCells;
+
+	/** @brief	Number of cached free/occupied keys without GP cells */
+	unsigned int			m_numRayCellsUnknown;
+
+	/** @brief	How to training PLSC hyperparameters */
+	bool m_fTrainByMinimizingSumNegLogPredProb;
+
+	/** @brief	Whether to consider both occupied and empty cells or occupied cells only
+	  *			when training PLSC hyperparameters */
+	bool	m_fConsiderBothOccupiedAndEmpty;
+};
+
+/** @brief	Convert a GPMap to an Octree based on PLSC */
+template <>
+void OctoMap<NO_COLOR>::GPMap2Octomap(const pcl::PointCloud<pcl::PointNormal>		&pointCloudGPMap,
+												  const float											maxVarThld,
+												  const bool											fSetLogOddValue)
+{
+	// keys in Morton order
+	KeyIndexList keyIndices;
+	sortKeys(pointCloudGPMap, maxVarThld, keyIndices);
+
+	// for each point
+	for(size_t i = 0; i < keyIndices.size(); i++)
+	{
+		// the last value in a cell is set
+		if(fSetLogOddValue && isOverwritten(keyIndices, i)) continue;
+
+		// point
+		const octomap::OcTreeKey	key	= codeKey(keyIndices[i].first);
+		const pcl::PointNormal		&point	= pointCloudGPMap.points[keyIndices[i].second];
+
+		// PLSC
+		const float occupied_probabiliy = PLSC::occupancy(point.normal_x, point.normal_y);
+
+		// set logodd value
+		if(fSetLogOddValue)	m_pOctree->setNodeValue(key, logodd(occupied_probabiliy), true);
+
+		// set occupied or empty
+		else						m_pOctree->updateNode(key, occupied_probabiliy > 0.5f, true);
+	}
+
+	// inner nodes
+	finishBulkInsertion();
 }
 
 /** @brief	Convert a GPMap to a ColorOctree based on PLSC */
@@ -653,74 +1225,52 @@ void OctoMap<COLOR>::GPMap2Octomap(const pcl::PointCloud<pcl::PointNormal>		&poi
 	ColorMap colorMap(minVarRangeForColor, maxVarRangeForColor);
 	unsigned char r, g, b;
 
-	// set logodd value
-	if(fSetLogOddValue)
+	// keys in Morton order
+	KeyIndexList keyIndices;
+	sortKeys(pointCloudGPMap, maxVarThld, keyIndices);
+
+	// for each point
+	for(size_t i = 0; i < keyIndices.size(); i++)
 	{
-		// for each point
-		for(size_t i = 0; i < pointCloudGPMap.points.size(); i++)
-		{
-			// point
-			const pcl::PointNormal &point = pointCloudGPMap.points[i];
+		// the last value and color in a cell are set
+		if(fSetLogOddValue && isOverwritten(keyIndices, i)) continue;
 
-			// variance check
-			if(point.normal_y > maxVarThld) continue;
+		// point
+		const octomap::OcTreeKey	key	= codeKey(keyIndices[i].first);
+		const pcl::PointNormal		&point	= pointCloudGPMap.points[keyIndices[i].second];
 
-			// PLSC
-			const float occupied_probabiliy = PLSC::occupancy(point.normal_x, point.normal_y);
+		// PLSC
+		const float occupied_probabiliy = PLSC::occupancy(point.normal_x, point.normal_y);
 
-			// set logodd value
-			m_pOctree->setNodeValue(static_cast<double>(point.x),
-											static_cast<double>(point.y), 
-											static_cast<double>(point.z), 
-											logodd(occupied_probabiliy));
+		// set logodd value
+		if(fSetLogOddValue)	m_pOctree->setNodeValue(key, logodd(occupied_probabiliy), true);
 
+		// set occupied or empty
+		else						m_pOctree->updateNode(key, occupied_probabiliy > 0.5f, true);
 
-			// color based on the variance
-			colorMap.rgb(point.normal_y, r, g, b);
+		// color based on the variance
+		colorMap.rgb(point.normal_y, r, g, b);
 
-			// set color
-			m_pOctree->setNodeColor(point.x, point.y, point.z, r, g, b);
-		}
+		// set color
+		m_pOctree->setNodeColor(key, r, g, b);
 	}
-	else
-	{
-		// for each point
-		for(size_t i = 0; i < pointCloudGPMap.points.size(); i++)
-		{
-			// point
-			const pcl::PointNormal &point = pointCloudGPMap.points[i];
-
-			// variance check
-			if(point.normal_y > maxVarThld) continue;
 
-			// PLSC
-			const float occupied_probabiliy = PLSC::occupancy(point.normal_x, point.normal_y);
-
-			// if occupied
-			if(occupied_probabiliy > 0.5f)
-			{
-				// set occupied
-				m_pOctree->updateNode(static_cast<double>(point.x), 
-											 static_cast<double>(point.y), 
-											 static_cast<double>(point.z),
-											 true);
-			}
-			else
-			{
-				// set empty
-				m_pOctree->updateNode(static_cast<double>(point.x), 
-											 static_cast<double>(point.y), 
-											 static_cast<double>(point.z),
-											 false);
-			}
+	// inner nodes
+	finishBulkInsertion();
+}
 
-			// color based on the variance
-			colorMap.rgb(point.normal_y, r, g, b);
+/** @brief	Convert a GPMap to a ColorOctree based on PLSC */
+template <>
+void OctoMap<COLOR>::GPMap2Octomap(const pcl::PointCloud<pcl::PointNormal>		&pointCloudGPMap,
+											  const float											maxVarThld,
+											  const bool											fSetLogOddValue)
+{
+	// get min, max
+	float minMean, maxMean, minVar, maxVar;
+	getMinMaxMeanVarOfOccupiedCells(pointCloudGPMap, minMean, maxMean, minVar, maxVar);
 
-			// set color
-			m_pOctree->setNodeColor(point.x, point.y, point.z, r, g, b);
-		}
-	}
+	// color map from the variance range of the occupied cells
+	GPMap2Octomap(pointCloudGPMap, minVar, maxVar, maxVarThld, fSetLogOddValue);
 }
 
 }
@@ -0,0 +1,117 @@
+#ifndef _GPMAP_BLOCK_STATISTICS_HPP_
+#define _GPMAP_BLOCK_STATISTICS_HPP_
+
+// STL
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>		// std::sort
+#include <cmath>			// ceil
+
+// Boost
+#include <boost/cstdint.hpp>		// boost::uint64_t
+
+namespace GPMap {
+
+/** @brief		Cost of predicting a block in OctreeGPMap::update() */
+struct BlockStatistics
+{
+	boost::uint64_t	code;						// Morton code in the global grid
+	unsigned int		keyX, keyY, keyZ;		// octree key
+	boost::uint64_t	numPoints;				// number of points of the block and its neighbors
+	boost::uint64_t	numFuncObs;				// Nf
+	boost::uint64_t	numDerObs;				// Nd
+	boost::uint64_t	numPartitions;			// 1 if not partitioned
+	boost::uint64_t	numCholeskyRetries;	// jittered refactorizations while combining
+	boost::uint64_t	train_ns;
+	boost::uint64_t	predict_ns;
+	boost::uint64_t	combine_ns;
+};
+
+/** @brief		Order statistics of a field over blocks */
+struct BlockStatisticsSummary
+{
+	boost::uint64_t p50;
+	boost::uint64_t p95;
+	boost::uint64_t p99;
+	boost::uint64_t max;
+};
+
+/** @brief		Per-block statistics of an update */
+class BlockStatisticsList : public std::vector<BlockStatistics>
+{
+public:
+	/** @brief		Percentiles and the maximum of a field
+	  * @details	Nearest-rank percentiles, for example summary(&BlockStatistics::predict_ns).
+	  */
+	BlockStatisticsSummary summary(boost::uint64_t BlockStatistics::*field) const
+	{
+		BlockStatisticsSummary s = {0, 0, 0, 0};
+		if(empty()) return s;
+
+		// sort the values
+		std::vector<boost::uint64_t> values(size());
+		for(size_t i = 0; i < size(); i++) values[i] = (*this)[i].*field;
+		std::sort(values.begin(), values.end());
+
+		// nearest rank
+		s.p50 = values[rank(0.50, values.size())];
+		s.p95 = values[rank(0.95, values.size())];
+		s.p99 = values[rank(0.99, values.size())];
+		s.max = values.back();
+		return s;
+	}
+
+	/** @brief Save as a CSV file with one row per block */
+	bool saveAsCSV(const std::string &strFilePath) const
+	{
+		std::ofstream fout(strFilePath.c_str());
+		if(!fout) return false;
+
+		fout << "code,key_x,key_y,key_z,num_points,nf,nd,num_partitions,cholesky_retries,train_ns,predict_ns,combine_ns" << std::endl;
+		for(size_t i = 0; i < size(); i++)
+		{
+			const BlockStatistics &b = (*this)[i];
+			fout << b.code << "," << b.keyX << "," << b.keyY << "," << b.keyZ << ","
+				  << b.numPoints << "," << b.numFuncObs << "," << b.numDerObs << ","
+				  << b.numPartitions << "," << b.numCholeskyRetries << ","
+				  << b.train_ns << "," << b.predict_ns << "," << b.combine_ns << std::endl;
+		}
+		return true;
+	}
+
+	/** @brief Save the summaries of the cost fields as a CSV file */
+	bool saveSummaryAsCSV(const std::string &strFilePath) const
+	{
+		std::ofstream fout(strFilePath.c_str());
+		if(!fout) return false;
+
+		fout << "field,p50,p95,p99,max" << std::endl;
+		writeSummary(fout, "num_points",			summary(&BlockStatistics::numPoints));
+		writeSummary(fout, "num_partitions",	summary(&BlockStatistics::numPartitions));
+		writeSummary(fout, "cholesky_retries",	summary(&BlockStatistics::numCholeskyRetries));
+		writeSummary(fout, "train_ns",			summary(&BlockStatistics::train_ns));
+		writeSummary(fout, "predict_ns",			summary(&BlockStatistics::predict_ns));
+		writeSummary(fout, "combine_ns",			summary(&BlockStatistics::combine_ns));
+		return true;
+	}
+
+	/** @brief Write a summary */
+	template <typename StreamT>
+	static void writeSummary(StreamT &out, const char *name, const BlockStatisticsSummary &s)
+	{
+		out << name << "," << s.p50 << "," << s.p95 << "," << s.p99 << "," << s.max << std::endl;
+	}
+
+protected:
+	/** @brief Index of the nearest-rank percentile */
+	static size_t rank(const double percentile, const size_t n)
+	{
+		const size_t r = static_cast<size_t>(ceil(percentile * static_cast<double>(n)));
+		return r > 0 ? r - 1 : 0;
+	}
+};
+
+}
+
+#endif
@@ -2,10 +2,12 @@
 #define _DATA_PARTITIONING_HPP_
 
 // STL
+#include <cassert>		// assert
 #include <cmath>			// floor, ceil
 #include <limits>			// std::numeric_limits<T>::min(), max()
-#include <algorithm>		// std::min(), max(),  std::random_shuffle
+#include <algorithm>		// std::min(), max()
 #include <vector>			// std::vector
+#include <iterator>		// std::distance
 
 // PCL
 //#include <pcl/point_types.h>
@@ -13,6 +15,11 @@
 #include <pcl/octree/octree.h>			// OctreePointCloudDensity
 #include <pcl/octree/octree_impl.h>
 
+// GPMap
+#include "util/random.hpp"			// RandomGenerator, RandomStreams, fisher_yates_shuffle, random_unique, floyd_sampling
+#include "util/trace.hpp"			// GPMAP_TRACE_ZONE
+#include "util/memory_usage.hpp"	// heapMemoryUsage
+
 namespace GPMap {
 
 /** \brief @b Octree pointcloud density leaf node class
@@ -110,9 +117,12 @@ protected:
 	int m_currVal;
 };
 
+/** @brief	Randomly partition indices into subsets of which size is at most M */
+template <typename RandomGeneratorT>
 bool random_data_partition(const std::vector<int>				&indices,
 									const int								M, // maximum limit of the number of points in a leaf node of an octree
 									std::vector<std::vector<int> >	&partitionedIndices,
+									RandomGeneratorT						&rng,
 									const bool								fSuffling = true)
 {
 	// if the maximum limit is less or equal to zero, do not divide!
@@ -124,7 +134,7 @@ bool random_data_partition(const std::vector<int>				&indices,
 
 	// suffled indices
 	std::vector<int> suffledIndices(indices);
-	if(fSuffling) std::random_shuffle(suffledIndices.begin(), suffledIndices.end());
+	if(fSuffling) fisher_yates_shuffle(suffledIndices.begin(), suffledIndices.end(), rng);
 
 	// partitioning
 	partitionedIndices.clear();
@@ -142,9 +152,22 @@ bool random_data_partition(const std::vector<int>				&indices,
 	return true;
 }
 
+/** @brief	Randomly partition indices into subsets of which size is at most M with the default random stream */
+bool random_data_partition(const std::vector<int>				&indices,
+									const int								M, // maximum limit of the number of points in a leaf node of an octree
+									std::vector<std::vector<int> >	&partitionedIndices,
+									const bool								fSuffling = true)
+{
+	RandomGenerator rng;
+	return random_data_partition(indices, M, partitionedIndices, rng, fSuffling);
+}
+
+/** @brief	Randomly sample M indices */
+template <typename RandomGeneratorT>
 bool random_sampling(const std::vector<int>				&indices,
 							const int								M, // maximum limit of the number of points in a leaf node of an octree
 							std::vector<int>						&randomSampleIndices,
+							RandomGeneratorT						&rng,
 							const bool								fSuffling = true)
 {
 	// if the maximum limit is less or equal to zero, do not divide!
@@ -156,7 +179,7 @@ bool random_sampling(const std::vector<int>				&indices,
 
 	// suffled indices
 	std::vector<int> suffledIndices(indices);
-	if(fSuffling) std::random_shuffle(suffledIndices.begin(), suffledIndices.end());
+	if(fSuffling) random_unique(suffledIndices.begin(), suffledIndices.end(), static_cast<size_t>(M), rng);
 
 	// copy
 	randomSampleIndices.resize(M);
@@ -165,21 +188,165 @@ bool random_sampling(const std::vector<int>				&indices,
 	return true;
 }
 
+/** @brief	Randomly sample M indices with the default random stream */
+bool random_sampling(const std::vector<int>				&indices,
+							const int								M, // maximum limit of the number of points in a leaf node of an octree
+							std::vector<int>						&randomSampleIndices,
+							const bool								fSuffling = true)
+{
+	RandomGenerator rng;
+	return random_sampling(indices, M, randomSampleIndices, rng, fSuffling);
+}
+
+/** @brief		Reusable buffer for random data partitioning and sampling
+  * @details	Indices are copied once into the buffer and shuffled in place,
+  *				then each partition is handed out as an iterator range into the buffer.
+  *				Since the buffer keeps its capacity, repeated calls do not allocate memory after warming up.
+  *				Each worker thread should own its buffer and random number generator.
+  */
+class PartitionBuffer
+{
+public:
+	typedef std::vector<int>::const_iterator		const_iterator;
+
+public:
+	/** @brief Constructor */
+	PartitionBuffer()
+		: m_M(0), m_numPartitions(0)
+	{
+	}
+
+	/** @brief		Randomly partition indices into subsets of which size is at most M
+	  * @return		False if no partitioning is needed (M <= 0 or N <= M)
+	  */
+	template <typename IndexIterator, typename RandomGeneratorT>
+	bool partition(IndexIterator					first,
+						IndexIterator					last,
+						const int						M, // maximum limit of the number of points in a leaf node of an octree
+						RandomGeneratorT				&rng,
+						const bool						fSuffling = true)
+	{
+		GPMAP_TRACE_ZONE("partition");
+
+		// reset
+		m_numPartitions = 0;
+
+		// if the maximum limit is less or equal to zero, do not divide!
+		if(M <= 0) return false;
+
+		// size
+		const size_t N = static_cast<size_t>(std::distance(first, last));
+		if(N <= static_cast<size_t>(M)) return false;
+
+		// suffled indices
+		m_buffer.assign(first, last);
+		if(fSuffling) fisher_yates_shuffle(m_buffer.begin(), m_buffer.end(), rng);
+
+		// partitions
+		m_M					= static_cast<size_t>(M);
+		m_numPartitions	= (N + m_M - 1) / m_M;
+
+		return true;
+	}
+
+	/** @brief		Randomly sample M indices
+	  * @details	Only the first M indices are shuffled (partial Fisher-Yates shuffle),
+	  *				and the samples are handed out as the only partition.
+	  * @return		False if no sampling is needed (M <= 0 or N <= M)
+	  */
+	template <typename IndexIterator, typename RandomGeneratorT>
+	bool sample(IndexIterator					first,
+					IndexIterator					last,
+					const int						M, // maximum limit of the number of points in a leaf node of an octree
+					RandomGeneratorT				&rng,
+					const bool						fSuffling = true)
+	{
+		GPMAP_TRACE_ZONE("sample");
+
+		// reset
+		m_numPartitions = 0;
+
+		// if the maximum limit is less or equal to zero, do not sample!
+		if(M <= 0) return false;
+
+		// size
+		const size_t N = static_cast<size_t>(std::distance(first, last));
+		if(N <= static_cast<size_t>(M)) return false;
+
+		// randomly selected indices at the front
+		m_buffer.assign(first, last);
+		if(fSuffling) random_unique(m_buffer.begin(), m_buffer.end(), static_cast<size_t>(M), rng);
+
+		// only one partition
+		m_M					= static_cast<size_t>(M);
+		m_numPartitions	= 1;
+
+		return true;
+	}
+
+	/** @brief Number of partitions */
+	size_t size() const		{ return m_numPartitions; }
+
+	/** @brief Memory usage in bytes including the object itself */
+	size_t memoryUsage() const
+	{
+		return sizeof(*this) + heapMemoryUsage(m_buffer);
+	}
+
+	/** @brief Begin of the i-th partition */
+	const_iterator begin(const size_t i) const
+	{
+		assert(i < m_numPartitions);
+		return m_buffer.begin() + i*m_M;
+	}
+
+	/** @brief End of the i-th partition */
+	const_iterator end(const size_t i) const
+	{
+		assert(i < m_numPartitions);
+		return m_buffer.begin() + std::min<size_t>((i+1)*m_M, m_buffer.size());
+	}
+
+protected:
+	/** @brief Shuffled indices */
+	std::vector<int>	m_buffer;
+
+	/** @brief Maximum size of each partition */
+	size_t				m_M;
+
+	/** @brief Number of partitions */
+	size_t				m_numPartitions;
+};
+
+/** @brief		Randomly sample a point cloud
+  * @details	The random indices are selected by Floyd's algorithm in O(M),
+  *				and the sampled points keep their original order.
+  *				If fSuffling is false, the first M points are taken.
+  */
 template <typename PointT>
 typename pcl::PointCloud<PointT>::Ptr
 randomSampling(const typename pcl::PointCloud<PointT>::ConstPtr	&pCloud,
 					const float														samplingRatio,
-					const bool														fSuffling = true)
+					const bool														fSuffling = true,
+					const RandomStreams											&randomStreams = RandomStreams(),
+					const boost::uint64_t										key = 0)
 {
 	// size
-	const int N = static_cast<int>(pCloud->points.size());
-	const int M = static_cast<int>(ceil(static_cast<float>(N)*samplingRatio));
+	const size_t N = pCloud->points.size();
+	const size_t M = std::min<size_t>(N, static_cast<size_t>(ceil(static_cast<float>(N)*samplingRatio)));
 
 	// random indices
-	std::vector<int> indices(N);
-	std::generate(indices.begin(), indices.end(), UniqueNonZeroInteger());
 	std::vector<int> randomSampleIndices;
-	random_sampling(indices, M, randomSampleIndices, fSuffling);
+	if(fSuffling)
+	{
+		RandomGenerator rng = randomStreams.stream(key, RANDOM_STREAM_CLOUD_SAMPLING);
+		floyd_sampling(N, M, rng, randomSampleIndices);
+	}
+	else
+	{
+		randomSampleIndices.resize(M);
+		for(size_t i = 0; i < M; i++) randomSampleIndices[i] = static_cast<int>(i);
+	}
 
 	// new point cloud
 	typename pcl::PointCloud<PointT>::Ptr pSampledCloud(new pcl::PointCloud<PointT>());
@@ -204,7 +371,8 @@ randomSampling(const typename pcl::PointCloud<PointT>::ConstPtr	&pCloud,
 template <typename PointT>
 void randomSampling(const std::vector<typename pcl::PointCloud<PointT>::Ptr>		&cloudPtrList,
 						  const float																	samplingRatio,
-						  std::vector<typename pcl::PointCloud<PointT>::Ptr>				&filteredCloudPtrList)
+						  std::vector<typename pcl::PointCloud<PointT>::Ptr>				&filteredCloudPtrList,
+						  const RandomStreams														&randomStreams = RandomStreams())
 {
 	// reset
 	filteredCloudPtrList.resize(cloudPtrList.size());
@@ -212,7 +380,7 @@ void randomSampling(const std::vector<typename pcl::PointCloud<PointT>::Ptr>		&c
 	// for each point cloud
 	for(size_t i = 0; i < cloudPtrList.size(); i++)
 	{
-		filteredCloudPtrList[i] = randomSampling<PointT>(cloudPtrList[i], samplingRatio);
+		filteredCloudPtrList[i] = randomSampling<PointT>(cloudPtrList[i], samplingRatio, true, randomStreams, i);
 	}
 }
 
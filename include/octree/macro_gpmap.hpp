@@ -4,6 +4,13 @@
 // STL
 #include <string>
 #include <vector>
+#include <sstream>		// std::stringstream
+#include <limits>			// std::numeric_limits<T>::max()
+#include <algorithm>		// std::max
+
+// Boost
+#include <boost/shared_ptr.hpp>					// boost::shared_ptr
+#include <boost/filesystem/operations.hpp>	// boost::filesystem::exists
 
 // GP
 #include "gp.h"						// LogFile
@@ -12,9 +19,13 @@ using GP::LogFile;
 // GPMap
 #include "util/data_types.hpp"				// PointNormalCloudPtrList
 #include "util/timer.hpp"						// CPU_Times
+#include "util/config.hpp"						// Config, ask
 #include "common/common.hpp"					// getMinMaxPointXYZ
 #include "octree/octree_gpmap.hpp"			// OctreeGPMap
 #include "octree/octree_container.hpp"		// OctreeGPMapContainer
+#include "io/pcd_view.hpp"						// PointNormalPCDView
+#include "io/slab_stream.hpp"					// PointNormalSlabStream
+#include "io/binary_io.hpp"						// fingerprintBinary
 #include "bcm/bcm.hpp"							// BCM
 #include "bcm/bcm_serializable.hpp"			// BCM_Serializable
 #include "bcm/gaussian.hpp"					// GaussianDistribution
@@ -24,6 +35,14 @@ const int RUN_ALL_WITH_TRAINING_ONCE = false;
 
 namespace GPMap {
 
+/** @brief Config key or prompt of the i-th hyperparameter such as "hyp_cov(0)" */
+inline std::string hypKey(const std::string &strName, const int i)
+{
+	std::stringstream ss;
+	ss << strName << "(" << i << ")";
+	return ss.str();
+}
+
 /** @brief Train hyperparameters with all-in-one observations */
 template<template<typename> class MeanFunc, 
 			template<typename> class CovFunc, 
@@ -94,6 +113,75 @@ void gpmap_training(const double		BLOCK_SIZE,
 	for(int i = 0; i < logHyp.lik.size();  i++)		logFile << "- lik["  << i << "] = " << expf(logHyp.lik(i))  << std::endl;
 }
 
+/** @brief Train hyperparameters with stochastic mini-batches of blocks from all-in-one observations */
+template<template<typename> class MeanFunc,
+			template<typename> class CovFunc,
+			template<typename> class LikFunc,
+			template <typename,
+						 template<typename> class,
+						 template<typename> class,
+						 template<typename> class> class InfMethod>
+void gpmap_training(const double		BLOCK_SIZE,
+						  const size_t		NUM_CELLS_PER_AXIS,
+						  const size_t		MIN_NUM_POINTS_TO_PREDICT,
+						  const size_t		MAX_NUM_POINTS_TO_PREDICT,
+						  typename GP::GaussianProcess<float, MeanFunc, CovFunc, LikFunc, InfMethod>::Hyp	&logHyp,				// hyperparameters
+						  const pcl::PointCloud<pcl::PointNormal>::ConstPtr	&pAllPointNormalCloud,	// observations
+						  const float														gap,							// gap
+						  const MiniBatchSchedule										&schedule,					// mini-batch schedule
+						  ConvergenceMonitor												&monitor)					// convergence monitor
+{
+	// log file
+	LogFile logFile;
+
+	// gpmap with Gaussian Distribution leaf nodes
+	pcl::PointXYZ min_pt, max_pt;
+	getMinMaxPointXYZ<pcl::PointNormal>(*pAllPointNormalCloud, min_pt, max_pt);
+
+	// gpmap
+	// the contrainter type is meaningless for training
+	typedef OctreeGPMapContainer<BCM>	LeafT;
+	typedef OctreeGPMap<MeanFunc, CovFunc, LikFunc, InfMethod, LeafT> OctreeGPMapT;
+	const bool	FLAG_INDEPENDENT_TEST_POSITIONS		= true; // meaningless for training, this is for predicting test positions
+	const bool	FLAG_DO_NOT_RAMDOMLY_SAMPLE_POINTS	= false;
+	const bool	FLAG_DO_NOT_DUPLICATE_POINTS			= false;
+	OctreeGPMapT gpmap(BLOCK_SIZE,
+							 NUM_CELLS_PER_AXIS,
+							 MIN_NUM_POINTS_TO_PREDICT,
+							 MAX_NUM_POINTS_TO_PREDICT,
+							 FLAG_INDEPENDENT_TEST_POSITIONS,
+							 FLAG_DO_NOT_RAMDOMLY_SAMPLE_POINTS,
+							 FLAG_DO_NOT_DUPLICATE_POINTS);
+
+	// set bounding box
+	logFile << "[0] Set bounding box" << std::endl << std::endl;
+	gpmap.defineBoundingBox(min_pt, max_pt);
+
+	// set input cloud
+	logFile << "[1] Set input cloud" << std::endl << std::endl;
+	gpmap.setInputCloud(pAllPointNormalCloud, gap);
+
+	// add points from the input cloud
+	logFile << "[2] Add points from the input cloud" << std::endl;
+	logFile << gpmap.addPointsFromInputCloud() << std::endl << std::endl;
+
+	// train
+	logFile << "[4] Learning hyperparameters with mini-batches"	<< std::endl;
+	logFile << "- Train - Max Iterations per Step: "					<< schedule.maxIterPerStep()	<< std::endl;
+	logFile << "- Train - Max Steps: "										<< schedule.maxSteps()			<< std::endl;
+	CPU_Timer timer;
+	GP::DlibScalar nlZ = gpmap.trainByMiniBatches(logHyp, schedule, monitor);
+	CPU_Times t_training = timer.elapsed();
+	logFile << "- mean nlZ: " << nlZ << std::endl;
+	logFile << "- converged: " << monitor.isConverged() << " after " << monitor.numSteps() << " steps" << std::endl << std::endl;
+	logFile << t_training << std::endl << std::endl;
+
+	// trained hyperparameters
+	for(int i = 0; i < logHyp.mean.size(); i++)		logFile << "- mean[" << i << "] = " << expf(logHyp.mean(i)) << std::endl;
+	for(int i = 0; i < logHyp.cov.size();  i++)		logFile << "- cov["  << i << "] = " << expf(logHyp.cov(i))  << std::endl;
+	for(int i = 0; i < logHyp.lik.size();  i++)		logFile << "- lik["  << i << "] = " << expf(logHyp.lik(i))  << std::endl;
+}
+
 /** @brief	Building a GPMap with all-in-one observations
   * @note	Note that there exist no max num points limit for prediction.
   *			So, sampling the observations would be a good idea for memory issue. */
@@ -231,8 +319,164 @@ void gpmap_incremental(const double		BLOCK_SIZE,
 	gpmap.saveAsPointCloud(strPCDFilePathWithoutExtension);
 }
 
-/** @brief Building a GPMap with sequential observations
-  *			incrementally if the number of points exceed the limit */
+/** @brief		Building a GPMap with all-in-one observations which do not fit in memory
+  * @details	The binary PCD observation file is memory-mapped and streamed in chunks of slabs along the x axis.
+  *				For each chunk, a GPMap is built with the band of the chunk and its neighboring slabs,
+  *				and only the blocks in the chunk, which no further chunk can touch, are saved
+  *				to strPCDFilePathWithoutExtension + "_part_#.pcd".
+  *				The slabs are multiples of the block size, and the blocks of each band's map stay on the same global grid,
+  *				so a block in the chunk is predicted with its whole 3x3x3 neighborhood as in a build with the whole observations.
+  *				So, the peak memory is bounded by the working band instead of the whole observations.
+  * @return		Number of saved parts
+  */
+template<typename BCM_T,
+			template<typename> class MeanFunc, 
+			template<typename> class CovFunc, 
+			template<typename> class LikFunc,
+			template <typename, 
+						 template<typename> class,
+						 template<typename> class,
+						 template<typename> class> class InfMethod>
+size_t gpmap_streaming(const double		BLOCK_SIZE, 
+							  const size_t		NUM_CELLS_PER_AXIS,
+							  const size_t		MIN_NUM_POINTS_TO_PREDICT,
+							  const size_t		MAX_NUM_POINTS_TO_PREDICT,			// if 0, pure batch. Otherwise, incrementally updated with subsets
+							  const bool		FLAG_INDEPENDENT_TEST_POSITIONS, // iBCM or BCM
+							  const size_t		FLAG_RAMDOMLY_SAMPLE_POINTS,		// randomly sample points in each leaf node
+							  const typename GP::GaussianProcess<float, MeanFunc, CovFunc, LikFunc, InfMethod>::Hyp	&logHyp,	// hyperparameters
+							  const std::string													&strObsFilePath,						// binary PCD observation file
+							  const float															gap,										// gap
+							  const int																maxIterBeforeUpdate,				// number of iterations for training before update
+							  const size_t															MAX_NUM_POINTS_IN_BAND,				// max number of points in memory
+							  const std::string													&strPCDFilePathWithoutExtension)	// save file path
+{
+	// log file
+	LogFile logFile;
+
+	// times
+	CPU_Times	t_update_training;
+	CPU_Times	t_update_predict;
+	CPU_Times	t_update_combine;
+
+	// memory-mapped observations
+	PointNormalPCDView view;
+	if(!view.open(strObsFilePath))
+	{
+		logFile << "Couldn't map the binary PCD file: " << strObsFilePath << std::endl;
+		return 0;
+	}
+
+	// slabs
+	PointNormalSlabStream slabStream(view, BLOCK_SIZE);
+	logFile << "Streaming " << slabStream.numPoints() << " points in " << slabStream.numSlabs() << " slabs" << std::endl << std::endl;
+
+	// gpmap with BCM leaf nodes
+	typedef OctreeGPMapContainer<BCM_T>	LeafT;
+	typedef OctreeGPMap<MeanFunc, CovFunc, LikFunc, InfMethod, LeafT> OctreeGPMapT;
+
+	// for each chunk
+	size_t numParts(0);
+	int first(0), last(0);
+	PointNormalCloudPtr pBandCloud;
+	while(slabStream.nextChunk(first, MAX_NUM_POINTS_IN_BAND, last))
+	{
+		// skip empty chunks
+		if(slabStream.numPointsInSlabs(first, last) == 0)
+		{
+			first = last + 1;
+			continue;
+		}
+
+		logFile << "==== Updating the GPMap with the slabs [" << first << ", " << last << "] ====" << std::endl;
+
+		// band
+		logFile << "[0] Load the band" << std::endl;
+		logFile << slabStream.loadBand(first, last, pBandCloud) << " points" << std::endl << std::endl;
+
+		// gpmap
+		OctreeGPMapT gpmap(BLOCK_SIZE, 
+								 NUM_CELLS_PER_AXIS, 
+								 MIN_NUM_POINTS_TO_PREDICT, 
+								 MAX_NUM_POINTS_TO_PREDICT, 
+								 FLAG_INDEPENDENT_TEST_POSITIONS,
+								 FLAG_RAMDOMLY_SAMPLE_POINTS);
+
+		// set bounding box
+		pcl::PointXYZ min_pt, max_pt;
+		getMinMaxPointXYZ<pcl::PointNormal>(*pBandCloud, min_pt, max_pt);
+		gpmap.defineBoundingBox(min_pt, max_pt);
+
+		// set input cloud
+		logFile << "[1] Set input cloud" << std::endl << std::endl;
+		gpmap.setInputCloud(pBandCloud, gap);
+
+		// add points from the input cloud
+		logFile << "[2] Add points from the input cloud" << std::endl;
+		logFile << gpmap.addPointsFromInputCloud() << std::endl << std::endl;
+
+		// update using GPR
+		logFile << "[3] Update using GPR" << std::endl;
+		gpmap.update(logHyp, maxIterBeforeUpdate, t_update_training, t_update_predict, t_update_combine);
+		logFile << "- Training hyp: " << t_update_training << std::endl << std::endl;
+		logFile << "- Predict GPR:  " << t_update_predict  << std::endl << std::endl;
+		logFile << "- Update BCM:   " << t_update_combine  << std::endl << std::endl;
+
+		// save the finalized blocks
+		logFile << "[4] Save" << std::endl << std::endl;
+		double minX, maxX;
+		slabStream.slabRange(first, last, minX, maxX);
+		const float MAX_VALUE = std::numeric_limits<float>::max();
+		std::stringstream ss;
+		ss << strPCDFilePathWithoutExtension << "_part_" << numParts;
+		gpmap.saveAsPointCloud(ss.str(),
+									  pcl::PointXYZ(static_cast<float>(minX), -MAX_VALUE, -MAX_VALUE),
+									  pcl::PointXYZ(static_cast<float>(maxX),  MAX_VALUE,  MAX_VALUE));
+		numParts++;
+
+		// release the band before loading the next one
+		pBandCloud.reset();
+
+		// next
+		first = last + 1;
+	}
+
+	return numParts;
+}
+
+/** @brief		Fingerprint of a list of point clouds for checkpoints
+  * @details	It chains the number of clouds, the number of points of each cloud
+  *				and the coordinates and normals of every point in order,
+  *				so resuming with different or reordered point clouds is detected.
+  */
+inline boost::uint64_t fingerprintPointClouds(const std::vector<pcl::PointCloud<pcl::PointNormal>::Ptr> &pointNormalCloudList)
+{
+	const boost::uint64_t numClouds = static_cast<boost::uint64_t>(pointNormalCloudList.size());
+	boost::uint64_t fingerprint = fingerprintBinary(&numClouds, sizeof(numClouds));
+	for(size_t i = 0; i < pointNormalCloudList.size(); i++)
+	{
+		const pcl::PointCloud<pcl::PointNormal> &cloud = *pointNormalCloudList[i];
+		const boost::uint64_t numPoints = static_cast<boost::uint64_t>(cloud.points.size());
+		fingerprint = fingerprintBinary(&numPoints, sizeof(numPoints), fingerprint);
+		for(size_t j = 0; j < cloud.points.size(); j++)
+		{
+			fingerprint = fingerprintBinary(cloud.points[j].data,		3*sizeof(float), fingerprint);	// x, y, z
+			fingerprint = fingerprintBinary(cloud.points[j].data_n,	3*sizeof(float), fingerprint);	// normal_x, normal_y, normal_z
+		}
+	}
+	return fingerprint;
+}
+
+/** @brief		Building a GPMap with sequential observations
+  *				incrementally if the number of points exceed the limit
+  * @details	If a checkpoint file path is given, the map state is saved to it
+  *				after every checkpointInterval point clouds and after the last one.
+  *				If the checkpoint already exists, the map resumes from it
+  *				and the point clouds before its next cloud index are skipped.
+  *				The checkpoint keeps the number and the fingerprint of the point clouds,
+  *				and resuming with different ones throws an exception.
+  *				It also keeps the per-block hyperparameter cache used when maxIterBeforeUpdate > 0,
+  *				so a resumed build gives the same map as an uninterrupted one.
+  */
 template<typename BCM_T,
 			template<typename> class MeanFunc, 
 			template<typename> class CovFunc, 
@@ -251,7 +495,9 @@ void gpmap_incremental(const double		BLOCK_SIZE,							// block size
 							  const std::vector<pcl::PointCloud<pcl::PointNormal>::Ptr>	&pointNormalCloudList,	// observations
 							  const float																gap,							// gap
 							  const int																	maxIterBeforeUpdate,					// number of iterations for training before update
-							  const std::string														&strPCDFilePathWithoutExtension)	// save file path
+							  const std::string														&strPCDFilePathWithoutExtension,	// save file path
+							  const std::string														&strCheckpointFilePath = std::string(),	// checkpoint file path (no checkpoint if empty)
+							  const size_t																checkpointInterval = 1)						// number of point clouds between checkpoints
 {
 	// log file
 	LogFile logFile;
@@ -286,12 +532,43 @@ void gpmap_incremental(const double		BLOCK_SIZE,							// block size
 							 FLAG_INDEPENDENT_TEST_POSITIONS,
 							 FLAG_RAMDOMLY_SAMPLE_POINTS);
 
-	// set bounding box
-	logFile << "[0] Set bounding box" << std::endl << std::endl;
-	gpmap.defineBoundingBox(min_pt, max_pt);
+	// fingerprint of the observations for checkpoints
+	const boost::uint64_t cloudsFingerprint = strCheckpointFilePath.empty() ? 0 : fingerprintPointClouds(pointNormalCloudList);
+
+	// resume from the checkpoint
+	size_t firstCloudIndex(0);
+	if(!strCheckpointFilePath.empty() && boost::filesystem::exists(strCheckpointFilePath))
+	{
+		logFile << "[0] Resume from the checkpoint " << strCheckpointFilePath << std::endl << std::endl;
+		size_t numClouds;
+		boost::uint64_t savedCloudsFingerprint;
+		if(!gpmap.loadCheckpoint(strCheckpointFilePath, firstCloudIndex, numClouds, savedCloudsFingerprint))
+		{
+			GP::Exception e;
+			e = "gpmap_incremental: cannot resume from the checkpoint";
+			throw e;
+		}
+
+		// the same observations
+		if(numClouds != pointNormalCloudList.size() || savedCloudsFingerprint != cloudsFingerprint || 
+			firstCloudIndex > pointNormalCloudList.size())
+		{
+			logFile << "The checkpoint was saved with " << numClouds << " point clouds (fingerprint " << std::hex << savedCloudsFingerprint << std::dec << "), "
+					  << "but there are " << pointNormalCloudList.size() << " point clouds (fingerprint " << std::hex << cloudsFingerprint << std::dec << ")" << std::endl;
+			GP::Exception e;
+			e = "gpmap_incremental: the checkpoint was saved with different observations";
+			throw e;
+		}
+	}
+	else
+	{
+		// set bounding box
+		logFile << "[0] Set bounding box" << std::endl << std::endl;
+		gpmap.defineBoundingBox(min_pt, max_pt);
+	}
 
 	// for each observation
-	for(size_t i = 0; i < pointNormalCloudList.size(); i++)
+	for(size_t i = firstCloudIndex; i < pointNormalCloudList.size(); i++)
 	{
 		logFile << "==== Updating the GPMap with the point cloud #" << i << " ====" << std::endl;
 
@@ -321,6 +598,13 @@ void gpmap_incremental(const double		BLOCK_SIZE,							// block size
 		ss << strPCDFilePathWithoutExtension << "_upto_" << i;
 		gpmap.saveAsPointCloud(ss.str());
 
+		// checkpoint
+		if(!strCheckpointFilePath.empty() &&
+			((i + 1) % std::max<size_t>(1, checkpointInterval) == 0 || i == pointNormalCloudList.size() - 1))
+		{
+			logFile << "[5] Checkpoint: " << gpmap.saveCheckpoint(strCheckpointFilePath, i + 1, pointNormalCloudList.size(), cloudsFingerprint) << std::endl << std::endl;
+		}
+
 		// last
 		//if(i == pointNormalCloudList.size() - 1) gpmap.saveAsPointCloud(strPCDFilePathWithoutExtension);
 	}
@@ -335,6 +619,74 @@ void gpmap_incremental(const double		BLOCK_SIZE,							// block size
 	logFile << "- Total: Update - Update BCM:   " << t_update_combine_total  << std::endl << std::endl;
 }
 
+/** @brief		Merging GPMaps built from disjoint sets of observations
+  * @details	Each partial map is resumed from its checkpoint saved by gpmap_incremental() in another process or machine,
+  *				and the maps are reduced in a tree by merging pairs of them at each level.
+  *				The hyperparameters should be the ones the partial maps were updated with, since their prior is removed once per merge.
+  *				The merged map is saved as a point cloud and as a checkpoint with the next cloud index 0 if the path is given.
+  * @return		False if any checkpoint cannot be loaded or merged
+  */
+template<typename BCM_T,
+			template<typename> class MeanFunc, 
+			template<typename> class CovFunc, 
+			template<typename> class LikFunc,
+			template <typename, 
+						 template<typename> class,
+						 template<typename> class,
+						 template<typename> class> class InfMethod>
+bool gpmap_merge_checkpoints(const double						BLOCK_SIZE,								// block size
+									  const size_t						NUM_CELLS_PER_AXIS,					// number of cells per each axie
+									  const size_t						MIN_NUM_POINTS_TO_PREDICT,			// min number of points to predict
+									  const size_t						MAX_NUM_POINTS_TO_PREDICT,			// max number of points to predict
+									  const bool						FLAG_INDEPENDENT_TEST_POSITIONS,	// independent BCM or BCM
+									  const typename GP::GaussianProcess<float, MeanFunc, CovFunc, LikFunc, InfMethod>::Hyp	&logHyp,	// hyperparameters of the partial maps
+									  const std::vector<std::string>	&strCheckpointFilePathList,		// checkpoints of the partial maps
+									  const std::string				&strPCDFilePathWithoutExtension,	// save file path
+									  const std::string				&strMergedCheckpointFilePath = std::string())	// checkpoint file path of the merged map
+{
+	// log file
+	LogFile logFile;
+
+	// gpmap with BCM leaf nodes
+	typedef OctreeGPMapContainer<BCM_T>	LeafT;
+	typedef OctreeGPMap<MeanFunc, CovFunc, LikFunc, InfMethod, LeafT> OctreeGPMapT;
+	typedef boost::shared_ptr<OctreeGPMapT> OctreeGPMapPtr;
+	if(strCheckpointFilePathList.empty()) return false;
+
+	// [1] resume the partial maps
+	std::vector<OctreeGPMapPtr> gpmaps;
+	for(size_t i = 0; i < strCheckpointFilePathList.size(); i++)
+	{
+		logFile << "[1] Resume from the checkpoint " << strCheckpointFilePathList[i] << std::endl;
+		OctreeGPMapPtr pGPMap(new OctreeGPMapT(BLOCK_SIZE,
+															NUM_CELLS_PER_AXIS,
+															MIN_NUM_POINTS_TO_PREDICT,
+															MAX_NUM_POINTS_TO_PREDICT, 
+															FLAG_INDEPENDENT_TEST_POSITIONS));
+		size_t nextCloudIndex;
+		if(!pGPMap->loadCheckpoint(strCheckpointFilePathList[i], nextCloudIndex)) return false;
+		gpmaps.push_back(pGPMap);
+	}
+
+	// [2] merge pairs at each level of the tree
+	for(size_t stride = 1; stride < gpmaps.size(); stride *= 2)
+	{
+		logFile << "[2] Merge with the stride " << stride << std::endl;
+		for(size_t i = 0; i + stride < gpmaps.size(); i += 2*stride)
+		{
+			if(!gpmaps[i]->merge(*gpmaps[i + stride], logHyp)) return false;
+			gpmaps[i + stride].reset();
+		}
+	}
+	logFile << std::endl;
+
+	// [3] save
+	logFile << "[3] Save" << std::endl << std::endl;
+	gpmaps[0]->saveAsPointCloud(strPCDFilePathWithoutExtension);
+	if(!strMergedCheckpointFilePath.empty()) return gpmaps[0]->saveCheckpoint(strMergedCheckpointFilePath, 0);
+	return true;
+}
+
 /** @brief	Train hyperparameters with All-in-One [Function/Derivative/All] Observations */
 template<template<typename> class MeanFunc, 
 			template<typename> class CovFunc, 
@@ -367,59 +719,28 @@ void train_hyperparameters_with_all_in_one_observations(const double				BLOCK_SI
 	while(true)
 	{
 		// continue?
+		// the settings are taken from the global config, asked on the console or defaulted in the non-interactive mode
 		bool fContinue = RUN_ALL_WITH_TRAINING_ONCE;
 		if(!fContinue)
 		{
-			std::cout << "Do you wish to train hyperparameters? (0/1)"; 
-			std::cin  >> fContinue;
+			fContinue = ask<bool>("train", "Do you wish to train hyperparameters? (0/1)", false);
 			if(!fContinue) break;
 		}
 
 		// max iterations
-		int maxIter;
-		if(RUN_ALL_WITH_TRAINING_ONCE)
-		{
-			maxIter = 50;
-		}
-		else
-		{
-			logFile  << "\tMax iterations? (0 for no training): ";
-			std::cin >> maxIter;
-		}
-		logFile  << maxIter << std::endl;;
+		const int maxIter = RUN_ALL_WITH_TRAINING_ONCE ? 50 : ask<int>("train_max_iter", "\tMax iterations? (0 for no training): ", 50);
 		if(maxIter <= 0) break;
 
 		// number of random blocks
-		size_t numRandomBlocks;
-		if(RUN_ALL_WITH_TRAINING_ONCE)
-		{
-			numRandomBlocks = 0;
-		}
-		else
-		{
-			logFile  << "\tNumber of random blocks? (0 for all) ";	
-			std::cin >> numRandomBlocks;
-		}
-		logFile  << numRandomBlocks << std::endl;;
+		const size_t numRandomBlocks = RUN_ALL_WITH_TRAINING_ONCE ? 0 : ask<size_t>("train_num_random_blocks", "\tNumber of random blocks? (0 for all) ", 0);
 
 		// hyperparameters
-		bool fUsePredefinedHyperparameters;
-		if(RUN_ALL_WITH_TRAINING_ONCE)
-		{
-			fUsePredefinedHyperparameters = true;
-		}
-		else
-		{
-			logFile  << "\tUse Predefined Hyperparameters? (0/1) ";
-			std::cin >> fUsePredefinedHyperparameters;
-		}
-		logFile  << fUsePredefinedHyperparameters << std::endl;;
+		const bool fUsePredefinedHyperparameters = RUN_ALL_WITH_TRAINING_ONCE ? true : ask<bool>("train_use_predefined_hyp", "\tUse Predefined Hyperparameters? (0/1) ", true);
 		if(!fUsePredefinedHyperparameters)
 		{
-			float hyp;
-			for(int i = 0; i < logHyp.mean.size(); i++) { std::cout << "\t\thyp.mean(" << i << ") = "; std::cin >> hyp; logHyp.mean(i) = log(hyp); }
-			for(int i = 0; i < logHyp.cov.size();  i++) { std::cout << "\t\thyp.cov(" << i << ") = ";  std::cin >> hyp; logHyp.cov(i)  = log(hyp); }
-			for(int i = 0; i < logHyp.lik.size();  i++) { std::cout << "\t\thyp.lik(" << i << ") = ";  std::cin >> hyp; logHyp.lik(i)  = log(hyp); }
+			for(int i = 0; i < logHyp.mean.size(); i++) { logHyp.mean(i) = log(ask<float>(hypKey("hyp_mean", i), hypKey("\t\thyp.mean", i) + " = ", exp(logHyp.mean(i)))); }
+			for(int i = 0; i < logHyp.cov.size();  i++) { logHyp.cov(i)  = log(ask<float>(hypKey("hyp_cov",  i), hypKey("\t\thyp.cov",  i) + " = ", exp(logHyp.cov(i)))); }
+			for(int i = 0; i < logHyp.lik.size();  i++) { logHyp.lik(i)  = log(ask<float>(hypKey("hyp_lik",  i), hypKey("\t\thyp.lik",  i) + " = ", exp(logHyp.lik(i)))); }
 		}
 
 		// log hyperparameters before training
@@ -449,7 +770,7 @@ void train_hyperparameters_with_all_in_one_observations(const double				BLOCK_SI
 		for(int i = 0; i < logHyp.lik.size(); i++)  { logFile  << "\thyp.lik("  << i << ") = " << exp(logHyp.lik(i))  << std::endl; }
 
 		// next
-		if(RUN_ALL_WITH_TRAINING_ONCE) break;
+		if(RUN_ALL_WITH_TRAINING_ONCE || !Config::global().isInteractive()) break;
 	}
 }
 
@@ -480,8 +801,7 @@ void build_gpmaps_with_sampled_all_in_one_observations(const double				BLOCK_SIZ
 	bool fContinue = RUN_ALL_WITH_TRAINING_ONCE;
 	if(!fContinue)
 	{
-		std::cout << "Do you wish to build GPMaps with randomly sampled all-in-one observations? (0/1)";
-		std::cin >> fContinue;
+		fContinue = ask<bool>("build_sampled_all_in_one", "Do you wish to build GPMaps with randomly sampled all-in-one observations? (0/1)", true);
 		if(!fContinue) return;
 	}
 
@@ -540,9 +860,8 @@ void build_gpmaps_with_all_in_one_observations(const double				BLOCK_SIZE,
 	bool fContinue = RUN_ALL_WITH_TRAINING_ONCE;
 	if(!fContinue)
 	{
-		if(FLAG_RAMDOMLY_SAMPLE_POINTS)	std::cout << "Do you wish to build GPMaps with randomly sampled all-in-one observations? (0/1)";
-		else										std::cout << "Do you wish to build GPMaps with all-in-one observations? (0/1)";
-		std::cin >> fContinue;
+		if(FLAG_RAMDOMLY_SAMPLE_POINTS)	fContinue = ask<bool>("build_sampled_all_in_one",	"Do you wish to build GPMaps with randomly sampled all-in-one observations? (0/1)", true);
+		else										fContinue = ask<bool>("build_all_in_one",				"Do you wish to build GPMaps with all-in-one observations? (0/1)", true);
 		if(!fContinue) return;
 	}
 
@@ -625,9 +944,8 @@ void build_gpmaps_with_sequential_observations(const double				BLOCK_SIZE,
 	bool fContinue = RUN_ALL_WITH_TRAINING_ONCE;
 	if(!fContinue)
 	{
-		if(FLAG_RAMDOMLY_SAMPLE_POINTS)	std::cout << "Do you wish to build GPMaps with randomly sampled sequential observations? (0/1)";
-		else										std::cout << "Do you wish to build GPMaps with sequential observations? (0/1)";
-		std::cin >> fContinue;
+		if(FLAG_RAMDOMLY_SAMPLE_POINTS)	fContinue = ask<bool>("build_sampled_sequential",	"Do you wish to build GPMaps with randomly sampled sequential observations? (0/1)", true);
+		else										fContinue = ask<bool>("build_sequential",				"Do you wish to build GPMaps with sequential observations? (0/1)", true);
 		if(!fContinue) return;
 	}
 
@@ -639,6 +957,10 @@ void build_gpmaps_with_sequential_observations(const double				BLOCK_SIZE,
 	PointNormalCloudPtrList ObsCloudPtrList;
 	loadPointCloud<pcl::PointNormal>(ObsCloudPtrList, strSequentialObsFileNameList, strSequentialObsFileNamePrefix, strSequentialObsFileNameSuffix);
 
+	// checkpoints every this number of point clouds (no checkpoint if 0)
+	size_t checkpointInterval(0);
+	Config::global().get("checkpoint_interval", checkpointInterval);
+
 	// [1] GPMap - Sequential Observations - Incremental Update (iBCM)
 	if(FLAG_RAMDOMLY_SAMPLE_POINTS)	strFileName = strOutputFileName + "(seq_samples)_iBCM";
 	else										strFileName = strOutputFileName + "(seq)_iBCM";
@@ -658,7 +980,9 @@ void build_gpmaps_with_sequential_observations(const double				BLOCK_SIZE,
 										  ObsCloudPtrList,						// observations
 										  gap,										// gap for free points
 										  maxIterBeforeUpdate,					// number of iterations for training before update
-										  strOutputFolder + strFileName);	// save file path
+										  strOutputFolder + strFileName,		// save file path
+										  checkpointInterval > 0 ? strOutputFolder + strFileName + ".ckpt" : std::string(),	// checkpoint file path
+										  checkpointInterval);					// checkpoint interval
 
 	// [2] GPMap - Sequential Observations - Incremental Update (BCM)
 	if(FLAG_RAMDOMLY_SAMPLE_POINTS)	strFileName = strOutputFileName + "(seq_samples)_BCM";
@@ -679,7 +1003,218 @@ void build_gpmaps_with_sequential_observations(const double				BLOCK_SIZE,
 										  ObsCloudPtrList,						// observations
 										  gap,										// gap for free points
 										  maxIterBeforeUpdate,					// number of iterations for training before update
-										  strOutputFolder + strFileName);	// save file path
+										  strOutputFolder + strFileName,		// save file path
+										  checkpointInterval > 0 ? strOutputFolder + strFileName + ".ckpt" : std::string(),	// checkpoint file path
+										  checkpointInterval);					// checkpoint interval
+}
+
+/** @brief		Build GPMaps for all prediction settings with the same octree
+  * @details	The octree of the observations is built once for the block size, the number of cells and the BCM mode,
+  *				and each combination of the min/max numbers of points and the random sampling
+  *				is predicted on it after clearing the BCM states of the previous one.
+  *				Each run is saved to strOutputFolder + strOutputFileName + "_block_#_cell_#_m_#_n_#_[iBCM|BCM][_samples]".
+  * @return		Number of runs
+  */
+template<typename BCM_T,
+			template<typename> class MeanFunc, 
+			template<typename> class CovFunc, 
+			template<typename> class LikFunc,
+			template <typename, 
+						 template<typename> class,
+						 template<typename> class,
+						 template<typename> class> class InfMethod>
+size_t sweep_gpmap_prediction_settings(const double									BLOCK_SIZE,								// block size
+													const size_t									NUM_CELLS_PER_AXIS,					// number of cells per each axie
+													const bool										FLAG_INDEPENDENT_TEST_POSITIONS,	// iBCM or BCM
+													const std::vector<size_t>					&minNumPointsToPredictList,		// min numbers of points to predict
+													const std::vector<size_t>					&maxNumPointsToPredictList,		// max numbers of points to predict
+													const std::vector<int>						&randomSamplingList,				// randomly sample points in each leaf node (0/1)
+													const typename GP::GaussianProcess<float, MeanFunc, CovFunc, LikFunc, InfMethod>::Hyp	
+																										&logHyp,								// hyperparameters
+													const pcl::PointCloud<pcl::PointNormal>::ConstPtr		&pAllInOneObs,			// observations
+													const float										gap,									// gap
+													const int										maxIterBeforeUpdate,				// number of iterations for training before update
+													const std::string								&strOutputFolder,					// output data folder
+													const std::string								&strOutputFileName,				// output data file prefix
+													const std::string								&strLogFolder,						// log folder
+													const size_t									firstRun)							// index of the first run for the log
+{
+	if(minNumPointsToPredictList.empty() || maxNumPointsToPredictList.empty() || randomSamplingList.empty()) return 0;
+
+	// file name of the shared octree
+	std::stringstream ssOctree;
+	ssOctree << strOutputFileName
+				<< "_block_" << BLOCK_SIZE 
+				<< "_cell_" << static_cast<float>(BLOCK_SIZE)/static_cast<float>(NUM_CELLS_PER_AXIS);
+	const std::string strOctreeFileName = ssOctree.str();
+	const std::string strMode = FLAG_INDEPENDENT_TEST_POSITIONS ? "_iBCM" : "_BCM";
+
+	// log file
+	LogFile logFile(strLogFolder + strOctreeFileName + strMode + ".log");
+
+	// get bounding box
+	pcl::PointXYZ min_pt, max_pt;
+	getMinMaxPointXYZ<pcl::PointNormal>(*pAllInOneObs, min_pt, max_pt);
+
+	// gpmap with BCM leaf nodes
+	// the prediction settings are set for each run
+	typedef OctreeGPMapContainer<BCM_T>	LeafT;
+	typedef OctreeGPMap<MeanFunc, CovFunc, LikFunc, InfMethod, LeafT> OctreeGPMapT;
+	OctreeGPMapT gpmap(BLOCK_SIZE, 
+							 NUM_CELLS_PER_AXIS, 
+							 minNumPointsToPredictList[0], 
+							 maxNumPointsToPredictList[0], 
+							 FLAG_INDEPENDENT_TEST_POSITIONS,
+							 randomSamplingList[0] != 0);
+
+	// set bounding box
+	logFile << "[0] Set bounding box" << std::endl << std::endl;
+	gpmap.defineBoundingBox(min_pt, max_pt);
+
+	// set input cloud
+	logFile << "[1] Set input cloud" << std::endl << std::endl;
+	gpmap.setInputCloud(pAllInOneObs, gap);
+
+	// add points from the input cloud
+	logFile << "[2] Add points from the input cloud" << std::endl;
+	logFile << gpmap.addPointsFromInputCloud() << std::endl << std::endl;
+
+	// times
+	CPU_Times	t_update_training;
+	CPU_Times	t_update_predict;
+	CPU_Times	t_update_combine;
+
+	size_t numRuns(0);
+	for(size_t iMin = 0; iMin < minNumPointsToPredictList.size(); iMin++)
+	for(size_t iMax = 0; iMax < maxNumPointsToPredictList.size(); iMax++)
+	for(size_t iSampling = 0; iSampling < randomSamplingList.size(); iSampling++)
+	{
+		// setting
+		const size_t		MIN_NUM_POINTS_TO_PREDICT		= minNumPointsToPredictList[iMin];
+		const size_t		MAX_NUM_POINTS_TO_PREDICT		= maxNumPointsToPredictList[iMax];
+		const bool			FLAG_RAMDOMLY_SAMPLE_POINTS	= (randomSamplingList[iSampling] != 0);
+
+		// file name
+		std::stringstream ss;
+		ss << strOctreeFileName
+			<< "_m_" << MIN_NUM_POINTS_TO_PREDICT
+			<< "_n_" << MAX_NUM_POINTS_TO_PREDICT
+			<< strMode
+			<< (FLAG_RAMDOMLY_SAMPLE_POINTS ? "_samples" : "");
+		const std::string strFileName = ss.str();
+
+		// log file
+		logFile.open(strLogFolder + strFileName + ".log");
+		logFile << "[Sweep] " << firstRun + numRuns << ": " << strFileName << std::endl << std::endl;
+
+		// reset
+		gpmap.setPredictionSettings(MIN_NUM_POINTS_TO_PREDICT, MAX_NUM_POINTS_TO_PREDICT, FLAG_RAMDOMLY_SAMPLE_POINTS);
+		gpmap.clearBlockStates();
+
+		// update using GPR
+		logFile << "[3] Update using GPR" << std::endl;
+		gpmap.update(logHyp, maxIterBeforeUpdate, t_update_training, t_update_predict, t_update_combine);
+		logFile << "- Training hyp: " << t_update_training << std::endl << std::endl;
+		logFile << "- Predict GPR:  " << t_update_predict  << std::endl << std::endl;
+		logFile << "- Update BCM:   " << t_update_combine  << std::endl << std::endl;
+
+		// save
+		logFile << "[4] Save" << std::endl << std::endl;
+		gpmap.saveAsPointCloud(strOutputFolder + strFileName);
+
+		// next
+		numRuns++;
+	}
+
+	return numRuns;
+}
+
+/** @brief		Build GPMaps for all combinations of the settings with the same All-in-One Observations
+  * @details	The observations are loaded once by the caller and shared by all runs,
+  *				so a parameter sweep does not reload the cloud for each setting.
+  *				The octree is built once for each block size, number of cells and BCM mode,
+  *				and shared by the runs of the min/max numbers of points and the random sampling.
+  *				Each run is saved to strOutputFolder + strOutputFileName + "_block_#_cell_#_m_#_n_#_[iBCM|BCM][_samples]".
+  * @return		Number of runs
+  */
+template<template<typename> class MeanFunc, 
+			template<typename> class CovFunc, 
+			template<typename> class LikFunc,
+			template <typename, 
+						 template<typename> class,
+						 template<typename> class,
+						 template<typename> class> class InfMethod>
+size_t sweep_gpmaps_with_all_in_one_observations(const std::vector<double>			&blockSizeList,							// block sizes
+																 const std::vector<size_t>			&numCellsPerAxisList,					// numbers of cells per each axis
+																 const std::vector<size_t>			&minNumPointsToPredictList,			// min numbers of points to predict
+																 const std::vector<size_t>			&maxNumPointsToPredictList,			// max numbers of points to predict
+																 const std::vector<std::string>	&bcmModeList,							// "iBCM" (independent) or "BCM" (dependent)
+																 const std::vector<int>				&randomSamplingList,					// randomly sample points in each leaf node (0/1)
+																 const typename GP::GaussianProcess<float, MeanFunc, CovFunc, LikFunc, InfMethod>::Hyp	
+																												&logHyp,										// hyperparameters
+																 const pcl::PointCloud<pcl::PointNormal>::ConstPtr		&pAllInOneObs,					// observations
+																 const float									gap,											// gap
+																 const int										maxIterBeforeUpdate,						// number of iterations for training before update
+																 const std::string							&strOutputFolder,							// output data folder
+																 const std::string							&strOutputFileName,						// output data file prefix
+																 const std::string							&strLogFolder)								// log folder
+{
+	size_t numRuns(0);
+	for(size_t iBlock = 0; iBlock < blockSizeList.size(); iBlock++)
+	for(size_t iCell = 0; iCell < numCellsPerAxisList.size(); iCell++)
+	for(size_t iMode = 0; iMode < bcmModeList.size(); iMode++)
+	{
+		// setting
+		const double		BLOCK_SIZE							= blockSizeList[iBlock];
+		const size_t		NUM_CELLS_PER_AXIS				= numCellsPerAxisList[iCell];
+		const bool			FLAG_INDEPENDENT_TEST_POSITIONS	= (bcmModeList[iMode] != "BCM");
+
+		// build
+		if(FLAG_INDEPENDENT_TEST_POSITIONS)
+		{
+			numRuns += sweep_gpmap_prediction_settings<BCM,
+																	 MeanFunc, 
+																	 CovFunc, 
+																	 LikFunc, 
+																	 InfMethod>(BLOCK_SIZE,								// block size
+																					NUM_CELLS_PER_AXIS,					// number of cells per each axie
+																					FLAG_INDEPENDENT_TEST_POSITIONS,	// predict means and variances
+																					minNumPointsToPredictList,			// min numbers of points to predict
+																					maxNumPointsToPredictList,			// max numbers of points to predict
+																					randomSamplingList,					// random sampling
+																					logHyp,									// hyperparameters
+																					pAllInOneObs,							// observations
+																					gap,										// gap for free points
+																					maxIterBeforeUpdate,					// number of iterations for training before update
+																					strOutputFolder,						// output data folder
+																					strOutputFileName,					// output data file prefix
+																					strLogFolder,							// log folder
+																					numRuns);								// index of the first run
+		}
+		else
+		{
+			numRuns += sweep_gpmap_prediction_settings<BCM_Serializable,
+																	 MeanFunc, 
+																	 CovFunc, 
+																	 LikFunc, 
+																	 InfMethod>(BLOCK_SIZE,								// block size
+																					NUM_CELLS_PER_AXIS,					// number of cells per each axie
+																					FLAG_INDEPENDENT_TEST_POSITIONS,	// predict means and covariances
+																					minNumPointsToPredictList,			// min numbers of points to predict
+																					maxNumPointsToPredictList,			// max numbers of points to predict
+																					randomSamplingList,					// random sampling
+																					logHyp,									// hyperparameters
+																					pAllInOneObs,							// observations
+																					gap,										// gap for free points
+																					maxIterBeforeUpdate,					// number of iterations for training before update
+																					strOutputFolder,						// output data folder
+																					strOutputFileName,					// output data file prefix
+																					strLogFolder,							// log folder
+																					numRuns);								// index of the first run
+		}
+	}
+
+	return numRuns;
 }
 
 /** @brief	Train hyperparameters with All-in-One [Function/Derivative/All] Observations and
@@ -0,0 +1,167 @@
+#ifndef _MINI_BATCH_TRAINING_HPP_
+#define _MINI_BATCH_TRAINING_HPP_
+
+// STL
+#include <cmath>			// fabs, ceil
+#include <limits>			// std::numeric_limits<T>::max()
+#include <algorithm>		// std::min(), max()
+
+namespace GPMap {
+
+/** @brief		Mini-batch schedule for stochastic hyperparameter training
+  * @details	At each step, a new random subset of non-empty blocks is drawn.
+  *				The batch size starts from the initial size and grows geometrically
+  *				every growth interval steps until it reaches the maximum size,
+  *				so that the noise of the stochastic objective shrinks as the training converges.
+  */
+class MiniBatchSchedule
+{
+public:
+	/** @brief Constructor */
+	MiniBatchSchedule(const size_t	initialBatchSize		= 100,
+							const size_t	maxBatchSize			= 1000,
+							const float		growthRate				= 2.f,
+							const size_t	growthInterval			= 5,
+							const int		maxIterPerStep			= 10,
+							const size_t	maxSteps					= 100)
+		: m_initialBatchSize	(std::max<size_t>(1, initialBatchSize)),
+		  m_maxBatchSize		(std::max<size_t>(std::max<size_t>(1, initialBatchSize), maxBatchSize)),
+		  m_growthRate			(std::max<float>(1.f, growthRate)),
+		  m_growthInterval	(std::max<size_t>(1, growthInterval)),
+		  m_maxIterPerStep	(std::max<int>(1, maxIterPerStep)),
+		  m_maxSteps			(maxSteps)
+	{
+	}
+
+	/** @brief		Batch size at a step
+	  * @return		Number of blocks to sample, which is not greater than the total number of blocks
+	  */
+	size_t batchSize(const size_t step, const size_t numBlocks) const
+	{
+		// geometric growth
+		const double size = static_cast<double>(m_initialBatchSize) * std::pow(static_cast<double>(m_growthRate), static_cast<double>(step / m_growthInterval));
+
+		// upper limits
+		const size_t batchSize = size < static_cast<double>(m_maxBatchSize) ? static_cast<size_t>(ceil(size)) : m_maxBatchSize;
+		return std::min<size_t>(batchSize, numBlocks);
+	}
+
+	/** @brief Number of BOBYQA iterations in each step */
+	int maxIterPerStep() const	{ return m_maxIterPerStep; }
+
+	/** @brief Maximum number of steps */
+	size_t maxSteps() const		{ return m_maxSteps; }
+
+protected:
+	/** @brief Batch sizes */
+	size_t	m_initialBatchSize;
+	size_t	m_maxBatchSize;
+
+	/** @brief Batch size is multiplied by the growth rate every growth interval steps */
+	float		m_growthRate;
+	size_t	m_growthInterval;
+
+	/** @brief Iterations */
+	int		m_maxIterPerStep;
+	size_t	m_maxSteps;
+};
+
+/** @brief		Convergence monitor for stochastic hyperparameter training
+  * @details	Since each step sees a different subset of blocks,
+  *				the mean negative log marginal likelihood per block is smoothed with an exponential moving average.
+  *				The training is regarded as converged when both the relative change of the smoothed objective
+  *				and the maximum change of the log hyperparameters are under the tolerances
+  *				for a number of consecutive steps (patience).
+  */
+class ConvergenceMonitor
+{
+public:
+	/** @brief Constructor */
+	ConvergenceMonitor(const double	relativeTolerance	= 1e-3,
+							 const double	hypTolerance		= 1e-2,
+							 const size_t	patience				= 3,
+							 const double	smoothingFactor	= 0.5)
+		: m_relativeTolerance	(relativeTolerance),
+		  m_hypTolerance			(hypTolerance),
+		  m_patience				(std::max<size_t>(1, patience)),
+		  m_smoothingFactor		(std::min<double>(1.0, std::max<double>(0.0, smoothingFactor)))
+	{
+		reset();
+	}
+
+	/** @brief Reset the history */
+	void reset()
+	{
+		m_numSteps			= 0;
+		m_numStableSteps	= 0;
+		m_smoothedNlZ		= std::numeric_limits<double>::max();
+		m_relativeChange	= std::numeric_limits<double>::max();
+	}
+
+	/** @brief		Add a new step
+	  * @param[in]	meanNlZ			Mean negative log marginal likelihood per block of the current mini-batch
+	  * @param[in]	maxHypChange	Maximum absolute change of the log hyperparameters during the current step
+	  * @return		True if converged
+	  */
+	bool update(const double meanNlZ, const double maxHypChange)
+	{
+		// non-finite objective: the step is not stable
+		if(!(meanNlZ > -std::numeric_limits<double>::max() && meanNlZ < std::numeric_limits<double>::max()))
+		{
+			m_numSteps++;
+			m_numStableSteps = 0;
+			return false;
+		}
+
+		// exponential moving average
+		if(m_numSteps == 0 || m_smoothedNlZ == std::numeric_limits<double>::max())
+		{
+			m_smoothedNlZ		= meanNlZ;
+			m_relativeChange	= std::numeric_limits<double>::max();
+		}
+		else
+		{
+			const double prevSmoothedNlZ = m_smoothedNlZ;
+			m_smoothedNlZ		= m_smoothingFactor * meanNlZ + (1.0 - m_smoothingFactor) * prevSmoothedNlZ;
+			m_relativeChange	= fabs(m_smoothedNlZ - prevSmoothedNlZ) / std::max<double>(1.0, fabs(prevSmoothedNlZ));
+		}
+		m_numSteps++;
+
+		// stable step
+		if(m_relativeChange <= m_relativeTolerance && maxHypChange <= m_hypTolerance)	m_numStableSteps++;
+		else																										m_numStableSteps = 0;
+
+		return isConverged();
+	}
+
+	/** @brief Check if it is converged */
+	bool isConverged() const			{ return m_numStableSteps >= m_patience; }
+
+	/** @brief Smoothed mean negative log marginal likelihood per block */
+	double smoothedNlZ() const			{ return m_smoothedNlZ; }
+
+	/** @brief Relative change of the smoothed objective in the last step */
+	double relativeChange() const		{ return m_relativeChange; }
+
+	/** @brief Number of steps */
+	size_t numSteps() const				{ return m_numSteps; }
+
+protected:
+	/** @brief Tolerances */
+	double	m_relativeTolerance;
+	double	m_hypTolerance;
+	size_t	m_patience;
+
+	/** @brief Weight of the new objective for the exponential moving average */
+	double	m_smoothingFactor;
+
+	/** @brief History */
+	size_t	m_numSteps;
+	size_t	m_numStableSteps;
+	double	m_smoothedNlZ;
+	double	m_relativeChange;
+};
+
+}
+
+#endif
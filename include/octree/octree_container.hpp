@@ -13,6 +13,7 @@
 
 // GPMap
 #include "util/data_types.hpp"			// Matrix, MatrixPtr
+#include "util/memory_usage.hpp"			// heapMemoryUsage
 
 namespace GPMap {
 
@@ -33,6 +34,33 @@ public:
 		// add to the int vector
 		pcl::octree::OctreeContainerDataTVector<int>::setData(data);
 	}
+
+	/** @brief		Reserve the index vector for more indices
+	  * @details	When the number of indices to be added is known in advance,
+	  *				the vector is allocated once instead of growing by push_back.
+	  */
+	void reserveData(const size_t numMoreIndices)
+	{
+		leafDataTVector_.reserve(leafDataTVector_.size() + numMoreIndices);
+	}
+
+	/** @brief Memory usage in bytes including the object itself */
+	size_t memoryUsage() const
+	{
+		return sizeof(*this) + indexMemoryUsage() + dataMemoryUsage();
+	}
+
+	/** @brief Heap bytes of the point indices */
+	size_t indexMemoryUsage() const
+	{
+		return GPMap::heapMemoryUsage(this->getDataTVector());
+	}
+
+	/** @brief Heap bytes of the GPMap container such as the BCM state */
+	size_t dataMemoryUsage() const
+	{
+		return GPMapContainer::heapMemoryUsage();
+	}
 };
 
 }
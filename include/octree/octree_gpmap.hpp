@@ -3,9 +3,20 @@
 
 // STL
 #include <cmath>			// floor, ceil
+#include <sstream>		// std::ostringstream
 #include <vector>
 #include <limits>			// std::numeric_limits<T>::min(), max()
-#include <algorithm>		// std::min(), max()
+#include <utility>		// std::pair
+#include <algorithm>		// std::min(), max(), sort()
+#include <fstream>		// std::ofstream, std::ifstream
+#include <cstring>		// memcmp
+
+// Boost
+#include <boost/shared_ptr.hpp>			// boost::shared_ptr
+#include <boost/unordered_map.hpp>		// boost::unordered_map
+#include <boost/functional/hash.hpp>		// boost::hash_combine
+#include <boost/cstdint.hpp>				// boost::uint32_t, boost::uint64_t
+#include <boost/filesystem/operations.hpp>	// boost::filesystem::rename
 
 // PCL
 #include <pcl/point_types.h>
@@ -20,16 +31,68 @@
 using GP::LogFile;
 
 // GPMap
-#include "util/random.hpp"						// random_unique
+#include "util/random.hpp"						// random_unique, RandomStreams
+#include "util/morton.hpp"						// mortonEncodeSigned
 #include "util/timer.hpp"						// CPU_Times, CPU_Timer
+#include "util/trace.hpp"						// GPMAP_TRACE_ZONE
+#include "util/async_logger.hpp"				// GPMAP_LOG_INFO, GPMAP_LOG_DEBUG
 #include "io/io.hpp"								// savePointCloud
 #include "data/test_data.hpp"					// meshGrid
 #include "data/training_data.hpp"			// generateTrainingData
 #include "plsc/plsc.hpp"						// PLSC
 #include "data_partitioning.hpp"				// random_data_partition
+#include "mini_batch_training.hpp"			// MiniBatchSchedule, ConvergenceMonitor
 #include "octomap/octomap.hpp"				// OctoMap
+#include "bcm/bcm.hpp"							// BCM::setPrior, BCM::numCholeskyRetries
+#include "block_statistics.hpp"				// BlockStatisticsList
+#include "util/memory_usage.hpp"				// heapMemoryUsage
+#include "io/binary_io.hpp"						// writeBinary, readBinary
 namespace GPMap {
 
+/** @brief		Memory usage of an OctreeGPMap in bytes
+  * @details	The input cloud given by the caller is not counted,
+  *				but the sorted copy owned by the map is.
+  */
+struct OctreeGPMapMemoryUsage
+{
+	OctreeGPMapMemoryUsage()
+		: octree(0), indices(0), leafData(0), testPositions(0), sortedCloud(0), caches(0)
+	{
+	}
+
+	/** @brief Sum of all */
+	size_t total() const
+	{
+		return octree + indices + leafData + testPositions + sortedCloud + caches;
+	}
+
+	size_t	octree;				// map object with its branch and leaf nodes
+	size_t	indices;				// point indices in the leaf nodes (27 times larger if duplicated)
+	size_t	leafData;			// BCM states in the leaf nodes
+	size_t	testPositions;		// test inputs of a block
+	size_t	sortedCloud;		// spatially sorted copy of the input cloud with its block ranges
+	size_t	caches;				// hyperparameter cache, partition buffer, block centers and statistics
+};
+
+/** @brief		Hash of an octree key
+  * @details	Unlike the Morton code of 21 bits per axis, it does not alias keys of any depth.
+  */
+struct OctreeKeyHash
+{
+	size_t operator()(const pcl::octree::OctreeKey &key) const
+	{
+		size_t seed(0);
+		boost::hash_combine(seed, key.x);
+		boost::hash_combine(seed, key.y);
+		boost::hash_combine(seed, key.z);
+		return seed;
+	}
+};
+
+/** @brief Header of the checkpoint files of OctreeGPMap */
+const char					OCTREE_GPMAP_CHECKPOINT_MAGIC[8]	= {'G', 'P', 'M', 'A', 'P', 'C', 'K', '1'};
+const boost::uint32_t	OCTREE_GPMAP_CHECKPOINT_VERSION	= 2;
+
 //typedef OctreeGPMapContainer<BCM>						LeafT;
 //typedef OctreeGPMapContainer<BCM_Serializable>	LeafT;
 //typedef pcl::octree::OctreeContainerEmpty<int>				BranchT;
@@ -66,6 +129,16 @@ protected:
 	typedef float Scalar;
 	typedef GP::GaussianProcess<Scalar, MeanFunc, CovFunc, LikFunc, InfMethod>	GPType;
 
+	/** @brief		Range of the points of a block in the sorted input cloud */
+	struct BlockRange
+	{
+		boost::uint64_t			code;		// Morton code in the global grid
+		pcl::octree::OctreeKey	key;		// octree key
+		int							first;	// first index
+		int							count;	// number of points
+	};
+	typedef std::vector<BlockRange>	BlockRangeList;
+
 public:
 	typedef typename GPType::Hyp Hyp;
 
@@ -91,7 +164,13 @@ public:
 		  FLAG_INDEPENDENT_TEST_POSITIONS_	(FLAG_INDEPENDENT_TEST_POSITIONS),
 		  FLAG_RAMDOMLY_SAMPLE_POINTS_					(FLAG_RAMDOMLY_SAMPLE_POINTS),
 		  FLAG_DUPLICATE_POINTS_				(FLAG_DUPLICATE_POINTS),
-		  m_pXs(new Matrix(NUM_CELLS_PER_BLOCK_, 3))
+		  m_pXs(new Matrix(NUM_CELLS_PER_BLOCK_, 3)),
+		  m_numBlockSamplings(0),
+		  m_fHypCache(false),
+		  m_hypCachePointCountTolerance(0.1f),
+		  m_fSpatialSorting(false),
+		  m_memoryUsageInUpdate(0),
+		  m_memoryHighWaterMark(0)
    {
 #ifdef _TEST_OCTREE_GPMAP
 		PCL_WARN("Testing octree-based GPMap\n");
@@ -132,6 +211,8 @@ public:
 	}
 
 	/** @brief Define bounding box for octree
+	* @details The lower corner is kept on the global block grid, multiples of the block size,
+	*			  so that maps defined from different observations can be merged.
 	* @note Bounding box cannot be changed once the octree contains elements.
 	* @param[in] minX X coordinate of lower bounding box corner
 	* @param[in] minY Y coordinate of lower bounding box corner
@@ -150,6 +231,7 @@ public:
 		maxY = ceil (maxY/BLOCK_SIZE_ + 1.f)*BLOCK_SIZE_;
 		maxZ = ceil (maxZ/BLOCK_SIZE_ + 1.f)*BLOCK_SIZE_;
 		Parent::defineBoundingBox(minX, minY, minZ, maxX, maxY, maxZ);
+		snapBoundingBoxToBlockGrid();
 
 		LogFile logFile;
 		logFile << "min: (" << minX_ << ", " << minY_ << ", " << minZ_ << "), "
@@ -193,6 +275,8 @@ public:
 	  */
 	CPU_Times addPointsFromInputCloud()
 	{
+		GPMAP_TRACE_ZONE_ARG("addPointsFromInputCloud", "points", input_->size());
+
 		// assert (this->leafCount_==0);
 
 		// reset the previous point indices in each voxel
@@ -240,7 +324,13 @@ public:
 		CPU_Timer timer;
 
 		// add the new point cloud
-		if(indices_)
+		if(m_fSpatialSorting)
+		{
+			// sort the points by blocks and add them block by block
+			sortInputCloudByBlocks();
+			addBlockRangesFromInputCloud();
+		}
+		else if(indices_)
 		{
 			for(std::vector<int>::const_iterator current = indices_->begin (); current != indices_->end (); ++current)
 			{
@@ -338,7 +428,8 @@ public:
 #ifndef CONST_LEAF_NODE_ITERATOR_
 		if(numRandomBlocks > 0 && numRandomBlocks < m_nonEmptyBlockCenterPointXYZList.size())
 		{
-			random_unique(m_nonEmptyBlockCenterPointXYZList.begin(), m_nonEmptyBlockCenterPointXYZList.end(), numRandomBlocks);
+			RandomGenerator rng = m_randomStreams.stream(m_numBlockSamplings++, RANDOM_STREAM_BLOCK_SAMPLING);
+			random_unique(m_nonEmptyBlockCenterPointXYZList.begin(), m_nonEmptyBlockCenterPointXYZList.end(), numRandomBlocks, rng);
 			m_numRandomBlocks = numRandomBlocks;
 		}
 		else
@@ -365,7 +456,95 @@ public:
 		return minNlZ;
 	}
 
-	/** @brief		Operator for optimizing hyperparameters 
+	/** @brief		Train hyperparameters with stochastic mini-batches of blocks
+	  * @details	At each step, a new random subset of blocks is drawn according to the schedule
+	  *				and a few BOBYQA iterations are run from the current hyperparameters.
+	  *				It stops when the monitor reports convergence or the maximum number of steps is reached.
+	  * @return		Smoothed mean negative log marginal likelihood per block
+	  */
+	GP::DlibScalar trainByMiniBatches(Hyp								&logHyp,
+												 const MiniBatchSchedule	&schedule,
+												 ConvergenceMonitor			&monitor,
+												 const GP::DlibScalar		minValue = 1e-7)
+	{
+		// log file
+		LogFile logFile;
+
+		// total number of non-empty blocks
+#ifndef CONST_LEAF_NODE_ITERATOR_
+		const size_t NUM_BLOCKS = m_nonEmptyBlockCenterPointXYZList.size();
+#else
+		const size_t NUM_BLOCKS = getLeafCount();
+#endif
+		if(NUM_BLOCKS == 0) return std::numeric_limits<GP::DlibScalar>::infinity();
+
+		// for each step
+		monitor.reset();
+		for(size_t step = 0; step < schedule.maxSteps(); step++)
+		{
+			// previous hyperparameters
+			Hyp prevLogHyp;
+			prevLogHyp.mean	= logHyp.mean;
+			prevLogHyp.cov		= logHyp.cov;
+			prevLogHyp.lik		= logHyp.lik;
+
+			// resample a mini-batch and train
+			const size_t batchSize = schedule.batchSize(step, NUM_BLOCKS);
+			const GP::DlibScalar nlZ = train(logHyp, schedule.maxIterPerStep(), batchSize, minValue);
+
+			// maximum change of the log hyperparameters
+			double maxHypChange(0);
+			for(int i = 0; i < logHyp.mean.size(); i++)	maxHypChange = max<double>(maxHypChange, fabs(logHyp.mean(i) - prevLogHyp.mean(i)));
+			for(int i = 0; i < logHyp.cov.size(); i++)	maxHypChange = max<double>(maxHypChange, fabs(logHyp.cov(i)  - prevLogHyp.cov(i)));
+			for(int i = 0; i < logHyp.lik.size(); i++)	maxHypChange = max<double>(maxHypChange, fabs(logHyp.lik(i)  - prevLogHyp.lik(i)));
+
+			// mean over the blocks actually evaluated, not the ones skipped for too few points
+			const size_t numEvaluatedBlocks = numBlocksToEvaluate();
+			const GP::DlibScalar meanNlZ = nlZ / static_cast<GP::DlibScalar>(max<size_t>(1, numEvaluatedBlocks));
+
+			// convergence
+			const bool fConverged = monitor.update(meanNlZ, maxHypChange);
+
+			// log
+			logFile << "mini-batch [" << step << "] " << numEvaluatedBlocks << " evaluated in " << batchSize << " of " << NUM_BLOCKS << " blocks, "
+					  << "mean nlZ: " << meanNlZ << ", "
+					  << "smoothed: " << monitor.smoothedNlZ() << ", "
+					  << "max hyp change: " << maxHypChange << std::endl;
+
+			if(fConverged)
+			{
+				logFile << "mini-batch training converged after " << step + 1 << " steps" << std::endl;
+				break;
+			}
+		}
+
+		return monitor.smoothedNlZ();
+	}
+
+	/** @brief		Number of blocks evaluated by operator()
+	  * @details	They are the selected blocks with at least MIN_NUM_POINTS_TO_PREDICT_ points.
+	  */
+	size_t numBlocksToEvaluate() const
+	{
+		size_t numBlocks(0);
+		pcl::octree::OctreeKey key;
+#ifdef CONST_LEAF_NODE_ITERATOR_
+		LeafNodeIterator iter(*this);
+		while(*++iter)
+		{
+			const LeafNode* pLeafNode = static_cast<LeafNode*>(iter.getCurrentOctreeNode());
+#else
+		for(size_t i = 0; i < m_numRandomBlocks && i < m_nonEmptyBlockCenterPointXYZList.size(); i++)
+		{
+			genOctreeKeyforPointXYZ(m_nonEmptyBlockCenterPointXYZList[i], key);
+			const LeafNode* pLeafNode = findLeaf(key);
+#endif
+			if(pLeafNode && pLeafNode->getDataTVector().size() >= MIN_NUM_POINTS_TO_PREDICT_) numBlocks++;
+		}
+		return numBlocks;
+	}
+
+	/** @brief		Operator for optimizing hyperparameters
 	  * @return		Sum of negative log marginalizations of all leaf nodes
 	  * @todo		Do not cover all of the leaf nodes, but select some(10,100) of them randomly
 	 */
@@ -374,8 +553,8 @@ public:
 		// total number of calls
 		static size_t numCalls = 0;
 
-		// log file
-		LogFile logFile;
+		// log message of this evaluation
+		std::ostringstream logStream;
 
 		// Sum of negative log marginalizations of all leaf nodes
 		GP::DlibScalar sumNlZ(0);
@@ -385,11 +564,14 @@ public:
 		GP::Dlib2Hyp<Scalar, MeanFunc, CovFunc, LikFunc>(logDlib, logHyp);
 
 		// log
-		logFile << "[" << numCalls++ << "] (";
-		for(int i = 0; i < logHyp.mean.size(); i++) { logFile  << exp(logHyp.mean(i)) << ", "; }
-		for(int i = 0; i < logHyp.cov.size(); i++)  { logFile  << exp(logHyp.cov(i))  << ", "; }
-		for(int i = 0; i < logHyp.lik.size(); i++)  { logFile  << exp(logHyp.lik(i))  << (i < logHyp.lik.size()-1 ? ", " : ""); }
-		logFile << "): ";
+		logStream << "[" << numCalls++ << "] (";
+		for(int i = 0; i < logHyp.mean.size(); i++) { logStream  << exp(logHyp.mean(i)) << ", "; }
+		for(int i = 0; i < logHyp.cov.size(); i++)  { logStream  << exp(logHyp.cov(i))  << ", "; }
+		for(int i = 0; i < logHyp.lik.size(); i++)  { logStream  << exp(logHyp.lik(i))  << (i < logHyp.lik.size()-1 ? ", " : ""); }
+		logStream << "): ";
+
+		// partition buffer reused for all blocks
+		PartitionBuffer	partitionBuffer;
 
 		// for each leaf node
 		pcl::octree::OctreeKey key;
@@ -407,6 +589,7 @@ public:
 		{				
 			// leaf node corresponding the octree key
 #ifdef CONST_LEAF_NODE_ITERATOR_
+			key = iter.getCurrentOctreeKey();
 			const LeafNode* pLeafNode = static_cast<LeafNode*>(iter.getCurrentOctreeNode())->getDataTVector();
 #else
 			// key
@@ -420,22 +603,26 @@ public:
 			// if there is two small number of points in the node, ignore it
 			if(indexList.size() < MIN_NUM_POINTS_TO_PREDICT_) continue;
 
+			// random stream of the block
+			RandomGenerator rng = m_randomStreams.stream(genBlockCode(key), RANDOM_STREAM_TRAINING_PARTITION);
+
 			// negative log marginal likelihood
 			try
 			{
-				sumNlZ += negativeLogMarginalLikelihood(logHyp, indexList);
+				sumNlZ += negativeLogMarginalLikelihood(logHyp, indexList, partitionBuffer, rng);
 			}
 			// if Kn is non positivie definite, nlZ = Inf
 			catch(GP::Exception &e) 
 			{
-				logFile << e.what() << " = ";
+				logStream << e.what() << " = ";
 				sumNlZ = std::numeric_limits<Scalar>::infinity();
 				break;
 			}
 		}
 
 		// log
-		logFile << sumNlZ << std::endl;
+		logStream << sumNlZ;
+		GPMAP_LOG_INFO(logStream.str());
 		//		  << " with avg " << static_cast<int>(static_cast<float>(totalNumPoints) / static_cast<float>(blockCount)) << " points "
 		//		  << "in " << blockCount << " of " << m_nonEmptyBlockCenterPointXYZList.size() << " blocks "
 		//		  << "during " << timer.elapsed().wall_clock_time() << " sec" << std::endl;
@@ -446,46 +633,62 @@ public:
 	/** @brief		Negative log marginal likelihood given */
 	GP::DlibScalar negativeLogMarginalLikelihood /* throw (Exception) */
 															  (const Hyp &logHyp, const Indices &indexList) const
+	{
+		PartitionBuffer	partitionBuffer;
+		RandomGenerator	rng;
+		return negativeLogMarginalLikelihood(logHyp, indexList, partitionBuffer, rng);
+	}
+
+	/** @brief		Negative log marginal likelihood given
+	  * @details	The partition buffer and the random number generator are reused by the caller.
+	  */
+	GP::DlibScalar negativeLogMarginalLikelihood /* throw (Exception) */
+															  (const Hyp &logHyp, const Indices &indexList,
+															   PartitionBuffer &partitionBuffer, RandomGenerator &rng) const
 	{
 		// negative log marginal likelihood
 		GP::DlibScalar nlZ(0);
 
 		// if the data is too big, divide and conquer
 		// assume that subset training data are independent
-		std::vector<std::vector<int> > partitionedIndices;
-		if(random_data_partition(indexList, MAX_NUM_POINTS_TO_PREDICT_, partitionedIndices))
+		if(partitionBuffer.partition(indexList.begin(), indexList.end(), MAX_NUM_POINTS_TO_PREDICT_, rng))
 		{
-			// do it recursively
-			for(size_t i = 0; i < partitionedIndices.size(); i++)
+			for(size_t i = 0; i < partitionBuffer.size(); i++)
 			{
-				// predict recursively
-				nlZ += negativeLogMarginalLikelihood(logHyp, partitionedIndices[i]);
+				nlZ += negativeLogMarginalLikelihood(logHyp, partitionBuffer.begin(i), partitionBuffer.end(i));
 			}
 		}
 		else
 		{
-			// if too small number of data is left by divide and conquer, ignore it
-			if(indexList.size() < MIN_NUM_POINTS_TO_PREDICT_) return nlZ;
-
-			// training data
-			MatrixPtr pX, pXd; VectorPtr pYYd;
-			generateTrainingData(input_, indexList, m_gap, pX, pXd, pYYd);	
-			GP::DerivativeTrainingData<float> derivativeTrainingData;
-			derivativeTrainingData.set(pX, pXd, pYYd);
-
-			// negative log marginalikelihood
-			Scalar tempNlZ;
-			GPType::negativeLogMarginalLikelihood(logHyp, 
-															  derivativeTrainingData,
-															  tempNlZ, 
-															  VectorPtr(),
-															  1);  /* throw (Exception) */
-			nlZ = static_cast<GP::DlibScalar>(tempNlZ);
+			nlZ = negativeLogMarginalLikelihood(logHyp, indexList.begin(), indexList.end());
 		}
 
 		return nlZ;
 	}
 
+	/** @brief		Negative log marginal likelihood of an index range without partitioning */
+	GP::DlibScalar negativeLogMarginalLikelihood /* throw (Exception) */
+															  (const Hyp &logHyp, Indices::const_iterator first, Indices::const_iterator last) const
+	{
+		// if too small number of data is left by divide and conquer, ignore it
+		if(static_cast<size_t>(std::distance(first, last)) < MIN_NUM_POINTS_TO_PREDICT_) return GP::DlibScalar(0);
+
+		// training data
+		MatrixPtr pX, pXd; VectorPtr pYYd;
+		generateTrainingData(input_, first, last, m_gap, pX, pXd, pYYd);
+		GP::DerivativeTrainingData<float> derivativeTrainingData;
+		derivativeTrainingData.set(pX, pXd, pYYd);
+
+		// negative log marginalikelihood
+		Scalar tempNlZ;
+		GPType::negativeLogMarginalLikelihood(logHyp, 
+														  derivativeTrainingData,
+														  tempNlZ, 
+														  VectorPtr(),
+														  1);  /* throw (Exception) */
+		return static_cast<GP::DlibScalar>(tempNlZ);
+	}
+
 	/** @brief		Update the GPMap with new observations
 	  * @return		Elapsed time (user/system/wall cpu times)
 	  */
@@ -495,6 +698,8 @@ public:
 					CPU_Times		&t_predict_total,
 					CPU_Times		&t_combine_total)
 	{
+		GPMAP_TRACE_ZONE("update");
+
 #ifdef _TEST_OCTREE_GPMAP
 		PCL_INFO("More than one points should be dangled in itself or neighbors.\n");
 #endif
@@ -510,6 +715,13 @@ public:
 		CPU_Times	t_predict;
 		CPU_Times	t_combine;
 
+		// per-block statistics
+		m_blockStatistics.clear();
+
+		// memory high-water mark
+		m_memoryUsageInUpdate	= memoryUsage();
+		m_memoryHighWaterMark	= m_memoryUsageInUpdate;
+
 		// initialize leaf node
 		// Sigma_0^{-1}
 		GP::TestData<float> testData;
@@ -543,7 +755,7 @@ public:
 					if(t_elapsed_sec > 3600.f)			logFile << "during " << t_elapsed_sec/3600.f	<< " hr" << std::endl;
 					else if(t_elapsed_sec > 60.f)		logFile << "during " << t_elapsed_sec/60.f		<< " min" << std::endl;
 					else										logFile << "during " << t_elapsed_sec				<< " sec" << std::endl;
-					nextProgress += nextProgress;
+					nextProgress += 5;
 				}
 
 				// key
@@ -568,7 +780,11 @@ public:
 				LeafNode *pLeafNode = static_cast<LeafNode *>(iter.getCurrentOctreeNode());
 
 				// predict
-				predict(logHyp, indexList, min_pt, pLeafNode, maxIter, t_training, t_predict, t_combine);
+				const size_t numCholeskyRetries	= BCM::numCholeskyRetries();
+				const size_t leafMemoryUsage		= pLeafNode->dataMemoryUsage();
+				predictBlock(logHyp, key, indexList, min_pt, pLeafNode, maxIter, t_training, t_predict, t_combine);
+				addBlockStatistics(key, indexList, BCM::numCholeskyRetries() - numCholeskyRetries, t_training, t_predict, t_combine);
+				updateMemoryHighWaterMark(pLeafNode->dataMemoryUsage(), leafMemoryUsage, m_blockStatistics.back());
 				t_training_total	+= t_training;
 				t_predict_total	+= t_predict;
 				t_combine_total	+= t_combine;
@@ -616,7 +832,7 @@ public:
 					if(t_elapsed_sec > 3600.f)			logFile << "during " << t_elapsed_sec/3600.f	<< " hr" << std::endl;
 					else if(t_elapsed_sec > 60.f)		logFile << "during " << t_elapsed_sec/60.f		<< " min" << std::endl;
 					else										logFile << "during " << t_elapsed_sec				<< " sec" << std::endl;
-					nextProgress += nextProgress;
+					nextProgress += 5;
 				}
 
 				// key
@@ -668,7 +884,11 @@ public:
 				LeafNode *pLeafNode = static_cast<LeafNode *>(iter.getCurrentOctreeNode());
 
 				// predict
-				predict(logHyp, indexList, min_pt, pLeafNode, maxIter, t_training, t_predict, t_combine);
+				const size_t numCholeskyRetries	= BCM::numCholeskyRetries();
+				const size_t leafMemoryUsage		= pLeafNode->dataMemoryUsage();
+				predictBlock(logHyp, key, indexList, min_pt, pLeafNode, maxIter, t_training, t_predict, t_combine);
+				addBlockStatistics(key, indexList, BCM::numCholeskyRetries() - numCholeskyRetries, t_training, t_predict, t_combine);
+				updateMemoryHighWaterMark(pLeafNode->dataMemoryUsage(), leafMemoryUsage, m_blockStatistics.back());
 				t_training_total	+= t_training;
 				t_predict_total	+= t_predict;
 				t_combine_total	+= t_combine;
@@ -687,6 +907,18 @@ public:
 		// reset prior
 		BCM::resetPrior();
 
+		// per-block cost summaries
+		logFile << "blocks: " << m_blockStatistics.size() << std::endl;
+		logFile << "field,p50,p95,p99,max" << std::endl;
+		BlockStatisticsList::writeSummary(logFile, "num_points",			m_blockStatistics.summary(&BlockStatistics::numPoints));
+		BlockStatisticsList::writeSummary(logFile, "train_ns",			m_blockStatistics.summary(&BlockStatistics::train_ns));
+		BlockStatisticsList::writeSummary(logFile, "predict_ns",		m_blockStatistics.summary(&BlockStatistics::predict_ns));
+		BlockStatisticsList::writeSummary(logFile, "combine_ns",		m_blockStatistics.summary(&BlockStatistics::combine_ns));
+
+		// memory
+		logFile << "memory: " << m_memoryUsageInUpdate << " bytes, "
+				  << "high-water mark: " << m_memoryHighWaterMark << " bytes" << std::endl;
+
 		//logFile << "min: (" << minX_ << ", " << minY_ << ", " << minZ_ << "), "
 		//		  << "max: (" << maxX_ << ", " << maxY_ << ", " << maxZ_ << ")" << std::endl;
 	}
@@ -814,21 +1046,17 @@ public:
 							 const float				occupancyThreshold,
 							 const bool					fRemoveIsolatedCells)
 	{
+		GPMAP_TRACE_ZONE("saveAsOctomap");
+
 		// octomap
-		OctoMap octomap(CELL_SIZE_);
+		OctoMap<NO_COLOR> octomap(CELL_SIZE_);
 
 		// occupied cell centers
 		PointXYZVList cellCenterPointXYZVector;
 		if(getOccupiedCellCenters(cellCenterPointXYZVector, occupancyThreshold, fRemoveIsolatedCells) == 0) return false;
 
 		// update occupied nodes
-		for(size_t i = 0; i < cellCenterPointXYZVector.size(); i++)
-		{
-			const pcl::PointXYZ &point = cellCenterPointXYZVector[i];
-
-			// updateNode or setNodeValue
-			octomap.updateNode(static_cast<double>(point.x), static_cast<double>(point.y), static_cast<double>(point.z), true);
-		}
+		octomap.updateNodes(cellCenterPointXYZVector, true);
 
 		// save
 		return octomap.save(strFilenameWithoutExtension);
@@ -839,8 +1067,13 @@ public:
 							 const float				minMeanThreshold,
 							 const float				maxVarThreshold)
 	{
+		GPMAP_TRACE_ZONE("saveAsOctomap");
+
 		// octomap
-		OctoMap octomap(CELL_SIZE_);
+		OctoMap<NO_COLOR> octomap(CELL_SIZE_);
+
+		// occupied cell centers
+		PointXYZVList cellCenterPointXYZVector;
 
 		// leaf node iterator
 		LeafNodeIterator iter(*this);
@@ -885,10 +1118,9 @@ public:
 						// if the condition is satisfied
 						if((*pMean)(row) >= minMeanThreshold && (*pVariance)(row, 0) <= maxVarThreshold)
 						{
-							octomap.updateNode(static_cast<double>((*m_pXs)(row, 0) + min_pt.x() + HALF_CELL_SIZE), 
-													 static_cast<double>((*m_pXs)(row, 1) + min_pt.y() + HALF_CELL_SIZE),
-													 static_cast<double>((*m_pXs)(row, 2) + min_pt.z() + HALF_CELL_SIZE),
-													 true);
+							cellCenterPointXYZVector.push_back(pcl::PointXYZ((*m_pXs)(row, 0) + min_pt.x() + HALF_CELL_SIZE, 
+																							 (*m_pXs)(row, 1) + min_pt.y() + HALF_CELL_SIZE,
+																							 (*m_pXs)(row, 2) + min_pt.z() + HALF_CELL_SIZE));
 
 							// min, max
 							minMean	= min<float>(minMean,	(*pMean)(row));
@@ -900,6 +1132,11 @@ public:
 					}
 		}
 
+		// update occupied nodes
+		octomap.updateNodes(cellCenterPointXYZVector, true);
+
+		// log
+		LogFile logFile;
 		logFile << "Min Mean: " << minMean << std::endl;
 		logFile << "Max Mean: " << maxMean << std::endl;
 		logFile << "Min Var: "  << minVar  << std::endl;
@@ -915,6 +1152,23 @@ public:
 	/** @brief Save as an octomap */
 	void saveAsPointCloud(const std::string &strFilePathWithoutExtension)
 	{
+		const float MAX_VALUE = std::numeric_limits<float>::max();
+		saveAsPointCloud(strFilePathWithoutExtension,
+							  pcl::PointXYZ(-MAX_VALUE, -MAX_VALUE, -MAX_VALUE),
+							  pcl::PointXYZ( MAX_VALUE,  MAX_VALUE,  MAX_VALUE));
+	}
+
+	/** @brief		Save the blocks whose centers are in a region as a point cloud
+	  * @details	The region is [min_region, max_region), so adjacent regions do not share blocks.
+	  *				It is used for flushing the finalized blocks of a streaming build.
+	  * @return		Number of saved blocks
+	  */
+	size_t saveAsPointCloud(const std::string		&strFilePathWithoutExtension,
+									const pcl::PointXYZ	&min_region,
+									const pcl::PointXYZ	&max_region)
+	{
+		GPMAP_TRACE_ZONE("saveAsPointCloud");
+
 		// point normal cloud
 		pcl::PointCloud<pcl::PointNormal>::Ptr pPointNormalCloud(new pcl::PointCloud<pcl::PointNormal>());
 
@@ -933,6 +1187,7 @@ public:
 		size_t nBlocks(0);
 		size_t nCells(0);
 		pcl::PointNormal	pointNormal;
+		const float HALF_BLOCK_SIZE = static_cast<float>(BLOCK_SIZE_) / 2.f;
 		while(*++iter)
 		{
 			// key
@@ -941,6 +1196,14 @@ public:
 			// min point
 			genVoxelMinPoint(key, min_pt);
 
+			// region
+			const float centerX = min_pt.x() + HALF_BLOCK_SIZE;
+			const float centerY = min_pt.y() + HALF_BLOCK_SIZE;
+			const float centerZ = min_pt.z() + HALF_BLOCK_SIZE;
+			if(centerX < min_region.x || centerX >= max_region.x ||
+				centerY < min_region.y || centerY >= max_region.y ||
+				centerZ < min_region.z || centerZ >= max_region.z) continue;
+
 			// leaf node
 			LeafNode *pLeafNode = static_cast<LeafNode *>(iter.getCurrentOctreeNode());
 
@@ -988,6 +1251,8 @@ public:
 		// save
 		const bool fBinary = true;
 		savePointCloud<pcl::PointNormal>	(pPointNormalCloud,	strFilePathWithoutExtension + ".pcd", fBinary);
+
+		return nBlocks;
 	}
 
 
@@ -1053,6 +1318,553 @@ public:
 		return CELL_SIZE_;
 	}
 
+	/** @brief		Set the map seed
+	  * @details	Random numbers for sampling blocks and for partitioning or sampling points of a block
+	  *				are drawn from streams derived from this seed, the block and the call site,
+	  *				so the same seed gives the same map regardless of the processing order of blocks.
+	  */
+	void setRandomSeed(const boost::uint64_t seed)
+	{
+		m_randomStreams.seed(seed);
+		m_numBlockSamplings = 0;
+	}
+
+	/** @brief		Enable or disable the per-block hyperparameter cache for local training
+	  * @details	When it is enabled and maxIter > 0 in update(), the trained hyperparameters of each block are kept.
+	  *				A revisited block reuses its own cached values without training
+	  *				unless its number of points changed by more than the relative tolerance,
+	  *				and a new block warm-starts from the average of its already trained neighbors.
+	  * @param[in]	fEnable						Flag for the cache
+	  * @param[in]	pointCountTolerance		Relative change of the number of points to retrain a cached block
+	  */
+	void setHypCache(const bool fEnable, const float pointCountTolerance = 0.1f)
+	{
+		m_fHypCache							= fEnable;
+		m_hypCachePointCountTolerance	= max<float>(0.f, pointCountTolerance);
+	}
+
+	/** @brief		Change the number of points to predict a block and the random sampling for the following updates
+	  * @details	Unlike the block size, the number of cells and the BCM mode, they do not change the octree,
+	  *				so a parameter sweep can reuse the map with clearBlockStates() between the runs.
+	  */
+	void setPredictionSettings(const size_t	MIN_NUM_POINTS_TO_PREDICT,
+										const size_t	MAX_NUM_POINTS_TO_PREDICT,
+										const bool		FLAG_RAMDOMLY_SAMPLE_POINTS)
+	{
+		MIN_NUM_POINTS_TO_PREDICT_		= max<size_t>(1, MIN_NUM_POINTS_TO_PREDICT);
+		MAX_NUM_POINTS_TO_PREDICT_		= static_cast<int>(MAX_NUM_POINTS_TO_PREDICT);
+		FLAG_RAMDOMLY_SAMPLE_POINTS_	= FLAG_RAMDOMLY_SAMPLE_POINTS;
+	}
+
+	/** @brief		Clear the BCM states of the leaf nodes keeping their point indices
+	  * @details	The hyperparameter cache and the block sampling counter are cleared as well,
+	  *				so the next update() gives the same map as a new one built from the same points.
+	  */
+	void clearBlockStates()
+	{
+		// leaf node iterator
+		LeafNodeIterator iter(*this);
+
+		// for each leaf node
+		while(*++iter)
+		{
+			LeafNode *pLeafNode = static_cast<LeafNode*>(iter.getCurrentOctreeNode());
+			pLeafNode->clearState();
+		}
+
+		m_hypCache.clear();
+		m_numBlockSamplings = 0;
+	}
+
+	/** @brief Clear the per-block hyperparameter cache */
+	void clearHypCache()
+	{
+		m_hypCache.clear();
+	}
+
+	/** @brief Number of blocks in the hyperparameter cache */
+	size_t getHypCacheSize() const
+	{
+		return m_hypCache.size();
+	}
+
+	/** @brief		Per-block statistics of the last update()
+	  * @details	Each record has the key, the number of points with its Nf/Nd split, the number of partitions,
+	  *				the number of Cholesky retries in the BCM and the train/predict/combine wall-clock times.
+	  *				It can be summarized by BlockStatisticsList::summary() or saved by BlockStatisticsList::saveAsCSV().
+	  */
+	const BlockStatisticsList& getBlockStatistics() const
+	{
+		return m_blockStatistics;
+	}
+
+	/** @brief		Memory usage in bytes with its breakdown
+	  * @details	It visits all leaf nodes, so it takes time linear in the number of blocks.
+	  */
+	size_t memoryUsage(OctreeGPMapMemoryUsage &usage) const
+	{
+		usage = OctreeGPMapMemoryUsage();
+
+		// map object with its nodes
+		usage.octree = sizeof(*this) + this->getLeafCount()*sizeof(LeafNode) + this->getBranchCount()*sizeof(BranchNode);
+
+		// leaf nodes (there is no const leaf node iterator in PCL 1.6)
+		LeafNodeIterator iter(*const_cast<OctreeGPMapType *>(this));
+		while(*++iter)
+		{
+			const LeafNode *pLeafNode = static_cast<const LeafNode *>(iter.getCurrentOctreeNode());
+			usage.indices	+= pLeafNode->indexMemoryUsage();
+			usage.leafData	+= pLeafNode->dataMemoryUsage();
+		}
+
+		// test positions
+		usage.testPositions = heapMemoryUsage(m_pXs);
+
+		// sorted cloud
+		if(m_pSortedCloud) usage.sortedCloud = sizeof(pcl::PointCloud<MyPoinT>) + heapMemoryUsage(m_pSortedCloud->points);
+		usage.sortedCloud += heapMemoryUsage(m_blockRanges);
+
+		// caches
+		usage.caches = heapMemoryUsage(m_hypCache)
+						 + m_partitionBuffer.memoryUsage() - sizeof(PartitionBuffer)
+						 + heapMemoryUsage(m_workspace.pX) + heapMemoryUsage(m_workspace.pXd) + heapMemoryUsage(m_workspace.pYYd) + heapMemoryUsage(m_workspace.pXs)
+						 + heapMemoryUsage(m_blockStatistics);
+		for(typename HypCache::const_iterator iter = m_hypCache.begin(); iter != m_hypCache.end(); iter++)
+		{
+			const Hyp &logHyp = iter->second->logHyp;
+			usage.caches += sizeof(BlockHyp) + heapMemoryUsage(logHyp.mean) + heapMemoryUsage(logHyp.cov) + heapMemoryUsage(logHyp.lik);
+		}
+#ifndef CONST_LEAF_NODE_ITERATOR_
+		usage.caches += heapMemoryUsage(m_nonEmptyBlockCenterPointXYZList);
+#endif
+
+		return usage.total();
+	}
+
+	/** @brief		Memory usage in bytes */
+	size_t memoryUsage() const
+	{
+		OctreeGPMapMemoryUsage usage;
+		return memoryUsage(usage);
+	}
+
+	/** @brief		Peak memory usage in bytes during the last update()
+	  * @details	It is the memory usage before the update plus the growth of the leaf nodes so far
+	  *				and the estimated GP working set of the largest partition at each block.
+	  *				The working set has the training data, the covariance matrix with its Cholesky factor,
+	  *				the cross covariance to the test positions and the predictive mean and [co]variance.
+	  */
+	size_t getMemoryHighWaterMark() const
+	{
+		return m_memoryHighWaterMark;
+	}
+
+	/** @brief		Enable or disable sorting the input cloud by the Morton codes of blocks
+	  * @details	When it is enabled, addPointsFromInputCloud() replaces the input cloud with a sorted copy of its finite points,
+	  *				so the points of each block are contiguous and gathering them for training data is a streaming read
+	  *				instead of scattered accesses over the whole cloud.
+	  *				Note that the point indices in the leaf nodes refer to the sorted copy, which can be obtained by getInputCloud().
+	  */
+	void setSpatialSorting(const bool fEnable)
+	{
+		m_fSpatialSorting = fEnable;
+	}
+
+	/** @brief		Save the map state as a checkpoint in a raw binary format
+	  * @details	It has the settings, the bounding box with the tree depth, the random streams,
+	  *				the progress with the number and the fingerprint of the point clouds being processed,
+	  *				the hyperparameter cache and the key and BCM state of each block.
+	  *				The point indices in the blocks are not saved, since they are reset for the next point cloud.
+	  *				It is written to a temporary file which then replaces the file,
+	  *				so an interruption during saving does not corrupt the previous checkpoint,
+	  *				and the temporary file is removed if saving fails.
+	  * @param[in]	strFilePath			Checkpoint file path
+	  * @param[in]	nextCloudIndex		Index of the next point cloud to process after resuming
+	  * @param[in]	numClouds			Number of point clouds being processed (0 if none, e.g. a merged map)
+	  * @param[in]	cloudsFingerprint	Fingerprint of the point clouds to detect resuming with different ones
+	  * @return		False if the file cannot be written
+	  */
+	bool saveCheckpoint(const std::string		&strFilePath, 
+							  const size_t				nextCloudIndex,
+							  const size_t				numClouds = 0,
+							  const boost::uint64_t	cloudsFingerprint = 0) const
+	{
+		GPMAP_TRACE_ZONE("saveCheckpoint");
+
+		// temporary file
+		const std::string strTempFilePath(strFilePath + ".tmp");
+		bool fSuccess(false);
+		{
+			std::ofstream fout(strTempFilePath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			if(fout) fSuccess = writeCheckpoint(fout, nextCloudIndex, numClouds, cloudsFingerprint);
+		}
+
+		// replace or remove
+		boost::system::error_code ec;
+		if(fSuccess) boost::filesystem::rename(strTempFilePath, strFilePath, ec);
+		if(!fSuccess || ec)
+		{
+			boost::system::error_code ecRemove;
+			boost::filesystem::remove(strTempFilePath, ecRemove);
+			return false;
+		}
+		return true;
+	}
+
+	/** @brief		Resume the map from a checkpoint saved by saveCheckpoint()
+	  * @details	The point clouds being processed are not checked.
+	  */
+	bool loadCheckpoint(const std::string &strFilePath, size_t &nextCloudIndex)
+	{
+		size_t numClouds;
+		boost::uint64_t cloudsFingerprint;
+		return loadCheckpoint(strFilePath, nextCloudIndex, numClouds, cloudsFingerprint);
+	}
+
+protected:
+	/** @brief Write the checkpoint to a stream */
+	bool writeCheckpoint(std::ostream				&fout, 
+								const size_t				nextCloudIndex,
+								const size_t				numClouds,
+								const boost::uint64_t	cloudsFingerprint) const
+	{
+		// header
+		fout.write(OCTREE_GPMAP_CHECKPOINT_MAGIC, sizeof(OCTREE_GPMAP_CHECKPOINT_MAGIC));
+		writeBinary(fout, OCTREE_GPMAP_CHECKPOINT_VERSION);
+
+		// settings
+		writeBinary(fout, BLOCK_SIZE_);
+		writeBinary(fout, static_cast<boost::uint64_t>(NUM_CELLS_PER_AXIS_));
+		writeBinary(fout, static_cast<unsigned char>(FLAG_INDEPENDENT_TEST_POSITIONS_ ? 1 : 0));
+
+		// bounding box and tree depth
+		writeBinary(fout, minX_);	writeBinary(fout, minY_);	writeBinary(fout, minZ_);
+		writeBinary(fout, maxX_);	writeBinary(fout, maxY_);	writeBinary(fout, maxZ_);
+		writeBinary(fout, static_cast<boost::uint32_t>(this->getTreeDepth()));
+
+		// random streams and progress
+		writeBinary(fout, m_randomStreams.seed());
+		writeBinary(fout, m_numBlockSamplings);
+		writeBinary(fout, static_cast<boost::uint64_t>(nextCloudIndex));
+		writeBinary(fout, static_cast<boost::uint64_t>(numClouds));
+		writeBinary(fout, cloudsFingerprint);
+
+		// hyperparameter cache
+		writeBinary(fout, static_cast<boost::uint64_t>(m_hypCache.size()));
+		for(typename HypCache::const_iterator iter = m_hypCache.begin(); iter != m_hypCache.end(); iter++)
+		{
+			writeBinary(fout, iter->first);
+			writeBinary(fout, static_cast<boost::uint64_t>(iter->second->numPoints));
+			writeMatrixBinary(fout, iter->second->logHyp.mean);
+			writeMatrixBinary(fout, iter->second->logHyp.cov);
+			writeMatrixBinary(fout, iter->second->logHyp.lik);
+		}
+
+		// blocks (there is no const leaf node iterator in PCL 1.6)
+		writeBinary(fout, static_cast<boost::uint64_t>(this->getLeafCount()));
+		LeafNodeIterator iter(*const_cast<OctreeGPMapType *>(this));
+		while(*++iter)
+		{
+			const pcl::octree::OctreeKey &key = iter.getCurrentOctreeKey();
+			writeBinary(fout, static_cast<boost::uint32_t>(key.x));
+			writeBinary(fout, static_cast<boost::uint32_t>(key.y));
+			writeBinary(fout, static_cast<boost::uint32_t>(key.z));
+
+			LeafNode *pLeafNode = static_cast<LeafNode *>(iter.getCurrentOctreeNode());
+			if(!pLeafNode->writeState(fout)) return false;
+		}
+		fout.flush();
+		return fout.good();
+	}
+
+public:
+	/** @brief		Resume the map from a checkpoint saved by saveCheckpoint()
+	  * @details	The map should be empty and constructed with the same settings.
+	  *				Since the leaf nodes are created directly from their keys,
+	  *				the bounding box and the tree depth are restored as they were, not by defineBoundingBox().
+	  * @param[in]	strFilePath			Checkpoint file path
+	  * @param[out]	nextCloudIndex		Index of the next point cloud to process
+	  * @param[out]	numClouds			Number of point clouds being processed when it was saved
+	  * @param[out]	cloudsFingerprint	Fingerprint of the point clouds being processed when it was saved
+	  * @return		False if the file cannot be read or does not match the settings
+	  */
+	bool loadCheckpoint(const std::string	&strFilePath, 
+							  size_t					&nextCloudIndex, 
+							  size_t					&numClouds, 
+							  boost::uint64_t		&cloudsFingerprint)
+	{
+		GPMAP_TRACE_ZONE("loadCheckpoint");
+
+		// log file
+		LogFile logFile;
+
+		// empty map only
+		if(this->getLeafCount() > 0)
+		{
+			logFile << "loadCheckpoint: the map is not empty" << std::endl;
+			return false;
+		}
+
+		// open
+		std::ifstream fin(strFilePath.c_str(), std::ios::in | std::ios::binary);
+		if(!fin) return false;
+
+		// header
+		char magic[sizeof(OCTREE_GPMAP_CHECKPOINT_MAGIC)];
+		boost::uint32_t version;
+		if(!fin.read(magic, sizeof(magic)) || memcmp(magic, OCTREE_GPMAP_CHECKPOINT_MAGIC, sizeof(magic)) != 0 ||
+			!readBinary(fin, version) || version != OCTREE_GPMAP_CHECKPOINT_VERSION)
+		{
+			logFile << "loadCheckpoint: not a checkpoint file of this version - " << strFilePath << std::endl;
+			return false;
+		}
+
+		// settings
+		double				blockSize;
+		boost::uint64_t	numCellsPerAxis;
+		unsigned char		fIndependentTestPositions;
+		if(!readBinary(fin, blockSize) || !readBinary(fin, numCellsPerAxis) || !readBinary(fin, fIndependentTestPositions)) return false;
+		if(blockSize != BLOCK_SIZE_ || numCellsPerAxis != NUM_CELLS_PER_AXIS_ ||
+			(fIndependentTestPositions != 0) != FLAG_INDEPENDENT_TEST_POSITIONS_)
+		{
+			logFile << "loadCheckpoint: different settings - "
+					  << "BLOCK_SIZE: " << blockSize << ", "
+					  << "NUM_CELLS_PER_AXIS: " << numCellsPerAxis << ", "
+					  << "FLAG_INDEPENDENT_TEST_POSITIONS: " << static_cast<int>(fIndependentTestPositions) << std::endl;
+			return false;
+		}
+
+		// bounding box and tree depth
+		double minX, minY, minZ, maxX, maxY, maxZ;
+		boost::uint32_t depth;
+		if(!readBinary(fin, minX) || !readBinary(fin, minY) || !readBinary(fin, minZ) ||
+			!readBinary(fin, maxX) || !readBinary(fin, maxY) || !readBinary(fin, maxZ) ||
+			!readBinary(fin, depth)) return false;
+
+		// random streams and progress
+		boost::uint64_t seed, numBlockSamplings, nextCloud, numCloudsSaved, fingerprint;
+		if(!readBinary(fin, seed) || !readBinary(fin, numBlockSamplings) ||
+			!readBinary(fin, nextCloud) || !readBinary(fin, numCloudsSaved) || !readBinary(fin, fingerprint)) return false;
+		if(numCloudsSaved > 0 && nextCloud > numCloudsSaved)
+		{
+			logFile << "loadCheckpoint: next cloud index " << nextCloud << " is over the number of clouds " << numCloudsSaved << std::endl;
+			return false;
+		}
+
+		// hyperparameter cache
+		boost::uint64_t numCachedBlocks;
+		if(!readBinary(fin, numCachedBlocks)) return false;
+		HypCache hypCache;
+		for(boost::uint64_t i = 0; i < numCachedBlocks; i++)
+		{
+			boost::uint64_t code, numPoints;
+			BlockHypPtr pBlockHyp(new BlockHyp());
+			if(!readBinary(fin, code) || !readBinary(fin, numPoints) ||
+				!readMatrixBinary(fin, pBlockHyp->logHyp.mean) ||
+				!readMatrixBinary(fin, pBlockHyp->logHyp.cov) ||
+				!readMatrixBinary(fin, pBlockHyp->logHyp.lik))
+			{
+				logFile << "loadCheckpoint: corrupted hyperparameter cache " << i << " of " << numCachedBlocks << std::endl;
+				return false;
+			}
+			pBlockHyp->numPoints = static_cast<size_t>(numPoints);
+			hypCache[code] = pBlockHyp;
+		}
+
+		// number of blocks
+		boost::uint64_t numBlocks;
+		if(!readBinary(fin, numBlocks)) return false;
+
+		// restore
+		minX_ = minX;	minY_ = minY;	minZ_ = minZ;
+		maxX_ = maxX;	maxY_ = maxY;	maxZ_ = maxZ;
+		this->setTreeDepth(depth);
+		boundingBoxDefined_ = true;
+		m_randomStreams.seed(seed);
+		m_numBlockSamplings = numBlockSamplings;
+		m_hypCache.swap(hypCache);
+
+		// blocks
+		for(boost::uint64_t i = 0; i < numBlocks; i++)
+		{
+			boost::uint32_t x, y, z;
+			if(!readBinary(fin, x) || !readBinary(fin, y) || !readBinary(fin, z)) return false;
+
+			// create the leaf node
+			const pcl::octree::OctreeKey key(x, y, z);
+			this->addData(key, -1);
+
+			// BCM state
+			LeafNode *pLeafNode = findLeaf(key);
+			assert(pLeafNode);
+			if(!pLeafNode->readState(fin))
+			{
+				logFile << "loadCheckpoint: corrupted block " << i << " of " << numBlocks << std::endl;
+				return false;
+			}
+		}
+
+		nextCloudIndex		= static_cast<size_t>(nextCloud);
+		numClouds			= static_cast<size_t>(numCloudsSaved);
+		cloudsFingerprint	= fingerprint;
+		logFile << "loadCheckpoint: " << numBlocks << " blocks, " << m_hypCache.size() << " cached hyperparameters, "
+				  << "next cloud index: " << nextCloudIndex << " of " << numClouds << std::endl;
+		return true;
+	}
+
+	/** @brief		Merge another map built from a disjoint set of observations
+	  * @details	The blocks of the other map are aligned to this map by their positions,
+	  *				so both maps should have the same settings and their bounding boxes should be on the same grid.
+	  *				defineBoundingBox() keeps every map on the global block grid,
+	  *				so maps built from different subsets of observations can be merged.
+	  *				A new block is created for each block missing in this map,
+	  *				and the BCM states of the blocks are added in parallel by BCM::merge().
+	  *				Each state includes the prior inverse [co]variance once, so the prior of the hyperparameters
+	  *				the maps were updated with is set during the merge, as in update(), to subtract the duplicate.
+	  *				Since the merge of BCM states is associative, partial maps can be reduced in any order.
+	  *				The point indices and the hyperparameter cache of the other map are not merged.
+	  * @param[in]	other		Map to merge
+	  * @param[in]	logHyp	Hyperparameters both maps were updated with
+	  * @return		False if the settings or the grids do not match
+	  */
+	bool merge(const OctreeGPMapType &other, const Hyp &logHyp)
+	{
+		GPMAP_TRACE_ZONE_ARG("merge", "blocks", other.getLeafCount());
+
+		// log file
+		LogFile logFile;
+
+		// itself
+		if(&other == this)
+		{
+			logFile << "merge: the map cannot be merged with itself" << std::endl;
+			return false;
+		}
+
+		// same settings
+		if(BLOCK_SIZE_ != other.BLOCK_SIZE_ || NUM_CELLS_PER_AXIS_ != other.NUM_CELLS_PER_AXIS_ ||
+			FLAG_INDEPENDENT_TEST_POSITIONS_ != other.FLAG_INDEPENDENT_TEST_POSITIONS_)
+		{
+			logFile << "merge: different settings - "
+					  << "BLOCK_SIZE: " << other.BLOCK_SIZE_ << ", "
+					  << "NUM_CELLS_PER_AXIS: " << other.NUM_CELLS_PER_AXIS_ << ", "
+					  << "FLAG_INDEPENDENT_TEST_POSITIONS: " << other.FLAG_INDEPENDENT_TEST_POSITIONS_ << std::endl;
+			return false;
+		}
+
+		// nothing to merge
+		if(other.getLeafCount() == 0) return true;
+
+		// leaf nodes of the other map with the range of their keys (there is no const leaf node iterator in PCL 1.6)
+		typedef std::pair<pcl::octree::OctreeKey, LeafNode*> KeyLeafNode;
+		std::vector<KeyLeafNode> otherLeafNodes;
+		otherLeafNodes.reserve(other.getLeafCount());
+		pcl::octree::OctreeKey minKey, maxKey;
+		LeafNodeIterator iter(*const_cast<OctreeGPMapType *>(&other));
+		while(*++iter)
+		{
+			const pcl::octree::OctreeKey &key = iter.getCurrentOctreeKey();
+			if(otherLeafNodes.empty())
+			{
+				minKey = key;
+				maxKey = key;
+			}
+			minKey.x = min<unsigned int>(minKey.x, key.x);	maxKey.x = max<unsigned int>(maxKey.x, key.x);
+			minKey.y = min<unsigned int>(minKey.y, key.y);	maxKey.y = max<unsigned int>(maxKey.y, key.y);
+			minKey.z = min<unsigned int>(minKey.z, key.z);	maxKey.z = max<unsigned int>(maxKey.z, key.z);
+			otherLeafNodes.push_back(KeyLeafNode(key, static_cast<LeafNode *>(iter.getCurrentOctreeNode())));
+		}
+
+		// bounding box
+		if(!boundingBoxDefined_)
+		{
+			// same as the other map
+			minX_ = other.minX_;	minY_ = other.minY_;	minZ_ = other.minZ_;
+			maxX_ = other.maxX_;	maxY_ = other.maxY_;	maxZ_ = other.maxZ_;
+			this->setTreeDepth(other.getTreeDepth());
+			boundingBoxDefined_ = true;
+		}
+		else
+		{
+			// same grid
+			const double GRID_TOLERANCE = 1e-3;
+			const double offsetX = (other.minX_ - minX_) / BLOCK_SIZE_;
+			const double offsetY = (other.minY_ - minY_) / BLOCK_SIZE_;
+			const double offsetZ = (other.minZ_ - minZ_) / BLOCK_SIZE_;
+			if(fabs(offsetX - floor(offsetX + 0.5)) > GRID_TOLERANCE ||
+				fabs(offsetY - floor(offsetY + 0.5)) > GRID_TOLERANCE ||
+				fabs(offsetZ - floor(offsetZ + 0.5)) > GRID_TOLERANCE)
+			{
+				logFile << "merge: the bounding boxes are not on the same grid - "
+						  << "offset: (" << offsetX << ", " << offsetY << ", " << offsetZ << ") blocks" << std::endl;
+				return false;
+			}
+
+			// make sure bounding box is big enough for the blocks of the other map
+			Eigen::Vector3f min_center, max_center;
+			other.genVoxelMinPoint(minKey, min_center);
+			other.genVoxelMinPoint(maxKey, max_center);
+			min_center.array() += static_cast<float>(BLOCK_SIZE_) / 2.f;
+			max_center.array() += static_cast<float>(BLOCK_SIZE_) / 2.f;
+			MyPoinT min_pt, max_pt;
+			min_pt.x = min_center.x();	min_pt.y = min_center.y();	min_pt.z = min_center.z();
+			max_pt.x = max_center.x();	max_pt.y = max_center.y();	max_pt.z = max_center.z();
+			adoptBoundingBoxToPoint(min_pt);
+			adoptBoundingBoxToPoint(max_pt);
+		}
+
+		// key offsets after adopting the bounding box
+		const int offsetKeyX = static_cast<int>(floor((other.minX_ - minX_) / BLOCK_SIZE_ + 0.5));
+		const int offsetKeyY = static_cast<int>(floor((other.minY_ - minY_) / BLOCK_SIZE_ + 0.5));
+		const int offsetKeyZ = static_cast<int>(floor((other.minZ_ - minZ_) / BLOCK_SIZE_ + 0.5));
+
+		// corresponding leaf nodes of this map, created if necessary
+		typedef std::pair<LeafNode*, LeafNode*> LeafNodePair;
+		std::vector<LeafNodePair> leafNodePairs;
+		leafNodePairs.reserve(otherLeafNodes.size());
+		for(size_t i = 0; i < otherLeafNodes.size(); i++)
+		{
+			const pcl::octree::OctreeKey &otherKey = otherLeafNodes[i].first;
+			assert(static_cast<int>(otherKey.x) + offsetKeyX >= 0 &&
+					 static_cast<int>(otherKey.y) + offsetKeyY >= 0 &&
+					 static_cast<int>(otherKey.z) + offsetKeyZ >= 0);
+			const pcl::octree::OctreeKey key(static_cast<unsigned int>(static_cast<int>(otherKey.x) + offsetKeyX),
+														static_cast<unsigned int>(static_cast<int>(otherKey.y) + offsetKeyY),
+														static_cast<unsigned int>(static_cast<int>(otherKey.z) + offsetKeyZ));
+
+			// add dummy index (-1) to create the leaf node
+			this->addData(key, -1);
+			LeafNode *pLeafNode = findLeaf(key);
+			assert(pLeafNode);
+			leafNodePairs.push_back(LeafNodePair(pLeafNode, otherLeafNodes[i].second));
+		}
+
+		// timer - start
+		CPU_Timer timer;
+
+		// Sigma_0^{-1}
+		GP::TestData<float> testData;
+		testData.set(m_pXs);
+		MatrixPtr pKss = CovFunc<float>::Kss(logHyp.cov, testData, FLAG_INDEPENDENT_TEST_POSITIONS_);
+		BCM::setPrior(pKss);
+
+		// merge the BCM states
+		// the first pair is merged alone to initialize any static state of the leaf type, such as a cached prior, before the threads
+		leafNodePairs[0].first->merge(*leafNodePairs[0].second);
+		#pragma omp parallel for schedule(dynamic)
+		for(int i = 1; i < static_cast<int>(leafNodePairs.size()); i++)
+			leafNodePairs[i].first->merge(*leafNodePairs[i].second);
+
+		// reset prior
+		BCM::resetPrior();
+
+		// log
+		logFile << "merge: " << leafNodePairs.size() << " blocks into " << this->getLeafCount() << " blocks "
+				  << "during " << timer.elapsed().wall_clock_time() << " sec" << std::endl;
+
+		return true;
+	}
+
 protected:
 
 	/** @brief Reset the points in each voxel */
@@ -1070,19 +1882,164 @@ protected:
 		}
 	}
 
-	/** @brief		Add a point from input cloud to the corresponding voxel and neighboring ones
-	  * @details	Refer to pcl::octree::OctreePointCloud<PointT, LeafT, BranchT, OctreeT>::addPointIdx (const int pointIdx_arg)
-	  *				which add the point to the corresponding voxel only.
+	/** @brief		Sort the finite input points by the Morton codes of their blocks
+	  * @details	The input cloud is replaced by the sorted copy and the subset indices are cleared.
+	  *				The range of the points of each block in the sorted copy is kept in the range table.
+	  *				The code only orders the blocks for locality. A range starts whenever the key changes,
+	  *				so blocks whose codes alias beyond 21 bits per axis are split into several ranges, not merged.
 	  */
-	void addPointIdx(const int pointIdx)
+	void sortInputCloudByBlocks()
+	{
+		// number of points
+		const size_t N = indices_ ? indices_->size() : input_->points.size();
+
+		// make sure bounding box is big enough before generating keys
+		for(size_t i = 0; i < N; i++)
+		{
+			const MyPoinT &point = input_->points[indices_ ? (*indices_)[i] : static_cast<int>(i)];
+			if(isFinite(point)) adoptBoundingBoxToPointAndNeighbors(point);
+		}
+
+		// block codes of the finite points
+		// ties are broken by the point index, so the points of a block stay in the input order
+		typedef std::pair<boost::uint64_t, int> CodeIndex;
+		std::vector<CodeIndex> codeIndexList;
+		codeIndexList.reserve(N);
+		pcl::octree::OctreeKey key;
+		for(size_t i = 0; i < N; i++)
+		{
+			const int pointIdx = indices_ ? (*indices_)[i] : static_cast<int>(i);
+			const MyPoinT &point = input_->points[pointIdx];
+			if(!isFinite(point)) continue;
+			genOctreeKeyforPoint(point, key);
+			codeIndexList.push_back(CodeIndex(genBlockCode(key), pointIdx));
+		}
+
+		// sort
+		std::sort(codeIndexList.begin(), codeIndexList.end());
+
+		// sorted copy and range table
+		m_pSortedCloud.reset(new pcl::PointCloud<MyPoinT>());
+		m_pSortedCloud->points.resize(codeIndexList.size());
+		m_blockRanges.clear();
+		for(size_t i = 0; i < codeIndexList.size(); i++)
+		{
+			const MyPoinT &point = input_->points[codeIndexList[i].second];
+			m_pSortedCloud->points[i] = point;
+
+			// new block
+			genOctreeKeyforPoint(point, key);
+			if(m_blockRanges.empty() || m_blockRanges.back().code != codeIndexList[i].first || !(m_blockRanges.back().key == key))
+			{
+				BlockRange range;
+				range.code	= codeIndexList[i].first;
+				range.first	= static_cast<int>(i);
+				range.count	= 0;
+				range.key	= key;
+				m_blockRanges.push_back(range);
+			}
+			m_blockRanges.back().count++;
+		}
+		m_pSortedCloud->width		= static_cast<uint32_t>(m_pSortedCloud->points.size());
+		m_pSortedCloud->height		= 1;
+		m_pSortedCloud->is_dense	= true;
+
+		// replace the input cloud
+		input_	= m_pSortedCloud;
+		indices_.reset();
+	}
+
+	/** @brief		Add the sorted points to the corresponding voxels and neighboring ones block by block
+	  * @details	Each leaf node is searched once per block instead of once per point,
+	  *				and the indices in each leaf node are ascending runs of the sorted cloud.
+	  *				Since the number of points of each block is known, 
+	  *				the leaf nodes are created and their index vectors are reserved in the first pass,
+	  *				and the indices are added without reallocation in the second pass.
+	  *				The leaf nodes are counted by their octree keys, which hold any tree depth.
+	  */
+	void addBlockRangesFromInputCloud()
+	{
+		// first pass: number of new indices per leaf node
+		typedef boost::unordered_map<pcl::octree::OctreeKey, size_t, OctreeKeyHash> CountMap;
+		CountMap counts(FLAG_DUPLICATE_POINTS_ ? 8*m_blockRanges.size() : m_blockRanges.size());
+		for(size_t i = 0; i < m_blockRanges.size(); i++)
+		{
+			const BlockRange &range = m_blockRanges[i];
+			if(FLAG_DUPLICATE_POINTS_)
+			{
+				for(int deltaX = -1; deltaX <= 1; deltaX++)
+					for(int deltaY = -1; deltaY <= 1; deltaY++)
+						for(int deltaZ = -1; deltaZ <= 1; deltaZ++)
+							counts[pcl::octree::OctreeKey(static_cast<unsigned int>(range.key.x+deltaX), 
+																	static_cast<unsigned int>(range.key.y+deltaY),
+																	static_cast<unsigned int>(range.key.z+deltaZ))] += static_cast<size_t>(range.count);
+			}
+			else
+				counts[range.key] += static_cast<size_t>(range.count);
+		}
+
+		// create the leaf nodes and reserve their index vectors
+		for(typename CountMap::const_iterator iter = counts.begin(); iter != counts.end(); iter++)
+		{
+			const pcl::octree::OctreeKey &key = iter->first;
+			this->addData(key, -1);
+			LeafNode *pLeafNode = findLeaf(key);
+			assert(pLeafNode);
+			pLeafNode->reserveData(iter->second);
+		}
+
+		// second pass: add the indices
+		for(size_t i = 0; i < m_blockRanges.size(); i++)
+		{
+			const BlockRange &range = m_blockRanges[i];
+			if(FLAG_DUPLICATE_POINTS_)
+			{
+				for(int deltaX = -1; deltaX <= 1; deltaX++)
+					for(int deltaY = -1; deltaY <= 1; deltaY++)
+						for(int deltaZ = -1; deltaZ <= 1; deltaZ++)
+							addIndexRange(pcl::octree::OctreeKey(static_cast<unsigned int>(range.key.x+deltaX), 
+																			 static_cast<unsigned int>(range.key.y+deltaY),
+																			 static_cast<unsigned int>(range.key.z+deltaZ)),
+											  range);
+			}
+			else
+				addIndexRange(range.key, range);
+		}
+	}
+
+	/** @brief Add a range of point indices to a voxel */
+	void addIndexRange(const pcl::octree::OctreeKey &key, const BlockRange &range)
+	{
+		// add dummy index (-1) to create the leaf node
+		this->addData(key, -1);
+
+		// add the indices
+		LeafNode *pLeafNode = findLeaf(key);
+		assert(pLeafNode);
+		for(int pointIdx = range.first; pointIdx < range.first + range.count; pointIdx++)
+			pLeafNode->setData(pointIdx);
+	}
+
+	/** @brief		Shift the bounding box so that its lower corner is on the global block grid
+	  * @details	Parent::defineBoundingBox() centers the requested range in the octree,
+	  *				which shifts the lower corner by half a block when the margin is an odd number of blocks.
+	  *				The shift back keeps the size of the octree and never uncovers the requested range,
+	  *				since it is half a block only when the margin on each side is at least half a block.
+	  */
+	void snapBoundingBoxToBlockGrid()
+	{
+		const double GRID_TOLERANCE = 1e-3;
+		const double shiftX = minX_ - floor(minX_/BLOCK_SIZE_ + GRID_TOLERANCE)*BLOCK_SIZE_;
+		const double shiftY = minY_ - floor(minY_/BLOCK_SIZE_ + GRID_TOLERANCE)*BLOCK_SIZE_;
+		const double shiftZ = minZ_ - floor(minZ_/BLOCK_SIZE_ + GRID_TOLERANCE)*BLOCK_SIZE_;
+		minX_ -= shiftX;	maxX_ -= shiftX;
+		minY_ -= shiftY;	maxY_ -= shiftY;
+		minZ_ -= shiftZ;	maxZ_ -= shiftZ;
+	}
+
+	/** @brief Make sure bounding box is big enough for a point and its neighboring voxels if necessary */
+	void adoptBoundingBoxToPointAndNeighbors(const MyPoinT &point)
 	{
-		// check the index range
-		assert(pointIdx < static_cast<int>(input_->points.size()));
-	
-		// point
-		const MyPoinT& point = input_->points[pointIdx];
-		
-		// make sure bounding box is big enough
 		if(FLAG_DUPLICATE_POINTS_)
 		{
 			MyPoinT min_pt(point), max_pt(point);
@@ -1099,6 +2056,22 @@ protected:
 		{
 			adoptBoundingBoxToPoint(point);
 		}
+	}
+
+	/** @brief		Add a point from input cloud to the corresponding voxel and neighboring ones
+	  * @details	Refer to pcl::octree::OctreePointCloud<PointT, LeafT, BranchT, OctreeT>::addPointIdx (const int pointIdx_arg)
+	  *				which add the point to the corresponding voxel only.
+	  */
+	void addPointIdx(const int pointIdx)
+	{
+		// check the index range
+		assert(pointIdx < static_cast<int>(input_->points.size()));
+	
+		// point
+		const MyPoinT& point = input_->points[pointIdx];
+		
+		// make sure bounding box is big enough
+		adoptBoundingBoxToPointAndNeighbors(point);
 		
 		// key
 		pcl::octree::OctreeKey key;
@@ -1402,10 +2375,198 @@ protected:
 
 	void initializeLeafNode();
 
+	/** @brief Copy hyperparameters */
+	static void copyHyp(const Hyp &src, Hyp &dst)
+	{
+		dst.mean	= src.mean;
+		dst.cov	= src.cov;
+		dst.lik	= src.lik;
+	}
+
+	/** @brief		Block coordinates in the global grid
+	  * @details	Unlike octree keys, they do not change when the bounding box grows.
+	  */
+	inline void genBlockCoordinates(const pcl::octree::OctreeKey &key, int &x, int &y, int &z) const
+	{
+		x = static_cast<int>(key.x) + static_cast<int>(floor(this->minX_ / this->resolution_ + 0.5));
+		y = static_cast<int>(key.y) + static_cast<int>(floor(this->minY_ / this->resolution_ + 0.5));
+		z = static_cast<int>(key.z) + static_cast<int>(floor(this->minZ_ / this->resolution_ + 0.5));
+	}
+
+	/** @brief Morton code of a block in the global grid */
+	inline boost::uint64_t genBlockCode(const pcl::octree::OctreeKey &key) const
+	{
+		int x, y, z;
+		genBlockCoordinates(key, x, y, z);
+		return mortonEncodeSigned(x, y, z);
+	}
+
+	/** @brief		Average of the cached hyperparameters of the neighboring blocks
+	  * @return		False if no neighboring block has been trained
+	  */
+	bool averageNeighborHyp(const pcl::octree::OctreeKey &key, Hyp &logHyp) const
+	{
+		// block coordinates
+		int x, y, z;
+		genBlockCoordinates(key, x, y, z);
+
+		// sum of log hyperparameters
+		size_t numNeighbors(0);
+		for(int deltaX = -1; deltaX <= 1; deltaX++)
+		{
+			for(int deltaY = -1; deltaY <= 1; deltaY++)
+			{
+				for(int deltaZ = -1; deltaZ <= 1; deltaZ++)
+				{
+					// except the current block
+					if(deltaX == 0 && deltaY == 0 && deltaZ == 0) continue;
+
+					// trained neighbor
+					typename HypCache::const_iterator iter = m_hypCache.find(mortonEncodeSigned(x + deltaX, y + deltaY, z + deltaZ));
+					if(iter == m_hypCache.end()) continue;
+					const Hyp &neighborLogHyp = iter->second->logHyp;
+
+					// sum
+					if(numNeighbors == 0)	copyHyp(neighborLogHyp, logHyp);
+					else
+					{
+						logHyp.mean	+= neighborLogHyp.mean;
+						logHyp.cov	+= neighborLogHyp.cov;
+						logHyp.lik	+= neighborLogHyp.lik;
+					}
+					numNeighbors++;
+				}
+			}
+		}
+		if(numNeighbors == 0) return false;
+
+		// average
+		const Scalar scale = static_cast<Scalar>(1) / static_cast<Scalar>(numNeighbors);
+		logHyp.mean	*= scale;
+		logHyp.cov	*= scale;
+		logHyp.lik	*= scale;
+		return true;
+	}
+
+	/** @brief		Predict a block with the per-block hyperparameter cache
+	  * @details	Without the cache, all blocks are trained from the global hyperparameters.
+	  */
+	void predictBlock(const Hyp							&logHyp,
+							const pcl::octree::OctreeKey	&key,
+							const Indices						&indexList,
+							Eigen::Vector3f					&min_pt,
+							LeafNode *							pLeafNode,
+							const int							maxIter,
+							CPU_Times							&t_training,
+							CPU_Times							&t_predict,
+							CPU_Times							&t_combine)
+	{
+		GPMAP_TRACE_ZONE_ARG("block", "points", indexList.size());
+
+		// random stream of the block
+		const boost::uint64_t code = genBlockCode(key);
+		RandomGenerator rng = m_randomStreams.stream(code, RANDOM_STREAM_PREDICTION_PARTITION);
+
+		// without the cache
+		if(!m_fHypCache || maxIter <= 0)
+		{
+			predict(logHyp, indexList, min_pt, pLeafNode, maxIter, t_training, t_predict, t_combine, rng);
+			return;
+		}
+
+		// cached hyperparameters of the block
+		typename HypCache::iterator iter = m_hypCache.find(code);
+
+		// if the number of points did not change materially, reuse them without training
+		if(iter != m_hypCache.end())
+		{
+			const size_t cachedNumPoints = iter->second->numPoints;
+			const float change = fabs(static_cast<float>(indexList.size()) - static_cast<float>(cachedNumPoints)) 
+									 / static_cast<float>(max<size_t>(1, cachedNumPoints));
+			if(change <= m_hypCachePointCountTolerance)
+			{
+				predict(iter->second->logHyp, indexList, min_pt, pLeafNode, 0, t_training, t_predict, t_combine, rng);
+				return;
+			}
+		}
+
+		// warm start from its own cached values, the trained neighbors or the global hyperparameters
+		BlockHypPtr pBlockHyp(new BlockHyp());
+		if(iter != m_hypCache.end())								copyHyp(iter->second->logHyp, pBlockHyp->logHyp);
+		else if(!averageNeighborHyp(key, pBlockHyp->logHyp))	copyHyp(logHyp, pBlockHyp->logHyp);
+
+		// train and predict
+		// partitions refine the hyperparameters in sequence
+		predict(pBlockHyp->logHyp, indexList, min_pt, pLeafNode, maxIter, t_training, t_predict, t_combine, rng, &(pBlockHyp->logHyp));
+
+		// cache
+		pBlockHyp->numPoints = indexList.size();
+		m_hypCache[code] = pBlockHyp;
+	}
+
+	/** @brief Add the statistics of a predicted block */
+	void addBlockStatistics(const pcl::octree::OctreeKey	&key,
+									const Indices						&indexList,
+									const size_t						numCholeskyRetries,
+									const CPU_Times					&t_training,
+									const CPU_Times					&t_predict,
+									const CPU_Times					&t_combine)
+	{
+		BlockStatistics b;
+		b.code					= genBlockCode(key);
+		b.keyX					= key.x;
+		b.keyY					= key.y;
+		b.keyZ					= key.z;
+		b.numPoints				= indexList.size();
+
+		size_t Nf, Nd;
+		numFinitePoints(*input_, indexList.begin(), indexList.end(), Nf, Nd);
+		b.numFuncObs			= Nf;
+		b.numDerObs				= Nd;
+
+		b.numPartitions		= max<size_t>(1, m_partitionBuffer.size());
+		b.numCholeskyRetries	= numCholeskyRetries;
+		b.train_ns				= static_cast<boost::uint64_t>(t_training.wall_clock_ns());
+		b.predict_ns			= static_cast<boost::uint64_t>(t_predict.wall_clock_ns());
+		b.combine_ns			= static_cast<boost::uint64_t>(t_combine.wall_clock_ns());
+		m_blockStatistics.push_back(b);
+	}
+
+	/** @brief		Update the memory high-water mark after predicting a block
+	  * @param[in]	leafMemoryUsage			Heap bytes of the leaf node after the prediction
+	  * @param[in]	prevLeafMemoryUsage		Heap bytes of the leaf node before the prediction
+	  * @param[in]	b								Statistics of the block
+	  */
+	void updateMemoryHighWaterMark(const size_t				leafMemoryUsage,
+											 const size_t				prevLeafMemoryUsage,
+											 const BlockStatistics	&b)
+	{
+		// growth of the leaf node
+		if(leafMemoryUsage > prevLeafMemoryUsage) m_memoryUsageInUpdate += leafMemoryUsage - prevLeafMemoryUsage;
+
+		// largest partition
+		const size_t P		= static_cast<size_t>(b.numPartitions);
+		const size_t Nf	= static_cast<size_t>(b.numFuncObs + P - 1) / P;
+		const size_t Nd	= static_cast<size_t>(b.numDerObs  + P - 1) / P;
+		const size_t N		= 2*Nf + Nd;			// surface points and empty points
+		const size_t NN	= N + 3*Nd;				// with surface normals
+		const size_t M		= NUM_CELLS_PER_BLOCK_;
+		const size_t Mcov	= FLAG_INDEPENDENT_TEST_POSITIONS_ ? M : M*M;
+
+		// GP working set
+		const size_t numScalars = 3*N + 3*Nd + NN	// X, Xd, yyd
+										+ 2*NN*NN			// K, L
+										+ NN*M				// Ks
+										+ 3*M + M + 2*Mcov;	// Xs, mean, Kss, [co]variance
+		m_memoryHighWaterMark = max<size_t>(m_memoryHighWaterMark, m_memoryUsageInUpdate + numScalars*sizeof(Scalar));
+	}
+
 	/** @details	The leaf node has only index vector, 
 	  *				no information about the point cloud or min/max boundary of the voxel.
 	  *				Thus, prediction is done in OctreeGPMap not in LeafT.
 	  *				But the result will be dangled to LeafT for further BCM update.
+	  * @param[out]	pTrainedLogHyp		If given, the trained hyperparameters are stored,
+	  *										and each partition starts from the ones trained in the previous partition.
 	  */
 	void predict(const Hyp						&logHyp,
 					 const Indices					&indexList, 
@@ -1414,7 +2575,9 @@ protected:
 					 const int						maxIter,
 					 CPU_Times						&t_training,
 					 CPU_Times						&t_predict,
-					 CPU_Times						&t_combine)
+					 CPU_Times						&t_combine,
+					 RandomGenerator				&rng,
+					 Hyp								*pTrainedLogHyp = 0)
 	{
 		// times
 		t_training.clear();
@@ -1423,121 +2586,131 @@ protected:
 
 		// if the data is too big, divide and conquer
 		// assume that subset training data are independent
-		std::vector<std::vector<int> > partitionedIndices;
-		if(!FLAG_RAMDOMLY_SAMPLE_POINTS_ && random_data_partition(indexList, MAX_NUM_POINTS_TO_PREDICT_, partitionedIndices))
+		if(!FLAG_RAMDOMLY_SAMPLE_POINTS_ && m_partitionBuffer.partition(indexList.begin(), indexList.end(), MAX_NUM_POINTS_TO_PREDICT_, rng))
 		{
-			// log file
-			//LogFile logFile;
-
-			// do it recursively
-			for(size_t i = 0; i < partitionedIndices.size(); i++)
+			// for each partition
+			for(size_t i = 0; i < m_partitionBuffer.size(); i++)
 			{
-				//logFile << "sub: " << i << "(" << partitionedIndices[i].size() << "), ";
-
 				// temp times
 				CPU_Times	t_training_sub;
 				CPU_Times	t_predict_sub;
 				CPU_Times	t_combine_sub;
 
-				// predict recursively
-				predict(logHyp, partitionedIndices[i], min_pt, pLeafNode, maxIter, 
-						  t_training_sub, t_predict_sub, t_combine_sub);
+				// predict
+				predictPartition(pTrainedLogHyp ? *pTrainedLogHyp : logHyp, m_partitionBuffer.begin(i), m_partitionBuffer.end(i), min_pt, pLeafNode, maxIter, 
+									  t_training_sub, t_predict_sub, t_combine_sub, pTrainedLogHyp);
 
 				// sum up times
 				t_training	+= t_training_sub;
 				t_predict	+= t_predict_sub;
 				t_combine	+= t_combine_sub;
 			}
-			//logFile << std::endl;
+		}
+		// randomly sample points
+		else if(FLAG_RAMDOMLY_SAMPLE_POINTS_ && m_partitionBuffer.sample(indexList.begin(), indexList.end(), MAX_NUM_POINTS_TO_PREDICT_, rng))
+		{
+			predictPartition(logHyp, m_partitionBuffer.begin(0), m_partitionBuffer.end(0), min_pt, pLeafNode, maxIter, 
+								  t_training, t_predict, t_combine, pTrainedLogHyp);
 		}
 		else
 		{
-			// if too small number of data is left by divide and conquer, ignore it
-			if(indexList.size() < MIN_NUM_POINTS_TO_PREDICT_) return;
+			predictPartition(logHyp, indexList.begin(), indexList.end(), min_pt, pLeafNode, maxIter, 
+								  t_training, t_predict, t_combine, pTrainedLogHyp);
+		}
+	}
 
-			// training data
-			MatrixPtr pX, pXd; VectorPtr pYYd;
-			std::vector<int> randomSampleIndices;	// randomly sample points
-			if(FLAG_RAMDOMLY_SAMPLE_POINTS_ && random_sampling(indexList, MAX_NUM_POINTS_TO_PREDICT_, randomSampleIndices))
-			{
-				generateTrainingData(input_, randomSampleIndices, m_gap, pX, pXd, pYYd);	
-			}
-			else
-			{
-				generateTrainingData(input_, indexList, m_gap, pX, pXd, pYYd);	
-			}
-			GP::DerivativeTrainingData<float> derivativeTrainingData;
-			derivativeTrainingData.set(pX, pXd, pYYd);
+	/** @brief		Predict with an index range without partitioning */
+	void predictPartition(const Hyp						&logHyp,
+								 Indices::const_iterator		first,
+								 Indices::const_iterator		last,
+								 Eigen::Vector3f				&min_pt,
+								 LeafNode *						pLeafNode,
+								 const int						maxIter,
+								 CPU_Times						&t_training,
+								 CPU_Times						&t_predict,
+								 CPU_Times						&t_combine,
+								 Hyp								*pTrainedLogHyp = 0)
+	{
+		// if too small number of data is left by divide and conquer, ignore it
+		if(static_cast<size_t>(std::distance(first, last)) < MIN_NUM_POINTS_TO_PREDICT_) return;
 
-			// test data
-			GP::TestData<float> testData;
-			MatrixPtr pXs(new Matrix(NUM_CELLS_PER_BLOCK_, 3));
-			Matrix minValue(1, 3); 
-			minValue << min_pt.x(), min_pt.y(), min_pt.z();
-			pXs->noalias() = (*m_pXs) + minValue.replicate(NUM_CELLS_PER_BLOCK_, 1);
-			testData.set(pXs);
+		// training data
+		GP::DerivativeTrainingData<float> derivativeTrainingData;
+		{
+			GPMAP_TRACE_ZONE_ARG("generateTrainingData", "points", std::distance(first, last));
+			generateTrainingData(input_, first, last, m_gap, m_workspace.pX, m_workspace.pXd, m_workspace.pYYd);
+			derivativeTrainingData.set(m_workspace.pX, m_workspace.pXd, m_workspace.pYYd);
+		}
 
-			// train
-			//Hyp localLogHyp(logHyp);
-			Hyp localLogHyp;
-			localLogHyp.mean = logHyp.mean;
-			localLogHyp.cov = logHyp.cov;
-			localLogHyp.lik = logHyp.lik;
+		// test data
+		GP::TestData<float> testData;
+		if(!m_workspace.pXs || !m_workspace.pXs.unique())	m_workspace.pXs.reset(new Matrix(NUM_CELLS_PER_BLOCK_, 3));
+		const Eigen::RowVector3f minValue(min_pt.x(), min_pt.y(), min_pt.z());
+		m_workspace.pXs->noalias() = (*m_pXs) + minValue.replicate(NUM_CELLS_PER_BLOCK_, 1);
+		testData.set(m_workspace.pXs);
+
+		// train
+		//Hyp localLogHyp(logHyp);
+		Hyp localLogHyp;
+		copyHyp(logHyp, localLogHyp);
+
+		// train
+		if(maxIter > 0)
+		{
+			// timer - start
+			GPMAP_TRACE_ZONE("train");
+			CPU_Timer timer;
 
 			// train
-			if(maxIter > 0)
+			GPType::train<GP::BOBYQA, GP::NoStopping>(localLogHyp, derivativeTrainingData, maxIter);
+	
+			// timer - end
+			t_training = timer.elapsed();
+
+			// log
+			GPMAP_LOG_DEBUG("trained hyperparameters" 
+								 << localLogHyp.cov.array().exp().matrix() 
+								 << localLogHyp.lik.array().exp().matrix());
+
+			// keep the trained hyperparameters
+			if(pTrainedLogHyp) copyHyp(localLogHyp, *pTrainedLogHyp);
+		}
+
+		// predict and update
+		try
+		{
+			// predict
 			{
 				// timer - start
+				GPMAP_TRACE_ZONE("predict");
 				CPU_Timer timer;
 
-				// train
-				GPType::train<GP::BOBYQA, GP::NoStopping>(localLogHyp, derivativeTrainingData, maxIter);
-		
-				// timer - end
-				t_training = timer.elapsed();
+				// predict
+				GPType::predict(localLogHyp, derivativeTrainingData, testData, FLAG_INDEPENDENT_TEST_POSITIONS_);			// perBatch = 1000
+				//GPType::predict(localLogHyp, derivativeTrainingData, testData, FLAG_INDEPENDENT_TEST_POSITIONS_, 0);	// perBatch = all
 
-				// log file
-				LogFile logFile;
-				logFile << "trained hyperparameters" 
-						  << localLogHyp.cov.array().exp().matrix() 
-						  << localLogHyp.lik.array().exp().matrix() << std::endl;
+				// timer - end
+				t_predict = timer.elapsed();
 			}
-
-			// predict and update
-			try
+		
+			// update
 			{
-				// predict
-				{
-					// timer - start
-					CPU_Timer timer;
-
-					// predict
-					GPType::predict(localLogHyp, derivativeTrainingData, testData, FLAG_INDEPENDENT_TEST_POSITIONS_);			// perBatch = 1000
-					//GPType::predict(localLogHyp, derivativeTrainingData, testData, FLAG_INDEPENDENT_TEST_POSITIONS_, 0);	// perBatch = all
+				// timer - start
+				GPMAP_TRACE_ZONE("combine");
+				CPU_Timer timer;
 
-					// timer - end
-					t_predict = timer.elapsed();
-				}
-			
 				// update
-				{
-					// timer - start
-					CPU_Timer timer;
+				pLeafNode->update(testData.pMu(), testData.pSigma());
 
-					// update
-					pLeafNode->update(testData.pMu(), testData.pSigma());
-
-					// timer - end
-					t_combine = timer.elapsed();
-				}
-			}
-			catch(GP::Exception &e)
-			{
-				// log file
-				LogFile logFile;
-				logFile << e.what() << std::endl;
+				// timer - end
+				t_combine = timer.elapsed();
 			}
 		}
+		catch(GP::Exception &e)
+		{
+			// log
+			GPMAP_LOG_RATE_LIMITED(LOG_WARNING, 10, e.what());
+		}
 	}
 
 protected:
@@ -1551,7 +2724,7 @@ protected:
 	const bool		FLAG_INDEPENDENT_TEST_POSITIONS_;
 
 	/** @brief		Random sampling rate in a leaf nodes */
-	const bool		FLAG_RAMDOMLY_SAMPLE_POINTS_;
+	bool				FLAG_RAMDOMLY_SAMPLE_POINTS_;
 
 	/** @brief Size of each block (voxel) */
 	double			&BLOCK_SIZE_;
@@ -1565,8 +2738,8 @@ protected:
 
 
 	/** @brief		Minimum number of points to predict signed distances with GPR */
-	const size_t	MIN_NUM_POINTS_TO_PREDICT_;
-	const int		MAX_NUM_POINTS_TO_PREDICT_;
+	size_t			MIN_NUM_POINTS_TO_PREDICT_;
+	int				MAX_NUM_POINTS_TO_PREDICT_;
 
 	/** @brief For generating empty points */
 	float				m_gap;
@@ -1580,6 +2753,53 @@ protected:
 
 	/** @brief		Test inputs of a block whose minimum point is (0, 0, 0) */
 	MatrixPtr	m_pXs;
+
+	/** @brief		Trained hyperparameters of a block and the number of points used for training */
+	struct BlockHyp
+	{
+		Hyp		logHyp;
+		size_t	numPoints;
+	};
+	typedef boost::shared_ptr<BlockHyp>								BlockHypPtr;
+	typedef boost::unordered_map<boost::uint64_t, BlockHypPtr>	HypCache;
+
+	/** @brief		Reusable index buffer for partitioning and sampling points in a block */
+	PartitionBuffer	m_partitionBuffer;
+
+	/** @brief		Reusable training and test inputs of a partition
+	  * @details	They are reallocated only when they are still shared or their sizes change.
+	  */
+	struct Workspace
+	{
+		MatrixPtr	pX;
+		MatrixPtr	pXd;
+		VectorPtr	pYYd;
+		MatrixPtr	pXs;
+	};
+	Workspace			m_workspace;
+
+	/** @brief		Random streams derived from the map seed per block and per call site */
+	RandomStreams		m_randomStreams;
+	boost::uint64_t	m_numBlockSamplings;
+
+	/** @brief		Per-block hyperparameter cache keyed by the Morton code of the block in the global grid */
+	bool			m_fHypCache;
+	float			m_hypCachePointCountTolerance;
+	HypCache		m_hypCache;
+
+	/** @brief		Spatial sorting of the input cloud
+	  * @details	The sorted copy is owned by the map and the range table is in the Morton order of blocks.
+	  */
+	bool										m_fSpatialSorting;
+	pcl::PointCloud<MyPoinT>::Ptr		m_pSortedCloud;
+	BlockRangeList							m_blockRanges;
+
+	/** @brief		Per-block statistics of the last update */
+	BlockStatisticsList					m_blockStatistics;
+
+	/** @brief		Memory usage and its high-water mark during the last update */
+	size_t										m_memoryUsageInUpdate;
+	size_t										m_memoryHighWaterMark;
 };
 
 }
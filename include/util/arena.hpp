@@ -0,0 +1,197 @@
+#ifndef _GPMAP_ARENA_HPP_
+#define _GPMAP_ARENA_HPP_
+
+// STL
+#include <vector>
+#include <algorithm>		// std::max
+
+// Boost
+#include <boost/shared_array.hpp>				// boost::shared_array
+#include <boost/thread/tss.hpp>					// boost::thread_specific_ptr
+
+namespace GPMap {
+
+/** @brief		Bump allocator for short-lived temporaries
+  * @details	Memory is handed out from large chunks by moving an offset,
+  *				and it is released all at once by rewinding to a marker or resetting.
+  *				The chunks are kept for the next use, so a warm arena does not touch the heap.
+  *				An arena is not thread-safe; each worker thread should use its own one such as threadLocal().
+  */
+class Arena
+{
+public:
+	/** @brief Position in the arena to rewind to */
+	struct Marker
+	{
+		size_t chunk;
+		size_t offset;
+	};
+
+	/** @brief Default alignment which is enough for Eigen vectorization */
+	static const size_t DEFAULT_ALIGNMENT = 16;
+
+public:
+	/** @brief Constructor */
+	explicit Arena(const size_t chunkSize = 1 << 20)
+		: m_chunkSize(std::max<size_t>(chunkSize, DEFAULT_ALIGNMENT)),
+		  m_chunk(0),
+		  m_offset(0),
+		  m_highWaterMark(0)
+	{
+	}
+
+	/** @brief		Allocate uninitialized memory
+	  * @details	If the current chunk is too small, the next chunk is used or a new one is added.
+	  */
+	void* allocate(const size_t bytes, const size_t alignment = DEFAULT_ALIGNMENT)
+	{
+		while(true)
+		{
+			// current chunk
+			if(m_chunk < m_chunks.size())
+			{
+				const Chunk &chunk = m_chunks[m_chunk];
+				const size_t base		= reinterpret_cast<size_t>(chunk.pData.get());
+				const size_t offset	= ((base + m_offset + alignment - 1) & ~(alignment - 1)) - base;
+				if(offset + bytes <= chunk.size)
+				{
+					m_offset = offset + bytes;
+					m_highWaterMark = std::max<size_t>(m_highWaterMark, used());
+					return chunk.pData.get() + offset;
+				}
+
+				// next chunk
+				m_chunk++;
+				m_offset = 0;
+				continue;
+			}
+
+			// new chunk
+			Chunk chunk;
+			chunk.size = std::max<size_t>(m_chunkSize, bytes + alignment);
+			chunk.pData.reset(new char[chunk.size]);
+			m_chunks.push_back(chunk);
+		}
+	}
+
+	/** @brief Allocate uninitialized memory for n objects of a plain type */
+	template <typename T>
+	T* allocate(const size_t n)
+	{
+		return static_cast<T*>(allocate(n * sizeof(T), DEFAULT_ALIGNMENT));
+	}
+
+	/** @brief Current position */
+	Marker mark() const
+	{
+		Marker marker;
+		marker.chunk	= m_chunk;
+		marker.offset	= m_offset;
+		return marker;
+	}
+
+	/** @brief Release all memory allocated after the marker */
+	void rewind(const Marker &marker)
+	{
+		m_chunk	= marker.chunk;
+		m_offset	= marker.offset;
+	}
+
+	/** @brief Release all memory, but keep the chunks */
+	void reset()
+	{
+		m_chunk	= 0;
+		m_offset	= 0;
+	}
+
+	/** @brief Bytes in use including the alignment padding and the unused tails of the previous chunks */
+	size_t used() const
+	{
+		size_t bytes(m_offset);
+		for(size_t i = 0; i < m_chunk && i < m_chunks.size(); i++) bytes += m_chunks[i].size;
+		return bytes;
+	}
+
+	/** @brief Bytes of all chunks */
+	size_t capacity() const
+	{
+		size_t bytes(0);
+		for(size_t i = 0; i < m_chunks.size(); i++) bytes += m_chunks[i].size;
+		return bytes;
+	}
+
+	/** @brief Maximum bytes in use since the construction */
+	size_t highWaterMark() const
+	{
+		return m_highWaterMark;
+	}
+
+	/** @brief Arena of the calling thread */
+	static Arena& threadLocal()
+	{
+		if(!m_pThreadArena.get()) m_pThreadArena.reset(new Arena());
+		return *m_pThreadArena;
+	}
+
+protected:
+	/** @brief Chunk of memory */
+	struct Chunk
+	{
+		boost::shared_array<char>	pData;
+		size_t							size;
+	};
+
+	/** @brief Size of a new chunk */
+	const size_t				m_chunkSize;
+
+	/** @brief Chunks */
+	std::vector<Chunk>		m_chunks;
+
+	/** @brief Current chunk and the offset in it */
+	size_t						m_chunk;
+	size_t						m_offset;
+
+	/** @brief Maximum bytes in use */
+	size_t						m_highWaterMark;
+
+	/** @brief Arena per thread */
+	static boost::thread_specific_ptr<Arena>	m_pThreadArena;
+};
+
+const size_t								Arena::DEFAULT_ALIGNMENT;
+boost::thread_specific_ptr<Arena>	Arena::m_pThreadArena;
+
+/** @brief		Scope of temporaries in an arena
+  * @details	All memory allocated in the scope is released when it ends.
+  */
+class ArenaScope
+{
+public:
+	/** @brief Constructor */
+	explicit ArenaScope(Arena &arena)
+		: m_arena(arena),
+		  m_marker(arena.mark())
+	{
+	}
+
+	/** @brief Destructor */
+	~ArenaScope()
+	{
+		m_arena.rewind(m_marker);
+	}
+
+protected:
+	/** @brief Arena */
+	Arena					&m_arena;
+
+	/** @brief Position at the beginning of the scope */
+	Arena::Marker		m_marker;
+
+private:
+	ArenaScope(const ArenaScope&);
+	ArenaScope& operator=(const ArenaScope&);
+};
+
+}
+
+#endif
@@ -0,0 +1,345 @@
+#ifndef _GPMAP_ASYNC_LOGGER_HPP_
+#define _GPMAP_ASYNC_LOGGER_HPP_
+
+// STL
+#include <string>
+#include <vector>
+#include <sstream>		// std::ostringstream
+#include <fstream>
+#include <iomanip>		// std::setprecision
+
+// Boost
+#include <boost/cstdint.hpp>								// boost::uint64_t
+#include <boost/chrono.hpp>								// boost::chrono::steady_clock
+#include <boost/shared_ptr.hpp>							// boost::shared_ptr
+#include <boost/thread/thread.hpp>						// boost::thread
+#include <boost/thread/mutex.hpp>						// boost::mutex
+#include <boost/thread/condition_variable.hpp>		// boost::condition_variable
+#include <boost/thread/once.hpp>							// boost::once_flag, boost::call_once
+#include <boost/bind.hpp>									// boost::bind
+#include <boost/ref.hpp>									// boost::ref
+
+// GP
+#include "GP.h"						// LogFile
+using GP::LogFile;
+
+namespace GPMap {
+
+/** @brief Log levels */
+enum LogLevel
+{
+	LOG_DEBUG		= 0,
+	LOG_INFO			= 1,
+	LOG_WARNING		= 2,
+	LOG_ERROR		= 3
+};
+
+/** @brief Record of a log message */
+struct LogRecord
+{
+	LogLevel				level;
+	boost::uint64_t	time_us;		// since the logger is opened
+	std::string			message;
+};
+
+/** @brief		Asynchronous logger
+  * @details	Producers append records to a front buffer under a mutex held only for the append,
+  *				and a writer thread swaps it with a back buffer and writes the back buffer with one flush.
+  *				So hot paths neither format to a file stream nor flush,
+  *				and records from several threads are never interleaved.
+  *				The number of pending records is bounded, and records beyond the bound are dropped and counted.
+  *				Until open() is called, records are written to GP::LogFile synchronously under the same mutex,
+  *				so the existing log files keep receiving them.
+  */
+class AsyncLogger
+{
+public:
+	/** @brief		Open a log file and start the writer thread
+	  * @return		False if the file cannot be opened
+	  */
+	static bool open(const std::string &strFilePath, const size_t maxNumPendingRecords = 1 << 16)
+	{
+		close();
+
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_fout.open(strFilePath.c_str());
+		if(!m_fout) return false;
+		m_maxNumPendingRecords	= maxNumPendingRecords;
+		m_numDropped				= 0;
+		m_start						= Clock::now();
+		m_fRunning					= true;
+		m_pWriter.reset(new boost::thread(&AsyncLogger::run));
+		return true;
+	}
+
+	/** @brief Write the pending records, stop the writer thread and close the log file */
+	static void close()
+	{
+		{
+			boost::mutex::scoped_lock lock(m_mutex);
+			if(!m_fRunning) return;
+			m_fRunning = false;
+			m_notEmpty.notify_one();
+		}
+		m_pWriter->join();
+		m_pWriter.reset();
+		m_fout.close();
+	}
+
+	/** @brief Wait until the pending records are written */
+	static void flush()
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		while(m_fRunning && (!m_front.empty() || m_fWriting)) m_written.wait(lock);
+	}
+
+	/** @brief Set the minimum level at run time */
+	static void setLevel(const LogLevel level)	{ m_minLevel = level; }
+
+	/** @brief Check if a level is logged */
+	static inline bool isEnabled(const LogLevel level)	{ return level >= m_minLevel; }
+
+	/** @brief Number of dropped records since open() */
+	static size_t numDropped()
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		return m_numDropped;
+	}
+
+	/** @brief Log a message */
+	static void log(const LogLevel level, const std::string &strMessage)
+	{
+		if(!isEnabled(level)) return;
+
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		// synchronous
+		if(!m_fRunning)
+		{
+			LogFile logFile;
+			logFile << strMessage << std::endl;
+			return;
+		}
+
+		// bounded
+		if(m_front.size() >= m_maxNumPendingRecords)
+		{
+			m_numDropped++;
+			return;
+		}
+
+		// append
+		m_front.push_back(LogRecord());
+		LogRecord &record = m_front.back();
+		record.level	= level;
+		record.time_us	= static_cast<boost::uint64_t>(boost::chrono::duration_cast<boost::chrono::microseconds>(Clock::now() - m_start).count());
+		record.message	= strMessage;
+		if(m_front.size() == 1) m_notEmpty.notify_one();
+	}
+
+protected:
+	typedef boost::chrono::steady_clock Clock;
+
+	/** @brief Writer thread */
+	static void run()
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		while(true)
+		{
+			while(m_front.empty() && m_fRunning) m_notEmpty.wait(lock);
+			if(m_front.empty()) break;
+
+			// swap the buffers
+			m_front.swap(m_back);
+			m_fWriting = true;
+
+			// write without the lock
+			lock.unlock();
+			for(size_t i = 0; i < m_back.size(); i++)
+			{
+				const LogRecord &record = m_back[i];
+				m_fout << "[" << std::fixed << std::setprecision(6) << static_cast<double>(record.time_us) * 1e-6 << "]"
+						 << "[" << levelName(record.level) << "] " << record.message << '\n';
+			}
+			m_fout.flush();
+			m_back.clear();
+			lock.lock();
+
+			m_fWriting = false;
+			m_written.notify_all();
+		}
+
+		// dropped
+		if(m_numDropped > 0) m_fout << "[" << levelName(LOG_WARNING) << "] dropped records: " << m_numDropped << std::endl;
+		m_written.notify_all();
+	}
+
+	/** @brief Name of a level */
+	static const char* levelName(const LogLevel level)
+	{
+		switch(level)
+		{
+			case LOG_DEBUG:	return "DEBUG";
+			case LOG_INFO:		return "INFO";
+			case LOG_WARNING:	return "WARNING";
+			case LOG_ERROR:	return "ERROR";
+		}
+		return "";
+	}
+
+protected:
+	/** @brief Minimum level at run time */
+	static LogLevel									m_minLevel;
+
+	/** @brief Front buffer for the producers and back buffer for the writer */
+	static std::vector<LogRecord>					m_front;
+	static std::vector<LogRecord>					m_back;
+	static size_t										m_maxNumPendingRecords;
+	static size_t										m_numDropped;
+
+	/** @brief Writer */
+	static boost::shared_ptr<boost::thread>	m_pWriter;
+	static std::ofstream								m_fout;
+	static bool											m_fRunning;
+	static bool											m_fWriting;
+	static Clock::time_point						m_start;
+
+	/** @brief Synchronization */
+	static boost::mutex								m_mutex;
+	static boost::condition_variable				m_notEmpty;
+	static boost::condition_variable				m_written;
+};
+
+LogLevel										AsyncLogger::m_minLevel					= LOG_INFO;
+std::vector<LogRecord>					AsyncLogger::m_front;
+std::vector<LogRecord>					AsyncLogger::m_back;
+size_t										AsyncLogger::m_maxNumPendingRecords	= 1 << 16;
+size_t										AsyncLogger::m_numDropped				= 0;
+boost::shared_ptr<boost::thread>		AsyncLogger::m_pWriter;
+std::ofstream								AsyncLogger::m_fout;
+bool											AsyncLogger::m_fRunning					= false;
+bool											AsyncLogger::m_fWriting					= false;
+AsyncLogger::Clock::time_point		AsyncLogger::m_start;
+boost::mutex								AsyncLogger::m_mutex;
+boost::condition_variable				AsyncLogger::m_notEmpty;
+boost::condition_variable				AsyncLogger::m_written;
+
+/** @brief		Rate limiter of a call site
+  * @details	At most maxPerSecond records pass in each one-second window,
+  *				and the first record of the next window reports how many were suppressed.
+  */
+class LogRateLimiter
+{
+public:
+	/** @brief Constructor */
+	explicit LogRateLimiter(const size_t maxPerSecond)
+		: m_maxPerSecond(maxPerSecond),
+		  m_window(0),
+		  m_numInWindow(0),
+		  m_numSuppressed(0)
+	{
+	}
+
+	/** @brief		Rate limiter of a call site, created once
+	  * @details	VS2010 does not initialize function-local statics thread-safely,
+	  *				so a call site keeps a statically initialized once-flag and pointer
+	  *				and the limiter is created by boost::call_once.
+	  *				It lives until the program exits.
+	  */
+	static LogRateLimiter& callSite(boost::once_flag &flag, LogRateLimiter *&pLimiter, const size_t maxPerSecond)
+	{
+		boost::call_once(flag, boost::bind(&LogRateLimiter::create, boost::ref(pLimiter), maxPerSecond));
+		return *pLimiter;
+	}
+
+	/** @brief		Check if a record can pass
+	  * @param[out]	numSuppressed		Number of records suppressed since the last passed one
+	  */
+	bool allow(size_t &numSuppressed)
+	{
+		const boost::uint64_t window = static_cast<boost::uint64_t>(boost::chrono::duration_cast<boost::chrono::seconds>(boost::chrono::steady_clock::now().time_since_epoch()).count());
+
+		boost::mutex::scoped_lock lock(m_mutex);
+		if(window != m_window)
+		{
+			m_window			= window;
+			m_numInWindow	= 0;
+		}
+		if(m_numInWindow >= m_maxPerSecond)
+		{
+			m_numSuppressed++;
+			return false;
+		}
+		m_numInWindow++;
+		numSuppressed		= m_numSuppressed;
+		m_numSuppressed	= 0;
+		return true;
+	}
+
+protected:
+	/** @brief Create a limiter */
+	static void create(LogRateLimiter *&pLimiter, const size_t maxPerSecond)
+	{
+		pLimiter = new LogRateLimiter(maxPerSecond);
+	}
+
+protected:
+	const size_t		m_maxPerSecond;
+	boost::uint64_t	m_window;
+	size_t				m_numInWindow;
+	size_t				m_numSuppressed;
+	boost::mutex		m_mutex;
+};
+
+}
+
+/** @brief		Minimum level of the call sites which are compiled
+  * @details	Debug call sites are removed in release builds unless it is defined otherwise.
+  */
+#ifndef GPMAP_LOG_MIN_LEVEL
+	#ifdef NDEBUG
+		#define GPMAP_LOG_MIN_LEVEL 1
+	#else
+		#define GPMAP_LOG_MIN_LEVEL 0
+	#endif
+#endif
+
+/** @brief		Log a streamed message, for example GPMAP_LOG(LOG_INFO, "nlZ: " << nlZ) */
+#define GPMAP_LOG(level, message) \
+	do { \
+		if(GPMap::AsyncLogger::isEnabled(GPMap::level)) \
+		{ \
+			std::ostringstream gpmapLogStream_; \
+			gpmapLogStream_ << message; \
+			GPMap::AsyncLogger::log(GPMap::level, gpmapLogStream_.str()); \
+		} \
+	} while(0)
+
+/** @brief		Log a streamed message at most maxPerSecond times per second at the call site */
+#define GPMAP_LOG_RATE_LIMITED(level, maxPerSecond, message) \
+	do { \
+		if(GPMap::AsyncLogger::isEnabled(GPMap::level)) \
+		{ \
+			static boost::once_flag gpmapLogRateLimiterFlag_ = BOOST_ONCE_INIT; \
+			static GPMap::LogRateLimiter *gpmapLogRateLimiter_ = 0; \
+			size_t gpmapLogNumSuppressed_; \
+			if(GPMap::LogRateLimiter::callSite(gpmapLogRateLimiterFlag_, gpmapLogRateLimiter_, maxPerSecond).allow(gpmapLogNumSuppressed_)) \
+			{ \
+				std::ostringstream gpmapLogStream_; \
+				gpmapLogStream_ << message; \
+				if(gpmapLogNumSuppressed_ > 0) gpmapLogStream_ << " (" << gpmapLogNumSuppressed_ << " suppressed)"; \
+				GPMap::AsyncLogger::log(GPMap::level, gpmapLogStream_.str()); \
+			} \
+		} \
+	} while(0)
+
+#if GPMAP_LOG_MIN_LEVEL <= 0
+	#define GPMAP_LOG_DEBUG(message)		GPMAP_LOG(LOG_DEBUG, message)
+#else
+	#define GPMAP_LOG_DEBUG(message)		do {} while(0)
+#endif
+#define GPMAP_LOG_INFO(message)			GPMAP_LOG(LOG_INFO, message)
+#define GPMAP_LOG_WARNING(message)		GPMAP_LOG(LOG_WARNING, message)
+#define GPMAP_LOG_ERROR(message)			GPMAP_LOG(LOG_ERROR, message)
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef _GPMAP_BOUNDED_QUEUE_HPP_
+#define _GPMAP_BOUNDED_QUEUE_HPP_
+
+// STL
+#include <deque>
+#include <algorithm>		// std::max
+
+// Boost
+#include <boost/thread/mutex.hpp>					// boost::mutex
+#include <boost/thread/condition_variable.hpp>	// boost::condition_variable
+
+namespace GPMap {
+
+/** @brief		Blocking FIFO queue with a fixed capacity
+  * @details	push() blocks while the queue is full and pop() blocks while it is empty,
+  *				so the number of items between two pipeline stages is bounded.
+  *				After close(), push() fails and pop() fails once the queue is drained.
+  */
+template <typename T>
+class BoundedQueue
+{
+public:
+	/** @brief Constructor */
+	explicit BoundedQueue(const size_t capacity)
+		: m_capacity(std::max<size_t>(capacity, 1)),
+		  m_fClosed(false)
+	{
+	}
+
+	/** @brief		Push an item
+	  * @return		False if the queue is closed
+	  */
+	bool push(const T &item)
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		while(m_queue.size() >= m_capacity && !m_fClosed) m_notFull.wait(lock);
+		if(m_fClosed) return false;
+		m_queue.push_back(item);
+		m_notEmpty.notify_one();
+		return true;
+	}
+
+	/** @brief		Pop an item
+	  * @return		False if the queue is closed and empty
+	  */
+	bool pop(T &item)
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		while(m_queue.empty() && !m_fClosed) m_notEmpty.wait(lock);
+		if(m_queue.empty()) return false;
+		item = m_queue.front();
+		m_queue.pop_front();
+		m_notFull.notify_one();
+		return true;
+	}
+
+	/** @brief Close the queue */
+	void close()
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_fClosed = true;
+		m_notEmpty.notify_all();
+		m_notFull.notify_all();
+	}
+
+	/** @brief Capacity */
+	size_t capacity() const
+	{
+		return m_capacity;
+	}
+
+protected:
+	/** @brief Maximum number of items */
+	const size_t						m_capacity;
+
+	/** @brief Items */
+	std::deque<T>						m_queue;
+
+	/** @brief Flag for closing */
+	bool									m_fClosed;
+
+	/** @brief Synchronization */
+	boost::mutex						m_mutex;
+	boost::condition_variable		m_notEmpty;
+	boost::condition_variable		m_notFull;
+};
+
+}
+
+#endif
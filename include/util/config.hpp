@@ -0,0 +1,208 @@
+#ifndef _GPMAP_CONFIG_HPP_
+#define _GPMAP_CONFIG_HPP_
+
+// STL
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>		// std::istringstream, std::ostringstream
+#include <iostream>		// std::cin, std::cout
+
+// GP
+#include "GP.h"			// LogFile
+using GP::LogFile;
+
+namespace GPMap {
+
+/** @brief Trim white spaces at both ends */
+inline std::string trim(const std::string &str)
+{
+	const std::string WHITE_SPACES(" \t\r\n");
+	const size_t first = str.find_first_not_of(WHITE_SPACES);
+	if(first == std::string::npos) return std::string();
+	const size_t last = str.find_last_not_of(WHITE_SPACES);
+	return str.substr(first, last - first + 1);
+}
+
+/** @brief Parse a value from a string */
+template <typename T>
+inline bool parseValue(const std::string &str, T &value)
+{
+	std::istringstream iss(str);
+	T temp;
+	if(!(iss >> temp)) return false;
+	value = temp;
+	return true;
+}
+
+/** @brief Parse a boolean value from 0/1 or false/true */
+inline bool parseValue(const std::string &str, bool &value)
+{
+	if(str == "true")		{ value = true;	return true; }
+	if(str == "false")	{ value = false;	return true; }
+	int temp;
+	if(!parseValue(str, temp)) return false;
+	value = (temp != 0);
+	return true;
+}
+
+/** @brief Parse a string value as it is */
+inline bool parseValue(const std::string &str, std::string &value)
+{
+	value = str;
+	return true;
+}
+
+/** @brief		Key-value settings from a config file and command line arguments
+  * @details	A config file has a "key = value" pair per line and comments start with '#'.
+  *				A command line argument is "key=value" or "--key=value",
+  *				and "config=<file path>" loads a config file at that point,
+  *				so the later arguments override the file.
+  *				A list is a comma-separated value such as "block_size = 0.01, 0.02".
+  *				With "interactive = 0", the missing settings take their default values instead of asking.
+  */
+class Config
+{
+public:
+	/** @brief		Load a config file
+	  * @return		False if the file cannot be opened
+	  */
+	bool load(const std::string &strFilePath)
+	{
+		std::ifstream fin(strFilePath.c_str());
+		if(!fin) return false;
+
+		std::string strLine;
+		while(std::getline(fin, strLine))
+		{
+			// comment
+			const size_t comment = strLine.find('#');
+			if(comment != std::string::npos) strLine.erase(comment);
+
+			// key = value
+			const size_t equal = strLine.find('=');
+			if(equal == std::string::npos) continue;
+			set(trim(strLine.substr(0, equal)), trim(strLine.substr(equal + 1)));
+		}
+		return true;
+	}
+
+	/** @brief Parse command line arguments */
+	void parse(const int argc, char **argv)
+	{
+		for(int i = 1; i < argc; i++)
+		{
+			// --key=value
+			std::string strArg(argv[i]);
+			if(strArg.compare(0, 2, "--") == 0) strArg.erase(0, 2);
+
+			// key=value
+			const size_t equal = strArg.find('=');
+			if(equal == std::string::npos) continue;
+			const std::string strKey		= trim(strArg.substr(0, equal));
+			const std::string strValue		= trim(strArg.substr(equal + 1));
+
+			// config file
+			if(strKey == "config")
+			{
+				if(!load(strValue))
+				{
+					LogFile logFile;
+					logFile << "Config: cannot open " << strValue << std::endl;
+				}
+				continue;
+			}
+			set(strKey, strValue);
+		}
+	}
+
+	/** @brief Set a value */
+	void set(const std::string &strKey, const std::string &strValue)
+	{
+		if(!strKey.empty()) m_values[strKey] = strValue;
+	}
+
+	/** @brief Check if a key exists */
+	bool has(const std::string &strKey) const
+	{
+		return m_values.find(strKey) != m_values.end();
+	}
+
+	/** @brief		Get a value
+	  * @return		False if the key does not exist or the value cannot be parsed
+	  */
+	template <typename T>
+	bool get(const std::string &strKey, T &value) const
+	{
+		std::map<std::string, std::string>::const_iterator iter = m_values.find(strKey);
+		if(iter == m_values.end()) return false;
+		return parseValue(iter->second, value);
+	}
+
+	/** @brief		Get a comma-separated list
+	  * @return		False if the key does not exist or any item cannot be parsed
+	  */
+	template <typename T>
+	bool getList(const std::string &strKey, std::vector<T> &values) const
+	{
+		std::map<std::string, std::string>::const_iterator iter = m_values.find(strKey);
+		if(iter == m_values.end()) return false;
+
+		std::vector<T> temp;
+		std::istringstream iss(iter->second);
+		std::string strItem;
+		while(std::getline(iss, strItem, ','))
+		{
+			T value;
+			if(!parseValue(trim(strItem), value)) return false;
+			temp.push_back(value);
+		}
+		values.swap(temp);
+		return true;
+	}
+
+	/** @brief Whether the missing settings are asked on the console */
+	bool isInteractive() const
+	{
+		bool fInteractive(true);
+		get("interactive", fInteractive);
+		return fInteractive;
+	}
+
+	/** @brief Global settings of the process */
+	static Config& global()
+	{
+		static Config config;
+		return config;
+	}
+
+protected:
+	/** @brief Values by keys */
+	std::map<std::string, std::string>	m_values;
+};
+
+/** @brief		Get a setting from the global config, or ask it on the console if it is missing
+  * @details	In the non-interactive mode, a missing setting takes the default value.
+  *				The value is logged with its key either way.
+  */
+template <typename T>
+T ask(const std::string &strKey, const std::string &strPrompt, const T &defaultValue)
+{
+	const Config &config = Config::global();
+
+	T value(defaultValue);
+	if(!config.get(strKey, value) && config.isInteractive())
+	{
+		std::cout << strPrompt;
+		std::cin >> value;
+	}
+
+	LogFile logFile;
+	logFile << strKey << " = " << value << std::endl;
+	return value;
+}
+
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef _GPMAP_MEMORY_USAGE_HPP_
+#define _GPMAP_MEMORY_USAGE_HPP_
+
+// STL
+#include <map>
+#include <vector>
+
+// Boost
+#include <boost/shared_ptr.hpp>			// boost::shared_ptr
+#include <boost/unordered_map.hpp>		// boost::unordered_map
+
+// Eigen
+#include <Eigen/Dense>
+
+namespace GPMap {
+
+/** @brief		Heap bytes of containers
+  * @details	They count the elements held by a container, not the container object itself,
+  *				so that the object can be counted by sizeof() of its owner.
+  *				Node-based containers are estimated with their node pointers,
+  *				since the allocator overhead depends on the platform.
+  */
+
+/** @brief Heap bytes of an Eigen dense object */
+template <typename Derived>
+inline size_t heapMemoryUsage(const Eigen::PlainObjectBase<Derived> &m)
+{
+	return static_cast<size_t>(m.size()) * sizeof(typename Derived::Scalar);
+}
+
+/** @brief Heap bytes of a vector */
+template <typename T, typename Alloc>
+inline size_t heapMemoryUsage(const std::vector<T, Alloc> &v)
+{
+	return v.capacity() * sizeof(T);
+}
+
+/** @brief Heap bytes of a map (a red-black tree node has three pointers and a color) */
+template <typename Key, typename T, typename Compare, typename Alloc>
+inline size_t heapMemoryUsage(const std::map<Key, T, Compare, Alloc> &m)
+{
+	return m.size() * (sizeof(typename std::map<Key, T, Compare, Alloc>::value_type) + 4 * sizeof(void*));
+}
+
+/** @brief Heap bytes of an unordered map (a node has a next pointer and the buckets are pointers) */
+template <typename Key, typename T, typename Hash, typename Pred, typename Alloc>
+inline size_t heapMemoryUsage(const boost::unordered_map<Key, T, Hash, Pred, Alloc> &m)
+{
+	return m.size() * (sizeof(typename boost::unordered_map<Key, T, Hash, Pred, Alloc>::value_type) + sizeof(void*))
+			 + m.bucket_count() * sizeof(void*);
+}
+
+/** @brief Heap bytes of an object owned by a shared pointer, including the object */
+template <typename T>
+inline size_t heapMemoryUsage(const boost::shared_ptr<T> &p)
+{
+	return p ? sizeof(T) + heapMemoryUsage(*p) : 0;
+}
+
+}
+
+#endif
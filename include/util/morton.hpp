@@ -0,0 +1,63 @@
+#ifndef _GPMAP_MORTON_HPP_
+#define _GPMAP_MORTON_HPP_
+
+// Boost
+#include <boost/cstdint.hpp>		// boost::uint64_t
+
+namespace GPMap {
+
+/** @brief		Spread the lower 21 bits of an integer so that there are two zero bits between each bit */
+inline boost::uint64_t mortonSpreadBits(const boost::uint64_t v)
+{
+	boost::uint64_t x = v & 0x1fffffULL;
+	x = (x | (x << 32)) & 0x1f00000000ffffULL;
+	x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+	x = (x | (x <<  8)) & 0x100f00f00f00f00fULL;
+	x = (x | (x <<  4)) & 0x10c30c30c30c30c3ULL;
+	x = (x | (x <<  2)) & 0x1249249249249249ULL;
+	return x;
+}
+
+/** @brief		Compact every third bit of an integer into the lower 21 bits */
+inline boost::uint64_t mortonCompactBits(const boost::uint64_t v)
+{
+	boost::uint64_t x = v & 0x1249249249249249ULL;
+	x = (x | (x >>  2)) & 0x10c30c30c30c30c3ULL;
+	x = (x | (x >>  4)) & 0x100f00f00f00f00fULL;
+	x = (x | (x >>  8)) & 0x1f0000ff0000ffULL;
+	x = (x | (x >> 16)) & 0x1f00000000ffffULL;
+	x = (x | (x >> 32)) & 0x1fffffULL;
+	return x;
+}
+
+/** @brief		64-bit Morton (Z-order) code of a 3D integer key
+  * @details	Each coordinate should be in [0, 2^21).
+  *				Keys which are close in space tend to be close in the code order.
+  */
+inline boost::uint64_t mortonEncode(const unsigned int x, const unsigned int y, const unsigned int z)
+{
+	return mortonSpreadBits(x) | (mortonSpreadBits(y) << 1) | (mortonSpreadBits(z) << 2);
+}
+
+/** @brief		3D integer key of a 64-bit Morton (Z-order) code */
+inline void mortonDecode(const boost::uint64_t code, unsigned int &x, unsigned int &y, unsigned int &z)
+{
+	x = static_cast<unsigned int>(mortonCompactBits(code));
+	y = static_cast<unsigned int>(mortonCompactBits(code >> 1));
+	z = static_cast<unsigned int>(mortonCompactBits(code >> 2));
+}
+
+/** @brief		64-bit Morton (Z-order) code of a signed 3D integer key
+  * @details	Each coordinate should be in [-2^20, 2^20).
+  */
+inline boost::uint64_t mortonEncodeSigned(const int x, const int y, const int z)
+{
+	const int OFFSET = 1 << 20;
+	return mortonEncode(static_cast<unsigned int>(x + OFFSET),
+							  static_cast<unsigned int>(y + OFFSET),
+							  static_cast<unsigned int>(z + OFFSET));
+}
+
+}
+
+#endif
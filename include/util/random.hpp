@@ -1,6 +1,16 @@
 #ifndef _GPMAP_RANDOM_HPP_
 #define _GPMAP_RANDOM_HPP_
 
+// STL
+#include <cstdlib>		// rand
+#include <vector>
+#include <iterator>		// std::distance, std::advance
+#include <algorithm>		// std::swap, std::sort
+
+// Boost
+#include <boost/cstdint.hpp>				// boost::uint64_t
+#include <boost/unordered_set.hpp>		// boost::unordered_set
+
 namespace GPMap {
 
 /** @brief	Fisher-Yates shuffle (select random m out of n) */
@@ -19,6 +29,165 @@ bidiiter random_unique(bidiiter begin, bidiiter end, size_t num_random)
 	return begin;
 }
 
+/** @brief		Light-weight pseudo random number generator (SplitMix64)
+  * @details	Unlike rand(), it has no global state,
+  *				so each worker thread can own its generator with its own seed.
+  */
+class RandomGenerator
+{
+public:
+	typedef boost::uint64_t result_type;
+
+	/** @brief Constructor */
+	explicit RandomGenerator(const boost::uint64_t seed = 0)
+		: m_state(seed)
+	{
+	}
+
+	/** @brief Reset the seed */
+	void seed(const boost::uint64_t seed)
+	{
+		m_state = seed;
+	}
+
+	/** @brief Next 64-bit random number */
+	boost::uint64_t operator()()
+	{
+		boost::uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	/** @brief Uniform random integer in [0, n) without modulo bias */
+	size_t uniform(const size_t n)
+	{
+		if(n <= 1) return 0;
+		const boost::uint64_t N		= static_cast<boost::uint64_t>(n);
+		const boost::uint64_t limit	= (~static_cast<boost::uint64_t>(0)) - (~static_cast<boost::uint64_t>(0)) % N;
+		boost::uint64_t r;
+		do { r = (*this)(); } while(r >= limit);
+		return static_cast<size_t>(r % N);
+	}
+
+	/** @brief Uniform random number in [0, 1) */
+	double uniform01()
+	{
+		return static_cast<double>((*this)() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+protected:
+	/** @brief State */
+	boost::uint64_t m_state;
+};
+
+/** @brief	Call sites which draw random numbers
+  * @details	Each call site has its own random stream, so adding random draws at one site
+  *				does not change the random numbers at the others.
+  */
+enum RandomStreamSite
+{
+	RANDOM_STREAM_BLOCK_SAMPLING		= 1,	// random blocks for training hyperparameters
+	RANDOM_STREAM_TRAINING_PARTITION	= 2,	// partitioning points of a block for training hyperparameters
+	RANDOM_STREAM_PREDICTION_PARTITION	= 3,	// partitioning or sampling points of a block for prediction
+	RANDOM_STREAM_CLOUD_SAMPLING		= 4	// sampling points of a point cloud
+};
+
+/** @brief	Mix a 64-bit integer (SplitMix64 finalizer) */
+inline boost::uint64_t mixBits(boost::uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/** @brief		Random streams derived from one seed
+  * @details	The seed of each stream is a hash of (seed, key, call site),
+  *				where the key is usually the Morton code of a block.
+  *				Since a stream does not depend on the order of the draws of the other streams,
+  *				serial and parallel processing of blocks give identical results.
+  */
+class RandomStreams
+{
+public:
+	/** @brief Constructor */
+	explicit RandomStreams(const boost::uint64_t seed = 0)
+		: m_seed(seed)
+	{
+	}
+
+	/** @brief Set the seed */
+	void seed(const boost::uint64_t seed)	{ m_seed = seed; }
+
+	/** @brief Get the seed */
+	boost::uint64_t seed() const				{ return m_seed; }
+
+	/** @brief		Random number generator for a key and a call site
+	  * @details	The key and the call site are mixed separately,
+	  *				so that (key, site) and (key + 1, site - 1) do not share a stream.
+	  */
+	RandomGenerator stream(const boost::uint64_t key, const RandomStreamSite site) const
+	{
+		const boost::uint64_t keySite = mixBits(mixBits(key) ^ mixBits(static_cast<boost::uint64_t>(site) * 0x9e3779b97f4a7c15ULL));
+		return RandomGenerator(mixBits(mixBits(m_seed ^ 0x9e3779b97f4a7c15ULL) ^ keySite));
+	}
+
+protected:
+	/** @brief Seed */
+	boost::uint64_t m_seed;
+};
+
+/** @brief	Fisher-Yates shuffle (select random m out of n) with a random number generator */
+template<class bidiiter, class RandomGeneratorT>
+bidiiter random_unique(bidiiter begin, bidiiter end, size_t num_random, RandomGeneratorT &rng)
+{
+	size_t left = std::distance(begin, end);
+	while(num_random--)
+	{
+		bidiiter r = begin;
+		std::advance(r, rng.uniform(left));
+		std::swap(*begin, *r);
+		++begin;
+		--left;
+	}
+	return begin;
+}
+
+/** @brief	Fisher-Yates shuffle with a random number generator
+  * @note	It is not named random_shuffle to avoid ambiguity with std::random_shuffle by argument-dependent lookup. */
+template<class bidiiter, class RandomGeneratorT>
+void fisher_yates_shuffle(bidiiter begin, bidiiter end, RandomGeneratorT &rng)
+{
+	random_unique(begin, end, std::distance(begin, end), rng);
+}
+
+/** @brief		Floyd's algorithm (select random m out of [0, n))
+  * @details	Unlike random_unique(), it neither builds nor shuffles an n-length index vector,
+  *				so it takes O(m) time and memory.
+  *				The selected indices are sorted in ascending order.
+  */
+template<class RandomGeneratorT>
+void floyd_sampling(const size_t n, size_t m, RandomGeneratorT &rng, std::vector<int> &indices)
+{
+	// all
+	if(m > n) m = n;
+
+	// select
+	boost::unordered_set<int> selected(m);
+	indices.clear();
+	indices.reserve(m);
+	for(size_t j = n - m; j < n; j++)
+	{
+		const int t = static_cast<int>(rng.uniform(j + 1));
+		const int k = selected.insert(t).second ? t : static_cast<int>(j);
+		if(k != t) selected.insert(k);
+		indices.push_back(k);
+	}
+
+	// sort
+	std::sort(indices.begin(), indices.end());
+}
+
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -91,6 +91,24 @@ public:
 		return ns2sec(m_cpu_times.wall);
 	}
 
+	/** @brief Boost timer wall-clock time in nanoseconds */
+	inline boost::timer::nanosecond_type wall_clock_ns() const
+	{
+		return m_cpu_times.wall;
+	}
+
+	/** @brief Boost timer user CPU time */
+	inline float user_cpu_time() const
+	{
+		return ns2sec(m_cpu_times.user);
+	}
+
+	/** @brief Boost timer system CPU time */
+	inline float system_cpu_time() const
+	{
+		return ns2sec(m_cpu_times.system);
+	}
+
 	void clear()
 	{
 		// boost::timer
@@ -139,6 +157,15 @@ public:
 	{
 	}
 
+	/** @brief Restart the timer */
+	void start()
+	{
+		m_cpu_timer.start();
+		m_start_user	= boost::chrono::process_user_cpu_clock::now();
+		m_start_system	= boost::chrono::process_system_cpu_clock::now();
+		m_start_real	= boost::chrono::process_real_cpu_clock::now();
+	}
+
 	CPU_Times elapsed()
 	{
 		CPU_Times t_elapsed;
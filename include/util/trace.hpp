@@ -0,0 +1,252 @@
+#ifndef _GPMAP_TRACE_HPP_
+#define _GPMAP_TRACE_HPP_
+
+// STL
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>		// std::min
+
+// Boost
+#include <boost/cstdint.hpp>						// boost::uint64_t, boost::int64_t
+#include <boost/chrono.hpp>						// boost::chrono::high_resolution_clock
+#include <boost/shared_ptr.hpp>					// boost::shared_ptr
+#include <boost/thread/mutex.hpp>				// boost::mutex
+#include <boost/thread/tss.hpp>					// boost::thread_specific_ptr
+
+namespace GPMap {
+
+/** @brief Completed span */
+struct TraceEvent
+{
+	const char			*name;			// string literal
+	const char			*argName;		// string literal or NULL
+	boost::int64_t		argValue;
+	boost::uint64_t	start_ns;		// since the epoch of the tracer
+	boost::uint64_t	duration_ns;
+};
+
+/** @brief		Ring buffer of the spans of a thread
+  * @details	Only its own thread writes to it, so recording does not lock.
+  *				When it is full, the oldest spans are overwritten.
+  */
+class TraceBuffer
+{
+public:
+	/** @brief Constructor */
+	TraceBuffer(const size_t capacity, const int threadId)
+		: m_events(std::max<size_t>(capacity, 1)),
+		  m_threadId(threadId),
+		  m_numEvents(0)
+	{
+	}
+
+	/** @brief Record a span */
+	inline void push(const TraceEvent &event)
+	{
+		m_events[m_numEvents % m_events.size()] = event;
+		m_numEvents++;
+	}
+
+	/** @brief Thread id */
+	inline int threadId() const	{ return m_threadId; }
+
+	/** @brief Number of kept spans */
+	inline size_t size() const		{ return std::min<size_t>(m_numEvents, m_events.size()); }
+
+	/** @brief Number of overwritten spans */
+	inline size_t numDropped() const	{ return m_numEvents - size(); }
+
+	/** @brief i-th kept span from the oldest */
+	inline const TraceEvent& operator[](const size_t i) const
+	{
+		return m_events[(m_numEvents - size() + i) % m_events.size()];
+	}
+
+	/** @brief Clear */
+	inline void clear()	{ m_numEvents = 0; }
+
+protected:
+	std::vector<TraceEvent>		m_events;
+	const int						m_threadId;
+	size_t							m_numEvents;
+};
+
+/** @brief		Hierarchical span tracer
+  * @details	Spans are recorded by TraceZone objects, usually through GPMAP_TRACE_ZONE(),
+  *				into a ring buffer per thread, and exported in the Chrome trace event format
+  *				which chrome://tracing and Perfetto can open.
+  *				Nesting is implied by the start times and durations of the spans of a thread.
+  *				It is disabled by default, in which case a zone costs a flag check.
+  */
+class Tracer
+{
+public:
+	typedef boost::chrono::high_resolution_clock	Clock;
+	typedef boost::shared_ptr<TraceBuffer>			TraceBufferPtr;
+
+public:
+	/** @brief Enable or disable recording */
+	static void enable(const bool fEnable = true)
+	{
+		// start the clock
+		epoch();
+		m_fEnabled = fEnable;
+	}
+
+	/** @brief Check if recording is enabled */
+	static inline bool isEnabled()	{ return m_fEnabled; }
+
+	/** @brief Capacity of the ring buffer of each thread created after this call */
+	static void setBufferCapacity(const size_t capacity)
+	{
+		m_bufferCapacity = capacity;
+	}
+
+	/** @brief Nanoseconds since the epoch */
+	static inline boost::uint64_t now_ns()
+	{
+		return static_cast<boost::uint64_t>(boost::chrono::duration_cast<boost::chrono::nanoseconds>(Clock::now() - epoch()).count());
+	}
+
+	/** @brief Record a span into the buffer of the calling thread */
+	static inline void record(const TraceEvent &event)
+	{
+		TraceBufferPtr *ppBuffer = m_ppThreadBuffer.get();
+		TraceBuffer *pBuffer = ppBuffer ? ppBuffer->get() : createThreadBuffer();
+		pBuffer->push(event);
+	}
+
+	/** @brief Clear the spans of all threads */
+	static void clear()
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		for(size_t i = 0; i < m_buffers.size(); i++) m_buffers[i]->clear();
+	}
+
+	/** @brief		Save the spans of all threads as a Chrome trace JSON file
+	  * @details	It should be called when no thread is recording.
+	  * @return		Number of saved spans
+	  */
+	static size_t saveAsChromeTrace(const std::string &strFilePath)
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		std::ofstream fout(strFilePath.c_str());
+		if(!fout) return 0;
+
+		// complete events in microseconds
+		fout << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+		fout.setf(std::ios::fixed);
+		fout.precision(3);
+		size_t numEvents = 0;
+		size_t numDropped = 0;
+		for(size_t i = 0; i < m_buffers.size(); i++)
+		{
+			const TraceBuffer &buffer = *m_buffers[i];
+			numDropped += buffer.numDropped();
+			for(size_t j = 0; j < buffer.size(); j++)
+			{
+				const TraceEvent &event = buffer[j];
+				fout << (numEvents > 0 ? "," : "") << std::endl
+					  << "{\"name\": \"" << event.name << "\", \"cat\": \"gpmap\", \"ph\": \"X\""
+					  << ", \"ts\": "	<< static_cast<double>(event.start_ns)		* 1e-3
+					  << ", \"dur\": "	<< static_cast<double>(event.duration_ns)	* 1e-3
+					  << ", \"pid\": 1, \"tid\": " << buffer.threadId();
+				if(event.argName) fout << ", \"args\": {\"" << event.argName << "\": " << event.argValue << "}";
+				fout << "}";
+				numEvents++;
+			}
+		}
+		fout << std::endl << "], \"otherData\": {\"dropped_events\": " << numDropped << "}}" << std::endl;
+
+		return numEvents;
+	}
+
+protected:
+	/** @brief Epoch of the timestamps, which is fixed at the first call */
+	static const Clock::time_point& epoch()
+	{
+		static const Clock::time_point start = Clock::now();
+		return start;
+	}
+
+	/** @brief Create and register the buffer of the calling thread */
+	static TraceBuffer* createThreadBuffer()
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		TraceBufferPtr pBuffer(new TraceBuffer(m_bufferCapacity, static_cast<int>(m_buffers.size())));
+		m_buffers.push_back(pBuffer);
+
+		// the registry owns the buffer, so that the spans survive the thread
+		m_ppThreadBuffer.reset(new TraceBufferPtr(pBuffer));
+		return pBuffer.get();
+	}
+
+protected:
+	/** @brief Recording flag */
+	static bool													m_fEnabled;
+
+	/** @brief Capacity of a new ring buffer */
+	static size_t												m_bufferCapacity;
+
+	/** @brief Buffers of all threads */
+	static boost::mutex										m_mutex;
+	static std::vector<TraceBufferPtr>					m_buffers;
+
+	/** @brief Buffer of the calling thread */
+	static boost::thread_specific_ptr<TraceBufferPtr>	m_ppThreadBuffer;
+};
+
+bool													Tracer::m_fEnabled			= false;
+size_t												Tracer::m_bufferCapacity	= 1 << 16;
+boost::mutex										Tracer::m_mutex;
+std::vector<Tracer::TraceBufferPtr>				Tracer::m_buffers;
+boost::thread_specific_ptr<Tracer::TraceBufferPtr>	Tracer::m_ppThreadBuffer;
+
+/** @brief		RAII span
+  * @details	The span from the constructor to the destructor is recorded if the tracer is enabled at construction.
+  */
+class TraceZone
+{
+public:
+	/** @brief Constructor with a string literal name and an optional integer argument */
+	explicit TraceZone(const char *name, const char *argName = 0, const boost::int64_t argValue = 0)
+		: m_fEnabled(Tracer::isEnabled())
+	{
+		if(!m_fEnabled) return;
+		m_event.name		= name;
+		m_event.argName	= argName;
+		m_event.argValue	= argValue;
+		m_event.start_ns	= Tracer::now_ns();
+	}
+
+	/** @brief Destructor */
+	~TraceZone()
+	{
+		if(!m_fEnabled) return;
+		m_event.duration_ns = Tracer::now_ns() - m_event.start_ns;
+		Tracer::record(m_event);
+	}
+
+protected:
+	const bool	m_fEnabled;
+	TraceEvent	m_event;
+};
+
+}
+
+/** @brief		Trace zones
+  * @details	They compile to nothing unless GPMAP_TRACE is defined.
+  */
+#define GPMAP_TRACE_CONCAT_(a, b)	a##b
+#define GPMAP_TRACE_CONCAT(a, b)		GPMAP_TRACE_CONCAT_(a, b)
+#ifdef GPMAP_TRACE
+	#define GPMAP_TRACE_ZONE(name)								GPMap::TraceZone GPMAP_TRACE_CONCAT(traceZone_, __LINE__)(name)
+	#define GPMAP_TRACE_ZONE_ARG(name, argName, argValue)	GPMap::TraceZone GPMAP_TRACE_CONCAT(traceZone_, __LINE__)(name, argName, static_cast<boost::int64_t>(argValue))
+#else
+	#define GPMAP_TRACE_ZONE(name)
+	#define GPMAP_TRACE_ZONE_ARG(name, argName, argValue)
+#endif
+
+#endif
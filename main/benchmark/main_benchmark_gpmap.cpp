@@ -0,0 +1,215 @@
+// Eigen
+#include "serialization/eigen_serialization.hpp" // Eigen
+// includes followings inside of it
+//		- #define EIGEN_NO_DEBUG		// to speed up
+//		- #define EIGEN_USE_MKL_ALL	// to use Intel Math Kernel Library
+//		- #include <Eigen/Core>
+
+// trace zones of the GPMap building process
+#define GPMAP_TRACE
+
+// STL
+#include <cstdlib>		// atoi, atof
+#include <string>
+#include <sstream>		// std::stringstream
+#include <limits>			// std::numeric_limits<T>::max()
+
+// GPMap
+#include "io/io.hpp"									// loadPointCloud, savePointCloud
+#include "util/timer.hpp"							// CPU_Timer, CPU_Times
+#include "util/filesystem.hpp"					// create_directory
+#include "util/random.hpp"							// RandomGenerator
+#include "util/trace.hpp"							// Tracer
+#include "util/async_logger.hpp"					// AsyncLogger
+#include "common/common.hpp"						// getMinMaxPointXYZ
+#include "features/surface_normal.hpp"			// unitRayBackVectors
+#include "octree/octree_gpmap.hpp"				// OctreeGPMap
+#include "octree/octree_container.hpp"			// OctreeGPMapContainer
+#include "bcm/bcm.hpp"								// BCM
+#include "iso_surface/iso_surface.hpp"			// IsoSurfaceExtraction
+#include "benchmark/synthetic_scene.hpp"		// SyntheticScene
+#include "benchmark/benchmark_report.hpp"		// BenchmarkReport, BenchmarkRecord
+using namespace GPMap;
+
+// usage: main_benchmark_gpmap [output folder] [num scans] [num rays per axis] [noise std] [block size] [num cells per axis] [max num points to predict] [seed]
+int main(int argc, char** argv)
+{
+	// [0] setting - benchmark parameters with defaults
+	const std::string	strOutputFolder				= argc > 1 ? argv[1]											: "../../data/benchmark/";
+	const size_t		NUM_SCANS						= argc > 2 ? static_cast<size_t>(atoi(argv[2]))		: 4;
+	const size_t		NUM_RAYS_PER_AXIS				= argc > 3 ? static_cast<size_t>(atoi(argv[3]))		: 128;
+	const float			NOISE_STD						= argc > 4 ? static_cast<float>(atof(argv[4]))		: 0.001f;
+	const double		BLOCK_SIZE						= argc > 5 ? atof(argv[5])										: 0.05;
+	const size_t		NUM_CELLS_PER_AXIS			= argc > 6 ? static_cast<size_t>(atoi(argv[6]))		: 10;
+	const size_t		MAX_NUM_POINTS_TO_PREDICT	= argc > 7 ? static_cast<size_t>(atoi(argv[7]))		: 100;
+	const size_t		SEED								= argc > 8 ? static_cast<size_t>(atoi(argv[8]))		: 0;
+
+	// [0] setting - GPMap constants
+	const size_t	MIN_NUM_POINTS_TO_PREDICT			= 2;
+	const bool		FLAG_INDEPENDENT_TEST_POSITIONS	= true;
+	const float		GAP										= 0.001f;
+	const int		MAX_ITER_BEFORE_UPDATE				= 0;
+	const int		MAX_ITER_TRAINING						= 10;
+	const size_t	NUM_RANDOM_BLOCKS						= 10;
+	const float		FOV										= 1.2f;	// radian
+	const float		MAX_RANGE								= 5.f;
+	typedef GP::InfExactDerObs<float, GP::MeanZeroDerObs, GP::CovMaternisoDerObs, GP::LikGaussDerObs>::Hyp Hyp;
+	typedef OctreeGPMap<GP::MeanZeroDerObs, GP::CovMaternisoDerObs, GP::LikGaussDerObs, GP::InfExactDerObs, OctreeGPMapContainer<BCM> > OctreeGPMapT;
+
+	// [0] setting - directory
+	const std::string strLogFolder				(strOutputFolder + "log/");
+	const std::string strGPMapFilePath			(strOutputFolder + "synthetic_gpmap");
+	const std::string strOctomapFilePath		(strOutputFolder + "synthetic_octomap");
+	create_directory(strOutputFolder);
+	create_directory(strLogFolder);
+	LogFile logFile(strLogFolder + "benchmark_gpmap.log");
+	AsyncLogger::open(strLogFolder + "benchmark_gpmap_hot_path.log");
+
+	// report
+	BenchmarkReport report;
+	report.setParameter("num_scans",						NUM_SCANS);
+	report.setParameter("num_rays_per_axis",			NUM_RAYS_PER_AXIS);
+	report.setParameter("noise_std",						NOISE_STD);
+	report.setParameter("block_size",					BLOCK_SIZE);
+	report.setParameter("num_cells_per_axis",			NUM_CELLS_PER_AXIS);
+	report.setParameter("max_num_points_to_predict",	MAX_NUM_POINTS_TO_PREDICT);
+	report.setParameter("seed",							SEED);
+
+	// trace
+	Tracer::enable();
+
+	// [1] synthetic scans
+	logFile << "[1] Synthetic scans" << std::endl;
+	const SyntheticScene scene = SyntheticScene::defaultScene();
+	const Eigen::Vector3f target(0.f, 0.f, 0.2f);
+	PointXYZVList sensorPositionList;
+	SyntheticScene::circularSensorPositions(NUM_SCANS, target, 1.5f, 0.8f, sensorPositionList);
+
+	PointXYZCloudPtrList hitPointCloudPtrList(NUM_SCANS);
+	RandomGenerator rng(SEED);
+	size_t numHitPoints = 0;
+	CPU_Timer timer;
+	for(size_t i = 0; i < NUM_SCANS; i++)
+	{
+		hitPointCloudPtrList[i].reset(new PointXYZCloud());
+		numHitPoints += scene.scan(sensorPositionList[i], target, NUM_RAYS_PER_AXIS, FOV, NOISE_STD, MAX_RANGE, rng, *hitPointCloudPtrList[i]);
+	}
+	report.add(BenchmarkRecord("scan", timer.elapsed(), numHitPoints));
+
+	// [2] observations
+	logFile << "[2] Observations" << std::endl;
+	PointNormalCloudPtrList pointNormalCloudPtrList;
+	timer.start();
+	unitRayBackVectors(hitPointCloudPtrList, sensorPositionList, pointNormalCloudPtrList);
+	report.add(BenchmarkRecord("observations", timer.elapsed(), numHitPoints));
+
+	PointNormalCloudPtr pAllPointNormalCloud(new PointNormalCloud());
+	for(size_t i = 0; i < pointNormalCloudPtrList.size(); i++)
+		(*pAllPointNormalCloud) += (*pointNormalCloudPtrList[i]);
+
+	// hyperparameters
+	const float sparse_ell	= 0.0268108f;
+	const float matern_ell	= 0.0907317f;
+	const float sigma_f2		= 0.0144318f;
+	const float sigma_n		= 4.31269e-007f;	// will not be used
+	const float sigma_nd		= 0.017184f;
+
+	Hyp logHyp;
+	logHyp.cov(0) = log(sparse_ell);
+	logHyp.cov(1) = log(matern_ell);
+	logHyp.cov(2) = log(sigma_f2);
+	logHyp.lik(0) = log(sigma_n);
+	logHyp.lik(1) = log(sigma_nd);
+
+	// [3] gpmap
+	OctreeGPMapT gpmap(BLOCK_SIZE,
+							 NUM_CELLS_PER_AXIS,
+							 MIN_NUM_POINTS_TO_PREDICT,
+							 MAX_NUM_POINTS_TO_PREDICT,
+							 FLAG_INDEPENDENT_TEST_POSITIONS);
+	pcl::PointXYZ min_pt, max_pt;
+	getMinMaxPointXYZ<pcl::PointNormal>(*pAllPointNormalCloud, min_pt, max_pt);
+	gpmap.defineBoundingBox(min_pt, max_pt);
+	gpmap.setInputCloud(pAllPointNormalCloud, GAP);
+
+	logFile << "[3] Add points from the input cloud" << std::endl;
+	timer.start();
+	gpmap.addPointsFromInputCloud();
+	report.add(BenchmarkRecord("addPointsFromInputCloud", timer.elapsed(), pAllPointNormalCloud->size()));
+
+	// [4] train
+	logFile << "[4] Train" << std::endl;
+	Hyp trainedLogHyp(logHyp);
+	timer.start();
+	gpmap.train(trainedLogHyp, MAX_ITER_TRAINING, NUM_RANDOM_BLOCKS);
+	report.add(BenchmarkRecord("train", timer.elapsed(), NUM_RANDOM_BLOCKS));
+
+	// [5] update with the default hyperparameters, so that the timings do not depend on the training
+	logFile << "[5] Update" << std::endl;
+	CPU_Times t_update_training, t_update_predict, t_update_combine;
+	timer.start();
+	gpmap.update(logHyp, MAX_ITER_BEFORE_UPDATE, t_update_training, t_update_predict, t_update_combine);
+	report.add(BenchmarkRecord("update", timer.elapsed(), pAllPointNormalCloud->size()));
+	report.add(BenchmarkRecord("update_training",	t_update_training,	pAllPointNormalCloud->size()));
+	report.add(BenchmarkRecord("update_predict",		t_update_predict,		pAllPointNormalCloud->size()));
+	report.add(BenchmarkRecord("update_combine",		t_update_combine,		pAllPointNormalCloud->size()));
+	gpmap.getBlockStatistics().saveAsCSV			(strOutputFolder + "benchmark_gpmap_blocks.csv");
+	gpmap.getBlockStatistics().saveSummaryAsCSV	(strOutputFolder + "benchmark_gpmap_blocks_summary.csv");
+
+	// memory
+	OctreeGPMapMemoryUsage memoryUsage;
+	gpmap.memoryUsage(memoryUsage);
+	report.add(BenchmarkRecord("memory_bytes").add("octree",				static_cast<double>(memoryUsage.octree))
+															.add("indices",			static_cast<double>(memoryUsage.indices))
+															.add("leaf_data",			static_cast<double>(memoryUsage.leafData))
+															.add("test_positions",	static_cast<double>(memoryUsage.testPositions))
+															.add("sorted_cloud",		static_cast<double>(memoryUsage.sortedCloud))
+															.add("caches",				static_cast<double>(memoryUsage.caches))
+															.add("total",				static_cast<double>(memoryUsage.total()))
+															.add("update_high_water_mark", static_cast<double>(gpmap.getMemoryHighWaterMark())));
+
+	// [6] save as a point cloud
+	logFile << "[6] Save as a point cloud" << std::endl;
+	const float MAX_VALUE = std::numeric_limits<float>::max();
+	timer.start();
+	const size_t numBlocks = gpmap.saveAsPointCloud(strGPMapFilePath,
+																	pcl::PointXYZ(-MAX_VALUE, -MAX_VALUE, -MAX_VALUE),
+																	pcl::PointXYZ( MAX_VALUE,  MAX_VALUE,  MAX_VALUE));
+	report.add(BenchmarkRecord("saveAsPointCloud", timer.elapsed(), numBlocks));
+
+	// [7] marching cubes
+	logFile << "[7] Marching cubes" << std::endl;
+	PointNormalCloudPtr pPointCloudGPMap;
+	loadPointCloud<pcl::PointNormal>(pPointCloudGPMap, strGPMapFilePath + ".pcd");
+	IsoSurfaceExtraction isoSurface(static_cast<float>(BLOCK_SIZE / static_cast<double>(NUM_CELLS_PER_AXIS)));
+	timer.start();
+	const size_t numGridPoints = isoSurface.insertMeanVarFromGPMap(*pPointCloudGPMap);
+	report.add(BenchmarkRecord("insertMeanVarFromGPMap", timer.elapsed(), numGridPoints));
+	timer.start();
+	const size_t numTriangles = isoSurface.marchingcubes();
+	report.add(BenchmarkRecord("marchingcubes", timer.elapsed(), numTriangles));
+	report.add(BenchmarkRecord("iso_surface_memory_bytes").add("total", static_cast<double>(isoSurface.memoryUsage())));
+
+	// [8] octomap
+	logFile << "[8] Octomap" << std::endl;
+	const float		OCCUPANCY_THRESHOLD			= 0.f;
+	const bool		FLAG_REMOVE_ISOLATED_CELLS	= true;
+	timer.start();
+	gpmap.saveAsOctomap(strOctomapFilePath, OCCUPANCY_THRESHOLD, FLAG_REMOVE_ISOLATED_CELLS);
+	report.add(BenchmarkRecord("saveAsOctomap", timer.elapsed(), numBlocks));
+
+	// [9] report
+	report.saveAsCSV	(strOutputFolder + "benchmark_gpmap.csv");
+	report.saveAsJSON	(strOutputFolder + "benchmark_gpmap.json");
+	Tracer::saveAsChromeTrace(strOutputFolder + "benchmark_gpmap_trace.json");
+	AsyncLogger::close();
+	for(size_t i = 0; i < report.records().size(); i++)
+	{
+		const BenchmarkRecord &record = report.records()[i];
+		double wall_sec(0.0);
+		record.get("wall_sec", wall_sec);
+		std::cout << record.name() << ": " << wall_sec << " seconds" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,432 @@
+// Eigen
+#include "serialization/eigen_serialization.hpp" // Eigen
+// includes followings inside of it
+//		- #define EIGEN_NO_DEBUG		// to speed up
+//		- #define EIGEN_USE_MKL_ALL	// to use Intel Math Kernel Library
+//		- #include <Eigen/Core>
+
+// STL
+#include <cstdlib>		// malloc, free, atoi
+#include <new>			// std::bad_alloc
+#include <string>
+#include <vector>
+#include <sstream>		// std::stringstream
+#include <iostream>
+#include <fstream>		// std::ofstream for IsoSurfaceExtraction
+
+// GPMap
+#include "util/data_types.hpp"					// Vector, Matrix, PointNormalCloud, PointXYZVList
+#include "util/random.hpp"							// RandomGenerator
+#include "bcm/bcm.hpp"								// BCM
+#include "data/training_data.hpp"				// generateTrainingData
+#include "data/test_data.hpp"						// xyz2row, meshGrid
+#include "plsc/plsc.hpp"							// PLSC
+#include "iso_surface/iso_surface.hpp"			// IsoSurfaceExtraction
+#include "benchmark/benchmark_report.hpp"		// BenchmarkReport
+#include "benchmark/micro_benchmark.hpp"		// microBenchmark, AllocationCounter
+using namespace GPMap;
+
+// count heap allocations
+#if defined(__GLIBC__)
+// malloc wrapper
+// both operator new and the aligned allocator of Eigen allocate with malloc
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t num, size_t size);
+extern "C" void* __libc_realloc(void *p, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+	AllocationCounter::allocate(size);
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t num, size_t size)
+{
+	AllocationCounter::allocate(num * size);
+	return __libc_calloc(num, size);
+}
+
+extern "C" void* realloc(void *p, size_t size)
+{
+	AllocationCounter::allocate(size);
+	return __libc_realloc(p, size);
+}
+
+const char * const ALLOCATION_COUNTER = "malloc";
+#elif defined(_MSC_VER) && defined(_DEBUG)
+// allocation hook of the debug CRT
+// both operator new and the aligned allocator of Eigen allocate with malloc
+#include <crtdbg.h>
+
+int countAllocation(int allocType, void* /*userData*/, size_t size, int blockType,
+						  long /*requestNumber*/, const unsigned char* /*filename*/, int /*lineNumber*/)
+{
+	if((allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) && blockType != _CRT_BLOCK)
+		AllocationCounter::allocate(size);
+	return TRUE;
+}
+
+const char * const ALLOCATION_COUNTER = "crt_alloc_hook";
+#else
+// replaced global operator new
+// the aligned allocator of Eigen is not counted
+void* operator new(size_t size)
+{
+	AllocationCounter::allocate(size);
+	void *p = malloc(size > 0 ? size : 1);
+	if(!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) throw()
+{
+	free(p);
+}
+
+const char * const ALLOCATION_COUNTER = "operator_new";
+#endif
+
+// sink to keep the results alive
+volatile float g_sink = 0.f;
+
+// random matrix in [-1, 1)
+template <typename Derived>
+void randomMatrix(RandomGenerator &rng, Eigen::MatrixBase<Derived> &A)
+{
+	for(int col = 0; col < A.cols(); col++)
+		for(int row = 0; row < A.rows(); row++)
+			A(row, col) = static_cast<float>(2.0 * rng.uniform01() - 1.0);
+}
+
+/** @brief BCM::update with a fixed prediction */
+class BCMUpdate
+{
+public:
+	BCMUpdate(const size_t D, const bool fDependent, const size_t seed)
+		: m_D(D), m_fDependent(fDependent)
+	{
+		RandomGenerator rng(seed);
+		MatrixPtr	pCov(new Matrix(D, fDependent ? D : 1));
+		VectorPtr	pMean(new Vector(D));
+		randomMatrix(rng, *pMean);
+		if(fDependent)
+		{
+			// symmetric positive definite
+			Matrix A(D, D);
+			randomMatrix(rng, A);
+			(*pCov) = A * A.transpose() / static_cast<float>(D) + Matrix::Identity(D, D);
+		}
+		else
+		{
+			randomMatrix(rng, *pCov);
+			(*pCov) = pCov->cwiseAbs().array() + 0.1f;
+		}
+		m_pMean	= pMean;
+		m_pCov	= pCov;
+	}
+
+	void operator()()
+	{
+		m_bcm.update(m_pMean, m_pCov);
+	}
+
+	size_t numOps() const	{ return 1; }
+
+	// mean, cov and Cholesky factor read, sums read and written
+	size_t numBytes() const
+	{
+		return m_fDependent ? sizeof(float) * (m_D + 2*m_D*m_D + 2*(m_D + m_D*m_D))
+								  : sizeof(float) * (2*m_D + 2*(2*m_D));
+	}
+
+protected:
+	const size_t	m_D;
+	const bool		m_fDependent;
+	VectorConstPtr	m_pMean;
+	MatrixConstPtr	m_pCov;
+	BCM				m_bcm;
+};
+
+/** @brief BCM::get after a few updates */
+class BCMGet : public BCMUpdate
+{
+public:
+	BCMGet(const size_t D, const bool fDependent, const size_t seed)
+		: BCMUpdate(D, fDependent, seed)
+	{
+		for(int i = 0; i < 4; i++) BCMUpdate::operator()();
+	}
+
+	void operator()()
+	{
+		m_bcm.get(m_pMeanOut, m_pVarOut);
+		g_sink = (*m_pMeanOut)(0);
+	}
+
+protected:
+	VectorPtr	m_pMeanOut;
+	MatrixPtr	m_pVarOut;
+};
+
+/** @brief generateTrainingData for a block of derivative observations */
+class GenerateTrainingData
+{
+public:
+	GenerateTrainingData(const size_t N, const size_t seed)
+		: m_N(N), m_indices(N)
+	{
+		RandomGenerator rng(seed);
+		PointNormalCloudPtr pCloud(new PointNormalCloud());
+		pCloud->points.resize(N);
+		for(size_t i = 0; i < N; i++)
+		{
+			pcl::PointNormal &point = pCloud->points[i];
+			point.x = static_cast<float>(rng.uniform01());
+			point.y = static_cast<float>(rng.uniform01());
+			point.z = static_cast<float>(rng.uniform01());
+			Eigen::Vector3f normal(static_cast<float>(rng.uniform01() - 0.5),
+										  static_cast<float>(rng.uniform01() - 0.5),
+										  static_cast<float>(rng.uniform01() - 0.5) + 1.f);
+			normal.normalize();
+			point.normal_x		= normal.x();
+			point.normal_y		= normal.y();
+			point.normal_z		= normal.z();
+			point.curvature	= 0.f;	// derivative observation
+			m_indices[i] = static_cast<int>(i);
+		}
+		pCloud->width	= static_cast<uint32_t>(N);
+		pCloud->height	= 1;
+		m_pCloud = pCloud;
+	}
+
+	void operator()()
+	{
+		generateTrainingData(m_pCloud, m_indices, 0.001f, m_pX, m_pXd, m_pYYd);
+		g_sink = (*m_pYYd)(0);
+	}
+
+	size_t numOps() const	{ return 1; }
+
+	// points and indices read, X, Xd and yyd written
+	size_t numBytes() const
+	{
+		return m_N * (sizeof(pcl::PointNormal) + sizeof(int) + sizeof(float) * (3 + 3 + 4));
+	}
+
+protected:
+	const size_t					m_N;
+	PointNormalCloudConstPtr	m_pCloud;
+	Indices							m_indices;
+	MatrixPtr						m_pX, m_pXd;
+	VectorPtr						m_pYYd;
+};
+
+/** @brief PLSC::occupancy over mean and variance arrays */
+class PLSCOccupancy
+{
+public:
+	PLSCOccupancy(const size_t N, const size_t seed)
+		: m_mean(N), m_var(N)
+	{
+		RandomGenerator rng(seed);
+		for(size_t i = 0; i < N; i++)
+		{
+			m_mean[i]	= static_cast<float>(2.0 * rng.uniform01() - 1.0);
+			m_var[i]		= static_cast<float>(rng.uniform01());
+		}
+	}
+
+	void operator()()
+	{
+		float sum = 0.f;
+		for(size_t i = 0; i < m_mean.size(); i++)
+			sum += PLSC::occupancy(m_mean[i], m_var[i]);
+		g_sink = sum;
+	}
+
+	size_t numOps() const	{ return m_mean.size(); }
+	size_t numBytes() const	{ return 2 * sizeof(float); }
+
+protected:
+	std::vector<float> m_mean;
+	std::vector<float> m_var;
+};
+
+/** @brief Occupied cell centers of a block by xyz2row as in OctreeGPMap::saveAsOctomap */
+class CellLoop
+{
+public:
+	CellLoop(const size_t NUM_CELLS_PER_AXIS, const size_t seed)
+		: NUM_CELLS_PER_AXIS_(NUM_CELLS_PER_AXIS),
+		  NUM_CELLS_PER_BLOCK_(NUM_CELLS_PER_AXIS*NUM_CELLS_PER_AXIS*NUM_CELLS_PER_AXIS),
+		  m_pMean(new Vector(NUM_CELLS_PER_BLOCK_)),
+		  m_pVariance(new Matrix(NUM_CELLS_PER_BLOCK_, 1)),
+		  m_numOccupied(0)
+	{
+		RandomGenerator rng(seed);
+		randomMatrix(rng, *m_pMean);
+		randomMatrix(rng, *m_pVariance);
+		(*m_pVariance) = m_pVariance->cwiseAbs();
+		meshGrid(Eigen::Vector3f(0.f, 0.f, 0.f), NUM_CELLS_PER_AXIS_, 0.001f, m_pXs);
+		for(size_t row = 0; row < NUM_CELLS_PER_BLOCK_; row++)
+			if((*m_pMean)(row) >= 0.f && (*m_pVariance)(row, 0) <= 0.5f) m_numOccupied++;
+	}
+
+	void operator()()
+	{
+		m_cellCenterPointXYZVector.clear();
+		for(size_t ix = 0; ix < NUM_CELLS_PER_AXIS_; ix++)
+			for(size_t iy = 0; iy < NUM_CELLS_PER_AXIS_; iy++)
+				for(size_t iz = 0; iz < NUM_CELLS_PER_AXIS_; iz++)
+				{
+					const size_t row = xyz2row(NUM_CELLS_PER_AXIS_, ix, iy, iz);
+					if((*m_pMean)(row) >= 0.f && (*m_pVariance)(row, 0) <= 0.5f)
+						m_cellCenterPointXYZVector.push_back(pcl::PointXYZ((*m_pXs)(row, 0), (*m_pXs)(row, 1), (*m_pXs)(row, 2)));
+				}
+		g_sink = static_cast<float>(m_cellCenterPointXYZVector.size());
+	}
+
+	size_t numOps() const	{ return NUM_CELLS_PER_BLOCK_; }
+
+	// mean and variance of all cells, test positions and cell centers of occupied cells
+	size_t numBytes() const
+	{
+		return 2 * sizeof(float) + (m_numOccupied * (3 * sizeof(float) + sizeof(pcl::PointXYZ))) / NUM_CELLS_PER_BLOCK_;
+	}
+
+protected:
+	const size_t		NUM_CELLS_PER_AXIS_;
+	const size_t		NUM_CELLS_PER_BLOCK_;
+	VectorPtr			m_pMean;
+	MatrixPtr			m_pVariance;
+	MatrixPtr			m_pXs;
+	size_t				m_numOccupied;
+	PointXYZVList		m_cellCenterPointXYZVector;
+};
+
+/** @brief IsoSurfaceExtraction::marchingcubes on the signed distance field of a sphere */
+class MarchingCubes
+{
+public:
+	MarchingCubes(const size_t n)
+		: m_n(n), m_isoSurface(1.f / static_cast<float>(n))
+	{
+		const float resolution	= 1.f / static_cast<float>(n);
+		const float radius		= 0.35f;
+		for(size_t ix = 0; ix < n; ix++)
+			for(size_t iy = 0; iy < n; iy++)
+				for(size_t iz = 0; iz < n; iz++)
+				{
+					const Eigen::Vector3f p((static_cast<float>(ix) + 0.5f) * resolution - 0.5f,
+													(static_cast<float>(iy) + 0.5f) * resolution - 0.5f,
+													(static_cast<float>(iz) + 0.5f) * resolution - 0.5f);
+					m_isoSurface.insertMeanVar((static_cast<float>(ix) + 0.5f) * resolution,
+														(static_cast<float>(iy) + 0.5f) * resolution,
+														(static_cast<float>(iz) + 0.5f) * resolution,
+														radius - p.norm(), 0.01f);	// inside: positive distance
+				}
+	}
+
+	void operator()()
+	{
+		g_sink = static_cast<float>(m_isoSurface.marchingcubes());
+	}
+
+	size_t numOps() const	{ return m_n * m_n * m_n; }
+
+	// a grid point and its 7 neighbors are looked up in the map
+	size_t numBytes() const	{ return 8 * (sizeof(Key3D) + sizeof(GaussianDistribution1Df)); }
+
+protected:
+	const size_t				m_n;
+	IsoSurfaceExtraction		m_isoSurface;
+};
+
+// usage: main_benchmark_micro [output file path without extension] [scale of the number of calls] [seed]
+int main(int argc, char** argv)
+{
+	// setting
+	const std::string	strOutputFilePath	= argc > 1 ? argv[1]											: "../../data/benchmark/benchmark_micro";
+	const size_t		SCALE					= argc > 2 ? static_cast<size_t>(atoi(argv[2]))		: 1;
+	const size_t		SEED					= argc > 3 ? static_cast<size_t>(atoi(argv[3]))		: 0;
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+	_CrtSetAllocHook(countAllocation);
+#endif
+
+	BenchmarkReport report;
+	report.setParameter("scale",	SCALE);
+	report.setParameter("seed",	SEED);
+	report.setParameter("allocation_counter",	ALLOCATION_COUNTER);
+
+	// [1] BCM
+	const size_t NUM_INDEPENDENT_DIMS = 4;
+	const size_t INDEPENDENT_DIMS_[] = {27, 125, 1000, 8000};
+	for(size_t i = 0; i < NUM_INDEPENDENT_DIMS; i++)
+	{
+		const size_t D = INDEPENDENT_DIMS_[i];
+		std::stringstream ss;	ss << "_independent_D_" << D;
+		BCMUpdate	update(D, false, SEED);		report.add(microBenchmark("bcm_update" + ss.str(),	update,	SCALE * 1000));
+		BCMGet		get(D, false, SEED);			report.add(microBenchmark("bcm_get" + ss.str(),		get,		SCALE * 1000));
+	}
+
+	const size_t NUM_DEPENDENT_DIMS = 3;
+	const size_t DEPENDENT_DIMS_[] = {27, 125, 343};
+	for(size_t i = 0; i < NUM_DEPENDENT_DIMS; i++)
+	{
+		const size_t D = DEPENDENT_DIMS_[i];
+		std::stringstream ss;	ss << "_dependent_D_" << D;
+		BCMUpdate	update(D, true, SEED);		report.add(microBenchmark("bcm_update" + ss.str(),	update,	SCALE * 10));
+		BCMGet		get(D, true, SEED);			report.add(microBenchmark("bcm_get" + ss.str(),		get,		SCALE * 10));
+	}
+
+	// [2] training data
+	const size_t NUM_BLOCK_SIZES = 4;
+	const size_t BLOCK_SIZES_[] = {10, 100, 1000, 10000};
+	for(size_t i = 0; i < NUM_BLOCK_SIZES; i++)
+	{
+		std::stringstream ss;	ss << "generateTrainingData_N_" << BLOCK_SIZES_[i];
+		GenerateTrainingData op(BLOCK_SIZES_[i], SEED);
+		report.add(microBenchmark(ss.str(), op, SCALE * 1000000 / (BLOCK_SIZES_[i] + 100)));
+	}
+
+	// [3] occupancy
+	{
+		PLSCOccupancy op(1 << 16, SEED);
+		report.add(microBenchmark("plsc_occupancy", op, SCALE * 100));
+	}
+
+	// [4] cell loops
+	const size_t NUM_CELL_SIZES = 3;
+	const size_t CELL_SIZES_[] = {10, 20, 30};
+	for(size_t i = 0; i < NUM_CELL_SIZES; i++)
+	{
+		std::stringstream ss;	ss << "xyz2row_cell_loop_n_" << CELL_SIZES_[i];
+		CellLoop op(CELL_SIZES_[i], SEED);
+		report.add(microBenchmark(ss.str(), op, SCALE * 1000000 / (CELL_SIZES_[i] * CELL_SIZES_[i] * CELL_SIZES_[i])));
+	}
+
+	// [5] marching cubes
+	const size_t NUM_GRID_SIZES = 2;
+	const size_t GRID_SIZES_[] = {16, 32};
+	for(size_t i = 0; i < NUM_GRID_SIZES; i++)
+	{
+		std::stringstream ss;	ss << "marchingcubes_n_" << GRID_SIZES_[i];
+		MarchingCubes op(GRID_SIZES_[i]);
+		report.add(microBenchmark(ss.str(), op, SCALE * 10));
+	}
+
+	// report
+	report.saveAsCSV	(strOutputFilePath + ".csv");
+	report.saveAsJSON	(strOutputFilePath + ".json");
+	for(size_t i = 0; i < report.records().size(); i++)
+	{
+		const BenchmarkRecord &record = report.records()[i];
+		double nsPerOp(0.0), allocsPerOp(0.0);
+		record.get("ns_per_op",			nsPerOp);
+		record.get("allocs_per_op",	allocsPerOp);
+		std::cout << record.name() << ": " << nsPerOp << " ns/op, " << allocsPerOp << " allocs/op" << std::endl;
+	}
+
+	return 0;
+}
@@ -18,6 +18,7 @@
 // GPMap
 #include "common/common.hpp"					// combinePointCloud
 #include "io/io.hpp"								// loadPointCloud, savePointCloud, loadSensorPositionList
+#include "io/pipeline.hpp"						// processPointClouds
 #include "visualization/cloud_viewer.hpp"	// show
 #include "features/surface_normal.hpp"		// estimateSurfaceNormals
 #include "filter/filters.hpp"					// downSampling
@@ -92,10 +93,16 @@ int main(int argc, char** argv)
 
 	if(fRunOriginalObservations)
 	{
+		// [3-1, 4-1] Function and Derivative Observations - Sequential - Pipeline
+		StringList strOutputPrefixes, strOutputSuffixes;
+		strOutputPrefixes.push_back(strOriginalIntermediateDataFolder);				strOutputSuffixes.push_back("_func_obs.pcd");
+		strOutputPrefixes.push_back(strOriginalSearchRadiusIntermediateDataFolder);	strOutputSuffixes.push_back("_der_obs.pcd");
+		processPointClouds<pcl::PointXYZ, pcl::PointNormal>(FuncDerObservationProcessor(sensorPositionList, searchRadius),
+																			 strObsFileNames, strOriginalIntermediateDataFolder, ".pcd",
+																			 strOutputPrefixes, strOutputSuffixes);
+
 		// [3-1] Function Observations (Hit Points + Unit Ray Back Vectors) - Sequential
 		PointNormalCloudPtrList funcObsCloudPtrList;
-		unitRayBackVectors(hitPointCloudPtrList, sensorPositionList, funcObsCloudPtrList);
-		savePointCloud<pcl::PointNormal>(funcObsCloudPtrList, strObsFileNames, strOriginalIntermediateDataFolder, "_func_obs.pcd");
 		loadPointCloud<pcl::PointNormal>(funcObsCloudPtrList, strObsFileNames, strOriginalIntermediateDataFolder, "_func_obs.pcd");
 		if(fShow) show<pcl::PointNormal>("Sequential Unit Ray Back Vectors", funcObsCloudPtrList, 0.005);
 
@@ -109,8 +116,6 @@ int main(int argc, char** argv)
 		// [4-1] Derivative Observations (Virtual Hit Points + Surface Normal Vectors) - Sequential
 		PointNormalCloudPtrList derObsCloudPtrList;
 		//estimateSurfaceNormals<ByNearestNeighbors>(hitPointCloudPtrList, sensorPositionList, FLAG_SERACH_BY_RADIUS, searchRadius, derObsCloudPtrList);
-		estimateSurfaceNormals<ByMovingLeastSquares>(hitPointCloudPtrList, sensorPositionList, FLAG_SERACH_BY_RADIUS, searchRadius, derObsCloudPtrList);
-		savePointCloud<pcl::PointNormal>(derObsCloudPtrList, strObsFileNames, strOriginalSearchRadiusIntermediateDataFolder, "_der_obs.pcd");
 		loadPointCloud<pcl::PointNormal>(derObsCloudPtrList, strObsFileNames, strOriginalSearchRadiusIntermediateDataFolder, "_der_obs.pcd");
 		if(fShow) show<pcl::PointNormal>("Sequential Surface Normals", derObsCloudPtrList, 0.005);
 
@@ -195,10 +200,16 @@ int main(int argc, char** argv)
 	loadPointCloud<pcl::PointXYZ>(pAllSampledHitPointCloud, strFileNameAll, strDownSampleIntermediateDataFolder, ".pcd");
 	if(fShow) show<pcl::PointXYZ>("All Down Sampled Hit Points", pAllSampledHitPointCloud);
 
+	// [3-1, 4-1] Function and Derivative Observations - Sequential - Down Sampling - Pipeline
+	StringList strOutputPrefixes, strOutputSuffixes;
+	strOutputPrefixes.push_back(strDownSampleIntermediateDataFolder);					strOutputSuffixes.push_back("_func_obs.pcd");
+	strOutputPrefixes.push_back(strDownSampleSearchRadiusIntermediateDataFolder);	strOutputSuffixes.push_back("_der_obs.pcd");
+	processPointClouds<pcl::PointXYZ, pcl::PointNormal>(FuncDerObservationProcessor(sensorPositionList, searchRadius),
+																		 strObsFileNames, strDownSampleIntermediateDataFolder, ".pcd",
+																		 strOutputPrefixes, strOutputSuffixes);
+
 	// [3-1] Function Observations (Hit Points + Unit Ray Back Vectors) - Sequential - Down Sampling
 	PointNormalCloudPtrList sampledFuncObsCloudPtrList;
-	unitRayBackVectors(sampledHitPointCloudPtrList, sensorPositionList, sampledFuncObsCloudPtrList);
-	savePointCloud<pcl::PointNormal>(sampledFuncObsCloudPtrList, strObsFileNames, strDownSampleIntermediateDataFolder, "_func_obs.pcd");
 	loadPointCloud<pcl::PointNormal>(sampledFuncObsCloudPtrList, strObsFileNames, strDownSampleIntermediateDataFolder, "_func_obs.pcd");
 	if(fShow) show<pcl::PointNormal>("Sequential Down Sampled Unit Ray Back Vectors", sampledFuncObsCloudPtrList, 0.005);
 
@@ -212,8 +223,6 @@ int main(int argc, char** argv)
 	// [4-1] Derivative Observations (Virtual Hit Points + Surface Normal Vectors) - Sequential - Down Sampling
 	PointNormalCloudPtrList sampledDerObsCloudPtrList;
 	//estimateSurfaceNormals<ByNearestNeighbors>(sampledHitPointCloudPtrList, sensorPositionList, FLAG_SERACH_BY_RADIUS, searchRadius, sampledDerObsCloudPtrList);
-	estimateSurfaceNormals<ByMovingLeastSquares>(sampledHitPointCloudPtrList, sensorPositionList, FLAG_SERACH_BY_RADIUS, searchRadius, sampledDerObsCloudPtrList);
-	savePointCloud<pcl::PointNormal>(sampledDerObsCloudPtrList, strObsFileNames, strDownSampleSearchRadiusIntermediateDataFolder, "_der_obs.pcd");
 	loadPointCloud<pcl::PointNormal>(sampledDerObsCloudPtrList, strObsFileNames, strDownSampleSearchRadiusIntermediateDataFolder, "_der_obs.pcd");
 	if(fShow) show<pcl::PointNormal>("Sequential Down Sampled Surface Normals", sampledDerObsCloudPtrList, 0.005);
 
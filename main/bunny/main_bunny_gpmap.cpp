@@ -27,10 +27,14 @@
 // GPMap
 #include "io/io.hpp"								// loadPointCloud, savePointCloud, loadSensorPositionList
 #include "octree/macro_gpmap.hpp"			// macro_gpmap
+#include "util/config.hpp"						// Config, ask
 using namespace GPMap;
 
 int main(int argc, char** argv)
 {
+	// [0] setting - config file and command line arguments such as "config=bunny.cfg interactive=0 block_size=0.02"
+	Config::global().parse(argc, argv);
+
 	// [0] setting - GPMap constants
 	// CELL_SIZE = 0.001
 	//const double	BLOCK_SIZE	= 0.003;		const size_t	NUM_CELLS_PER_AXIS	= 3;		// NUM_CELLS_PER_BLOCK = 3*3*3 = 27						BCM/iBCM (too small BLOCK_SIZE to produce non-smooth signed distance function)
@@ -61,9 +65,7 @@ int main(int argc, char** argv)
 
 	// [0] setting - input data folder
 	std::cout << "[Input Data]" << std::endl;
-	int fOctreeDownSampling;
-	std::cout << "No sampling(-1), Random sampling(0) or octree-based down sampling(1)?";
-	std::cin >> fOctreeDownSampling;
+	const int fOctreeDownSampling = ask<int>("sampling", "No sampling(-1), Random sampling(0) or octree-based down sampling(1)?", -1);
 
 	float param;
 	std::string strIntermediateDataFolder;
@@ -71,8 +73,7 @@ int main(int argc, char** argv)
 	if(fOctreeDownSampling > 0)
 	{
 		// leaf size
-		std::cout << "Down sampling leaf size: ";
-		std::cin >> param; // 0.001(50%), 0.002(20%), 0.003(10%)
+		param = ask<float>("down_sampling_leaf_size", "Down sampling leaf size: ", 0.001f); // 0.001(50%), 0.002(20%), 0.003(10%)
 
 		// sub folder
 		std::stringstream ss;
@@ -88,8 +89,7 @@ int main(int argc, char** argv)
 	else
 	{
 		// sampling ratio
-		std::cout << "Random sampling ratio: ";
-		std::cin >> param;	// 0.5, 0.3, 0.2, 0.1
+		param = ask<float>("random_sampling_ratio", "Random sampling ratio: ", 0.5f);	// 0.5, 0.3, 0.2, 0.1
 
 		// sub folder
 		std::stringstream ss;
@@ -105,16 +105,15 @@ int main(int argc, char** argv)
 
 
 	// [1] Function Observations
-	bool fRunFuncObs = true;
-	std::cout << "[Function Observations] - Do you wish to run? (0/1)"; std::cin >> fRunFuncObs;
+	const bool fRunFuncObs = ask<bool>("run_func_obs", "[Function Observations] - Do you wish to run? (0/1)", true);
 	if(fRunFuncObs)
 	{
 		//const double	BLOCK_SIZE = 0.02;
 		//const size_t	NUM_CELLS_PER_AXIS = 10;
 		//const size_t	MAX_NUM_POINTS_TO_PREDICT = 200;
-		double			BLOCK_SIZE;						std::cout << "Block Size? ";															std::cin >> BLOCK_SIZE;
-		size_t			NUM_CELLS_PER_AXIS;			std::cout << "Number of cells per axis? ";										std::cin >> NUM_CELLS_PER_AXIS;
-		size_t			MAX_NUM_POINTS_TO_PREDICT;	std::cout << "Max Number of points for Gaussian process prediction? ";	std::cin >> MAX_NUM_POINTS_TO_PREDICT;
+		const double	BLOCK_SIZE						= ask<double>("block_size",						"Block Size? ",															0.02);
+		const size_t	NUM_CELLS_PER_AXIS			= ask<size_t>("num_cells_per_axis",				"Number of cells per axis? ",										10);
+		const size_t	MAX_NUM_POINTS_TO_PREDICT	= ask<size_t>("max_num_points_to_predict",	"Max Number of points for Gaussian process prediction? ",	200);
 		std::stringstream ss;
 		ss << "block_" << BLOCK_SIZE 
 			<< "_cell_" << static_cast<float>(BLOCK_SIZE)/static_cast<float>(NUM_CELLS_PER_AXIS)
@@ -175,8 +174,7 @@ int main(int argc, char** argv)
 	}
 
 	// [2] Derivative Observations
-	bool fRunDerObs = true;
-	std::cout << "[Derivative Observations] - Do you wish to run? (0/1)"; std::cin >> fRunDerObs;
+	const bool fRunDerObs = ask<bool>("run_der_obs", "[Derivative Observations] - Do you wish to run? (0/1)", true);
 	if(fRunDerObs)
 	{
 		strIntermediateDataFolder += "search_radius_0.01/";
@@ -184,9 +182,9 @@ int main(int argc, char** argv)
 		//const double	BLOCK_SIZE = 0.02;
 		//const size_t	NUM_CELLS_PER_AXIS = 10;
 		//const size_t	MAX_NUM_POINTS_TO_PREDICT = 200;
-		double			BLOCK_SIZE;						std::cout << "Block Size? ";															std::cin >> BLOCK_SIZE;
-		size_t			NUM_CELLS_PER_AXIS;			std::cout << "Number of cells per axis? ";										std::cin >> NUM_CELLS_PER_AXIS;
-		size_t			MAX_NUM_POINTS_TO_PREDICT;	std::cout << "Max Number of points for Gaussian process prediction? ";	std::cin >> MAX_NUM_POINTS_TO_PREDICT;
+		const double	BLOCK_SIZE						= ask<double>("block_size",						"Block Size? ",															0.02);
+		const size_t	NUM_CELLS_PER_AXIS			= ask<size_t>("num_cells_per_axis",				"Number of cells per axis? ",										10);
+		const size_t	MAX_NUM_POINTS_TO_PREDICT	= ask<size_t>("max_num_points_to_predict",	"Max Number of points for Gaussian process prediction? ",	200);
 		std::stringstream ss;
 		ss << "block_" << BLOCK_SIZE 
 			<< "_cell_" << static_cast<float>(BLOCK_SIZE)/static_cast<float>(NUM_CELLS_PER_AXIS)
@@ -0,0 +1,112 @@
+#if 1
+// Eigen
+#include "serialization/eigen_serialization.hpp" // Eigen
+// includes followings inside of it
+//		- #define EIGEN_NO_DEBUG		// to speed up
+//		- #define EIGEN_USE_MKL_ALL	// to use Intel Math Kernel Library
+//		- #include <Eigen/Core>
+
+// Parameter sweep of GPMaps with the same all-in-one observations
+// ---------------------------------------------------------------------------------------------
+// The observations are loaded once and every combination of the settings is built from them.
+// The octree is built once per block size, number of cells and BCM mode,
+// and the min/max numbers of points and the random sampling are swept on it.
+// All settings come from a config file and/or command line arguments, for example
+//
+//		main_bunny_gpmap_sweep config=sweep.cfg
+//
+// with sweep.cfg
+//
+//		interactive						= 0
+//		obs_file							= ../../data/bunny/intermediate/original/bunny_all_func_obs.pcd
+//		output_folder					= ../../data/bunny/output/gpmap/sweep/
+//		block_size						= 0.01, 0.02
+//		num_cells_per_axis			= 10
+//		min_num_points_to_predict	= 2
+//		max_num_points_to_predict	= 100, 200
+//		bcm_mode							= iBCM, BCM
+//		random_sampling				= 0, 1
+//		hyp_cov(0)						= 0.0539592
+//
+// Any key can be overridden on the command line such as "block_size=0.05".
+
+// STL
+#include <string>
+#include <vector>
+
+// GPMap
+#include "io/io.hpp"								// loadPointCloud
+#include "util/filesystem.hpp"					// create_directory
+#include "util/config.hpp"						// Config, ask
+#include "octree/macro_gpmap.hpp"			// sweep_gpmaps_with_all_in_one_observations
+using namespace GPMap;
+
+int main(int argc, char** argv)
+{
+	// [0] setting - config file and command line arguments
+	Config &config = Config::global();
+	config.parse(argc, argv);
+
+	// [0] setting - sweep lists with defaults
+	std::vector<double>			blockSizeList(1, 0.02);
+	std::vector<size_t>			numCellsPerAxisList(1, 10);
+	std::vector<size_t>			minNumPointsToPredictList(1, 2);
+	std::vector<size_t>			maxNumPointsToPredictList(1, 200);
+	std::vector<std::string>	bcmModeList(1, "iBCM");
+	std::vector<int>				randomSamplingList(1, 0);
+	config.getList("block_size",						blockSizeList);
+	config.getList("num_cells_per_axis",			numCellsPerAxisList);
+	config.getList("min_num_points_to_predict",	minNumPointsToPredictList);
+	config.getList("max_num_points_to_predict",	maxNumPointsToPredictList);
+	config.getList("bcm_mode",							bcmModeList);
+	config.getList("random_sampling",				randomSamplingList);
+
+	// [0] setting - observations and outputs
+	const std::string	strObsFilePath			= ask<std::string>("obs_file",			"Observation file path? ",	"../../data/bunny/intermediate/original/bunny_all_func_obs.pcd");
+	const std::string	strOutputFolder		= ask<std::string>("output_folder",		"Output folder? ",			"../../data/bunny/output/gpmap/sweep/");
+	const std::string	strOutputFileName		= ask<std::string>("output_file_name",	"Output file name? ",		"sweep");
+	const float			GAP						= ask<float>("gap",							"Gap? ",							0.001f);
+	const int			MAX_ITER_BEFORE_UPDATE	= ask<int>("max_iter_before_update",	"Max iterations before update? ",	0);
+	const std::string	strLogFolder			(strOutputFolder + "log/");
+	create_directory(strOutputFolder);
+	create_directory(strLogFolder);
+
+	// [0] setting - hyperparameters
+	// NO_RANDOM_SAMPLING, BLOCK_SIZE = 0.15, MAX_NUM_POINTS_TO_PREDICT = 200
+	typedef	GP::InfExactDerObs<float, GP::MeanZeroDerObs, GP::CovMaternisoDerObs, GP::LikGaussDerObs>::Hyp Hyp;
+	Hyp logHyp;
+	logHyp.cov(0) = log(0.0539592f);		// sparse_ell
+	logHyp.cov(1) = log(0.0326716f);		// matern_ell
+	logHyp.cov(2) = log(0.308823f);		// sigma_f2
+	logHyp.lik(0) = log(0.00493079f);	// sigma_n
+	logHyp.lik(1) = log(0.977637f);		// sigma_nd
+	for(int i = 0; i < logHyp.cov.size(); i++)	if(config.has(hypKey("hyp_cov", i)))	logHyp.cov(i) = log(ask<float>(hypKey("hyp_cov", i), "", exp(logHyp.cov(i))));
+	for(int i = 0; i < logHyp.lik.size(); i++)	if(config.has(hypKey("hyp_lik", i)))	logHyp.lik(i) = log(ask<float>(hypKey("hyp_lik", i), "", exp(logHyp.lik(i))));
+
+	// [1] load the observations once
+	LogFile logFile(strLogFolder + strOutputFileName + ".log");
+	PointNormalCloudPtr pAllInOneObs(new PointNormalCloud());
+	logFile << "Loading " << strObsFilePath << " ... " << loadPointCloud<pcl::PointNormal>(pAllInOneObs, strObsFilePath) << " points." << std::endl;
+
+	// [2] sweep
+	const size_t numRuns = sweep_gpmaps_with_all_in_one_observations<GP::MeanZeroDerObs,
+																							 GP::CovMaternisoDerObs,
+																							 GP::LikGaussDerObs,
+																							 GP::InfExactDerObs>(blockSizeList,						// block sizes
+																														numCellsPerAxisList,				// numbers of cells per each axis
+																														minNumPointsToPredictList,		// min numbers of points to predict
+																														maxNumPointsToPredictList,		// max numbers of points to predict
+																														bcmModeList,						// iBCM/BCM
+																														randomSamplingList,				// random sampling
+																														logHyp,								// hyperparameters
+																														pAllInOneObs,						// observations
+																														GAP,									// gap
+																														MAX_ITER_BEFORE_UPDATE,			// number of iterations for training before update
+																														strOutputFolder,					// output data folder
+																														strOutputFileName,				// output file name prefix
+																														strLogFolder);						// log folder
+	std::cout << "Sweep: " << numRuns << " runs" << std::endl;
+
+	return 0;
+}
+#endif
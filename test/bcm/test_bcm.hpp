@@ -4,6 +4,10 @@
 // Google Test
 #include "gtest/gtest.h"
 
+// STL
+#include <vector>
+#include <sstream>		// std::stringstream
+
 // GPMap
 #include "bcm/bcm.hpp"
 using namespace GPMap;
@@ -184,4 +188,127 @@ TEST_F(TestBCM, VarTest)
 	EXPECT_TRUE(pMean->isApprox(*pMeanByVarFinal));
 }
 
+TEST(BCM, CholeskyRetries)
+{
+	// singular covariance matrix
+	MatrixPtr pCov(new Matrix(2, 2));
+	(*pCov) << 1.f, 1.f,
+				  1.f, 1.f;
+	VectorPtr pMean(new Vector(2));
+	pMean->setZero();
+
+	// the jittered refactorizations are counted
+	BCM::resetCholeskyRetries();
+	BCM bcm;
+	bcm.update(pMean, pCov);
+	EXPECT_GT(BCM::numCholeskyRetries(), 0);
+
+	// no retry for a positive definite matrix
+	BCM::resetCholeskyRetries();
+	BCM bcm2;
+	bcm2.update(pMean, MatrixConstPtr(new Matrix(Matrix::Identity(2, 2))));
+	EXPECT_EQ(0, BCM::numCholeskyRetries());
+}
+
+TEST(BCM, MemoryUsage)
+{
+	// only the object itself before the first update
+	BCM bcm;
+	EXPECT_EQ(sizeof(BCM), bcm.memoryUsage());
+
+	// mean vector and covariance matrix
+	VectorPtr pMean(new Vector(3));
+	pMean->setZero();
+	bcm.update(pMean, MatrixConstPtr(new Matrix(Matrix::Identity(3, 3))));
+	EXPECT_EQ(sizeof(BCM) + sizeof(Vector) + sizeof(Matrix) + 12*sizeof(float), bcm.memoryUsage());
+}
+
+TEST(BCM, BinaryState)
+{
+	// state
+	VectorPtr pMean(new Vector(3));
+	(*pMean) << 1.f, 2.f, 3.f;
+	MatrixPtr pCov(new Matrix(3, 3));
+	(*pCov) << 2.f, 0.5f, 0.f,
+				  0.5f, 2.f, 0.f,
+				  0.f, 0.f, 1.f;
+	BCM bcm;
+	bcm.update(pMean, pCov);
+
+	// write
+	std::stringstream ss;
+	BCM empty;
+	EXPECT_TRUE(empty.writeState(ss));
+	EXPECT_TRUE(bcm.writeState(ss));
+
+	// read
+	BCM empty2, bcm2;
+	EXPECT_TRUE(empty2.readState(ss));
+	EXPECT_TRUE(bcm2.readState(ss));
+	EXPECT_FALSE(empty2.isInitialized());
+	EXPECT_TRUE(bcm2 == bcm);
+
+	// truncated
+	std::stringstream truncated(ss.str().substr(1, 10));	// without the empty state
+	BCM bcm3;
+	EXPECT_FALSE(bcm3.readState(truncated));
+}
+
+TEST(BCM, Merge)
+{
+	// experts
+	const int NUM_EXPERTS = 4;
+	std::vector<VectorPtr> means;
+	std::vector<MatrixPtr> covs;
+	for(int i = 0; i < NUM_EXPERTS; i++)
+	{
+		VectorPtr pMean(new Vector(2));
+		(*pMean) << static_cast<float>(i), static_cast<float>(-i);
+		MatrixPtr pCov(new Matrix(2, 2));
+		(*pCov) << 1.f + i, 0.1f,
+					  0.1f, 2.f + i;
+		means.push_back(pMean);
+		covs.push_back(pCov);
+	}
+
+	// with and without the prior
+	for(int fPrior = 0; fPrior <= 1; fPrior++)
+	{
+		if(fPrior) BCM::setPrior(MatrixConstPtr(new Matrix(Matrix::Identity(2, 2) * 5.f)));
+
+		// all in one
+		BCM all;
+		for(int i = 0; i < NUM_EXPERTS; i++) all.update(means[i], covs[i]);
+
+		// disjoint subsets
+		BCM a, b, c;
+		a.update(means[0], covs[0]);
+		b.update(means[1], covs[1]);
+		b.update(means[2], covs[2]);
+		c.update(means[3], covs[3]);
+
+		// (a + b) + c
+		BCM ab_c;
+		ab_c.merge(a);
+		ab_c.merge(b);
+		ab_c.merge(c);
+		EXPECT_TRUE(ab_c == all);
+
+		// a + (b + c)
+		BCM bc, a_bc;
+		bc.merge(b);
+		bc.merge(c);
+		a_bc.merge(a);
+		a_bc.merge(bc);
+		EXPECT_TRUE(a_bc == all);
+
+		// empty
+		BCM empty;
+		a_bc.merge(empty);
+		EXPECT_TRUE(a_bc == all);
+
+		if(fPrior) BCM::resetPrior();
+	}
+}
+
 #endif
\ No newline at end of file
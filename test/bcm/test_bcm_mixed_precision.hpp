@@ -0,0 +1,78 @@
+#ifndef _TEST_BCM_MIXED_PRECISION_HPP_
+#define _TEST_BCM_MIXED_PRECISION_HPP_
+
+// Google Test
+#include "gtest/gtest.h"
+
+// GPMap
+#include "bcm/bcm_mixed_precision.hpp"
+using namespace GPMap;
+
+#include "bcm/test_bcm.hpp"
+
+class TestBCMMixedPrecision : public ::testing::Test,
+										public TestBCMData,
+										public BCM_MixedPrecision
+{
+};
+
+/** @brief Update by mean vectors and covariance matrices */
+TEST_F(TestBCMMixedPrecision, CovTest)
+{
+	// pointer should be NULL initially
+	EXPECT_FALSE(m_pSumOfWeightedMeans);
+	EXPECT_FALSE(m_pSumOfInvCovs);
+
+	// prediction 1
+	update(pMean1, pCov1);
+	EXPECT_TRUE(m_pSumOfInvCovs->cast<float>().isApprox(*pSumOfInvCovs1));
+	EXPECT_TRUE(m_pSumOfWeightedMeans->cast<float>().isApprox(*pSumOfWeightedMeansByCov1));
+
+	// prediction 2
+	update(pMean2, pCov2);
+	EXPECT_TRUE(m_pSumOfInvCovs->cast<float>().isApprox(*pSumOfInvCovs2));
+	EXPECT_TRUE(m_pSumOfWeightedMeans->cast<float>().isApprox(*pSumOfWeightedMeansByCov2));
+
+	// prediction 3
+	update(pMean3, pCov3);
+	EXPECT_TRUE(m_pSumOfInvCovs->cast<float>().isApprox(*pSumOfInvCovs3));
+	EXPECT_TRUE(m_pSumOfWeightedMeans->cast<float>().isApprox(*pSumOfWeightedMeansByCov3));
+
+	// final
+	VectorPtr pMean;
+	MatrixPtr pCov;
+	get(pMean, pCov);
+	EXPECT_TRUE(pCov->isApprox(pCovFinal->diagonal())); // get a variance!!!
+	EXPECT_TRUE(pMean->isApprox(*pMeanByCovFinal));
+}
+
+/** @brief Update by mean vectors and variance vectors */
+TEST_F(TestBCMMixedPrecision, VarTest)
+{
+	// prediction 1, 2, 3
+	update(pMean1, pVar1);
+	update(pMean2, pVar2);
+	update(pMean3, pVar3);
+	EXPECT_TRUE(m_pSumOfInvCovs->cast<float>().isApprox(*pSumOfInvVar3));
+	EXPECT_TRUE(m_pSumOfWeightedMeans->cast<float>().isApprox(*pSumOfWeightedMeansByVar3));
+
+	// final
+	VectorPtr pMean;
+	MatrixPtr pCov;
+	get(pMean, pCov);
+	EXPECT_TRUE(pCov->isApprox(*pVarFinal));
+	EXPECT_TRUE(pMean->isApprox(*pMeanByVarFinal));
+}
+
+/** @brief A singular covariance matrix is regularized with a single retry */
+TEST_F(TestBCMMixedPrecision, SingularTest)
+{
+	// rank-deficient covariance matrix
+	MatrixPtr pSingularCov(new Matrix(pMean1->size(), pMean1->size()));
+	pSingularCov->setOnes();
+	update(pMean1, pSingularCov);
+	EXPECT_TRUE(isInitialized());
+	EXPECT_TRUE(m_pSumOfInvCovs->allFinite());
+}
+
+#endif
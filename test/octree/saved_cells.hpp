@@ -0,0 +1,82 @@
+#ifndef _TEST_SAVED_CELLS_HPP_
+#define _TEST_SAVED_CELLS_HPP_
+
+// STL
+#include <string>
+#include <algorithm>		// std::sort, std::max
+#include <cmath>			// floor, fabs
+#include <cstdio>			// std::remove
+
+// Google Test
+#include "gtest/gtest.h"
+
+// PCL
+#include <pcl/point_types.h>		// pcl::PointNormal
+#include <pcl/point_cloud.h>		// pcl::PointCloud
+#include <pcl/io/pcd_io.h>			// pcl::io::loadPCDFile
+
+/** @brief Order of the cells of saved maps by their indices, robust to rounding of the positions */
+class CellIndexLess
+{
+public:
+	CellIndexLess(const float cellSize) : m_cellSize(cellSize) {}
+
+	bool operator()(const pcl::PointNormal &a, const pcl::PointNormal &b) const
+	{
+		const long ax = index(a.x), bx = index(b.x);
+		if(ax != bx) return ax < bx;
+		const long ay = index(a.y), by = index(b.y);
+		if(ay != by) return ay < by;
+		return index(a.z) < index(b.z);
+	}
+
+protected:
+	long index(const float value) const
+	{
+		return static_cast<long>(floor(value / m_cellSize));
+	}
+
+	float m_cellSize;
+};
+
+/** @brief		Append the cells of a map saved by OctreeGPMap::saveAsPointCloud()
+  * @details	The file is removed after loading.
+  */
+inline void loadSavedCells(const std::string &strFilePath, pcl::PointCloud<pcl::PointNormal> &cells)
+{
+	pcl::PointCloud<pcl::PointNormal> part;
+	ASSERT_EQ(0, pcl::io::loadPCDFile<pcl::PointNormal>(strFilePath, part));
+	cells.points.insert(cells.points.end(), part.points.begin(), part.points.end());
+	cells.width		= static_cast<uint32_t>(cells.points.size());
+	cells.height	= 1;
+	std::remove(strFilePath.c_str());
+}
+
+/** @brief		Check that two maps have the same cells with the same means and variances
+  * @details	The positions, means (normal_x) and variances (normal_y) are compared cell by cell in the order of their indices.
+  */
+inline void expectSameCells(pcl::PointCloud<pcl::PointNormal>	&expectedCells,
+									 pcl::PointCloud<pcl::PointNormal>	&cells,
+									 const float								cellSize,
+									 const float								tolerance)
+{
+	// same cells
+	ASSERT_GT(expectedCells.points.size(), static_cast<size_t>(0));
+	ASSERT_EQ(expectedCells.points.size(), cells.points.size());
+	std::sort(expectedCells.points.begin(),	expectedCells.points.end(),	CellIndexLess(cellSize));
+	std::sort(cells.points.begin(),				cells.points.end(),				CellIndexLess(cellSize));
+
+	// same means and variances
+	for(size_t i = 0; i < cells.points.size(); i++)
+	{
+		const pcl::PointNormal &cell		= cells.points[i];
+		const pcl::PointNormal &expected	= expectedCells.points[i];
+		ASSERT_NEAR(expected.x, cell.x, cellSize / 10.f);
+		ASSERT_NEAR(expected.y, cell.y, cellSize / 10.f);
+		ASSERT_NEAR(expected.z, cell.z, cellSize / 10.f);
+		EXPECT_NEAR(expected.normal_x, cell.normal_x, tolerance * std::max<float>(1.f, fabs(expected.normal_x)));	// mean
+		EXPECT_NEAR(expected.normal_y, cell.normal_y, tolerance * std::max<float>(1.f, fabs(expected.normal_y)));	// variance
+	}
+}
+
+#endif
@@ -129,4 +129,52 @@ TEST(Octree, RandomSampling)
 
 }
 
+TEST(Octree, PartitionBuffer)
+{
+	// indices
+	const int N = 30;
+	std::vector<int> indices(N);
+	std::generate(indices.begin(), indices.end(), UniqueNonZeroInteger());
+
+	// no partitioning is needed
+	PartitionBuffer partitionBuffer;
+	RandomGenerator rng(1);
+	EXPECT_FALSE(partitionBuffer.partition(indices.begin(), indices.end(), 0, rng));
+	EXPECT_FALSE(partitionBuffer.partition(indices.begin(), indices.end(), N, rng));
+	EXPECT_EQ(0, partitionBuffer.size());
+
+	// without suffling, partitions are consecutive ranges
+	const int M = 8;
+	EXPECT_TRUE(partitionBuffer.partition(indices.begin(), indices.end(), M, rng, false));
+	EXPECT_EQ(4, partitionBuffer.size());
+	for(size_t i = 0; i < partitionBuffer.size(); i++)
+	{
+		EXPECT_EQ(i < 3 ? M : N - 3*M, std::distance(partitionBuffer.begin(i), partitionBuffer.end(i)));
+		EXPECT_EQ(static_cast<int>(i)*M, *partitionBuffer.begin(i));
+	}
+
+	// with suffling, partitions cover all indices exactly once
+	EXPECT_TRUE(partitionBuffer.partition(indices.begin(), indices.end(), M, rng));
+	std::vector<int> merged;
+	for(size_t i = 0; i < partitionBuffer.size(); i++)
+		merged.insert(merged.end(), partitionBuffer.begin(i), partitionBuffer.end(i));
+	std::sort(merged.begin(), merged.end());
+	EXPECT_TRUE(merged == indices);
+
+	// the same seed gives the same partitions
+	RandomGenerator rng1(7), rng2(7);
+	PartitionBuffer partitionBuffer2;
+	partitionBuffer.partition(indices.begin(), indices.end(), M, rng1);
+	partitionBuffer2.partition(indices.begin(), indices.end(), M, rng2);
+	EXPECT_TRUE(std::equal(partitionBuffer.begin(0), partitionBuffer.end(0), partitionBuffer2.begin(0)));
+
+	// sampling
+	EXPECT_TRUE(partitionBuffer.sample(indices.begin(), indices.end(), M, rng));
+	EXPECT_EQ(1, partitionBuffer.size());
+	std::vector<int> samples(partitionBuffer.begin(0), partitionBuffer.end(0));
+	EXPECT_EQ(M, samples.size());
+	std::sort(samples.begin(), samples.end());
+	EXPECT_TRUE(std::unique(samples.begin(), samples.end()) == samples.end());
+}
+
 #endif
\ No newline at end of file
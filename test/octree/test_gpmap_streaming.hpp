@@ -0,0 +1,83 @@
+#ifndef _TEST_GPMAP_STREAMING_HPP_
+#define _TEST_GPMAP_STREAMING_HPP_
+
+// STL
+#include <string>
+#include <sstream>		// std::stringstream
+#include <limits>			// std::numeric_limits
+#include <cstdio>			// std::remove
+
+// Google Test
+#include "gtest/gtest.h"
+
+// PCL
+#include <pcl/io/pcd_io.h>			// pcl::io::savePCDFileBinary
+
+// GPMap
+#include "util/temp_file.hpp"				// tempFilePath
+#include "octree/saved_cells.hpp"			// loadSavedCells, expectSameCells
+#include "octree/macro_gpmap.hpp"			// gpmap_streaming
+#include "bcm/bcm.hpp"							// BCM
+using namespace GPMap;
+
+/** @brief Stream an observation file and load the cells of all the saved parts */
+template <typename Hyp>
+size_t streamAndLoadCells(const std::string						&strObsFilePath,
+								  const Hyp									&logHyp,
+								  const size_t								MAX_NUM_POINTS_IN_BAND,
+								  pcl::PointCloud<pcl::PointNormal>	&cells)
+{
+	const std::string strFilePathWithoutExtension(tempFilePath("gpmap_streaming_test", ""));
+	const size_t numParts = gpmap_streaming<BCM, GP::MeanZeroDerObs, GP::CovMaternisoDerObs, GP::LikGaussDerObs, GP::InfExactDerObs>
+		(0.01, 5, 1, std::numeric_limits<int>::max(), true, 0, logHyp, strObsFilePath, 0.001f, 0, MAX_NUM_POINTS_IN_BAND, strFilePathWithoutExtension);
+	for(size_t i = 0; i < numParts; i++)
+	{
+		std::stringstream ss;
+		ss << strFilePathWithoutExtension << "_part_" << i << ".pcd";
+		loadSavedCells(ss.str(), cells);
+	}
+	return numParts;
+}
+
+/** @brief A streamed build is the same as a build with the whole observations */
+TEST(GPMapStreaming, SameAsWholeCloud)
+{
+	typedef GP::InfExactDerObs<float, GP::MeanZeroDerObs, GP::CovMaternisoDerObs, GP::LikGaussDerObs>::Hyp Hyp;
+
+	// hyperparameters
+	Hyp logHyp;
+	logHyp.cov(0) = log(0.0539592f);
+	logHyp.cov(1) = log(0.0326716f);
+	logHyp.cov(2) = log(0.308823f);
+	logHyp.lik(0) = log(0.00493079f);
+	logHyp.lik(1) = log(0.977637f);
+
+	// a small planar scan over several slabs, which does not start on a block boundary
+	// function observations: normals are ray back vectors and curvatures are -1
+	pcl::PointCloud<pcl::PointNormal> cloud;
+	for(float x = 0.0037f; x <= 0.089f; x += 0.002f)
+		for(float y = 0.004f; y <= 0.036f; y += 0.002f)
+		{
+			pcl::PointNormal pointNormal;
+			pointNormal.x = x;		pointNormal.y = y;		pointNormal.z = 0.013f + 0.1f*x;
+			pointNormal.normal_x = 0.f;	pointNormal.normal_y = 0.f;	pointNormal.normal_z = 1.f;
+			pointNormal.curvature = -1.f;
+			cloud.push_back(pointNormal);
+		}
+	const std::string strObsFilePath(tempFilePath("gpmap_streaming_test_obs", ".pcd"));
+	ASSERT_EQ(0, pcl::io::savePCDFileBinary(strObsFilePath, cloud));
+
+	// the whole observations in one band
+	pcl::PointCloud<pcl::PointNormal> expectedCells;
+	EXPECT_EQ(static_cast<size_t>(1), streamAndLoadCells(strObsFilePath, logHyp, std::numeric_limits<size_t>::max(), expectedCells));
+
+	// streamed in bands of a few slabs
+	pcl::PointCloud<pcl::PointNormal> streamedCells;
+	EXPECT_GT(streamAndLoadCells(strObsFilePath, logHyp, cloud.points.size() / 3, streamedCells), static_cast<size_t>(1));
+	std::remove(strObsFilePath.c_str());
+
+	// same cells with the same means and variances
+	expectSameCells(expectedCells, streamedCells, 0.01f / 5.f, 1e-3f);
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef _TEST_MINI_BATCH_TRAINING_HPP_
+#define _TEST_MINI_BATCH_TRAINING_HPP_
+
+// Google Test
+#include "gtest/gtest.h"
+
+// GPMap
+#include "octree/mini_batch_training.hpp"
+using namespace GPMap;
+
+TEST(Octree, MiniBatchSchedule)
+{
+	// initial: 10, max: 50, growth rate: 2, growth interval: 2
+	MiniBatchSchedule schedule(10, 50, 2.f, 2, 5, 20);
+	EXPECT_EQ(5, schedule.maxIterPerStep());
+	EXPECT_EQ(20, schedule.maxSteps());
+
+	// geometric growth
+	EXPECT_EQ(10, schedule.batchSize(0, 1000));
+	EXPECT_EQ(10, schedule.batchSize(1, 1000));
+	EXPECT_EQ(20, schedule.batchSize(2, 1000));
+	EXPECT_EQ(40, schedule.batchSize(4, 1000));
+
+	// max batch size
+	EXPECT_EQ(50, schedule.batchSize(6, 1000));
+	EXPECT_EQ(50, schedule.batchSize(100, 1000));
+
+	// total number of blocks
+	EXPECT_EQ(30, schedule.batchSize(100, 30));
+}
+
+TEST(Octree, ConvergenceMonitor)
+{
+	// relative tolerance: 1e-3, hyperparameter tolerance: 1e-2, patience: 2, no smoothing
+	ConvergenceMonitor monitor(1e-3, 1e-2, 2, 1.0);
+
+	// first step: no history
+	EXPECT_FALSE(monitor.update(100.0, 0.0));
+
+	// big change of the objective
+	EXPECT_FALSE(monitor.update(90.0, 0.0));
+
+	// small change of the objective, but big change of the hyperparameters
+	EXPECT_FALSE(monitor.update(90.0, 0.1));
+
+	// stable for two consecutive steps
+	EXPECT_FALSE(monitor.update(90.0, 0.0));
+	EXPECT_TRUE(monitor.update(90.0, 0.0));
+	EXPECT_EQ(5, monitor.numSteps());
+
+	// non-finite objective breaks the stable steps
+	EXPECT_FALSE(monitor.update(std::numeric_limits<double>::infinity(), 0.0));
+	EXPECT_FALSE(monitor.isConverged());
+
+	// reset
+	monitor.reset();
+	EXPECT_EQ(0, monitor.numSteps());
+	EXPECT_FALSE(monitor.isConverged());
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef _TEST_OCTREE_CONTAINER_HPP_
+#define _TEST_OCTREE_CONTAINER_HPP_
+
+// Google Test
+#include "gtest/gtest.h"
+
+// GPMap
+#include "octree/octree_container.hpp"
+#include "bcm/bcm.hpp"
+#include "bcm/bcm_mixed_precision.hpp"
+#include "bcm/bcm_serializable.hpp"
+using namespace GPMap;
+
+TEST(OctreeGPMapContainer, DataMemoryUsage)
+{
+	// uninitialized leaves have no heap data
+	OctreeGPMapContainer<BCM>						leafBCM;
+	OctreeGPMapContainer<BCM_MixedPrecision>	leafMixedPrecision;
+	OctreeGPMapContainer<BCM_Serializable>		leafSerializable;
+	EXPECT_EQ(0, leafBCM.dataMemoryUsage());
+	EXPECT_EQ(0, leafMixedPrecision.dataMemoryUsage());
+	EXPECT_EQ(0, leafSerializable.dataMemoryUsage());
+	EXPECT_EQ(sizeof(leafBCM),					leafBCM.memoryUsage());
+	EXPECT_EQ(sizeof(leafSerializable),		leafSerializable.memoryUsage());
+
+	// prediction
+	const int D = 8;
+	VectorPtr pMean(new Vector(D));
+	MatrixPtr pVar(new Matrix(D, 1));
+	pMean->setOnes();
+	pVar->setConstant(2.f);
+
+	// an updated leaf holds the sums
+	leafBCM.update(pMean, pVar);
+	EXPECT_EQ(sizeof(Vector) + sizeof(Matrix) + 2*D*sizeof(float), leafBCM.dataMemoryUsage());
+	EXPECT_EQ(sizeof(leafBCM) + leafBCM.dataMemoryUsage(), leafBCM.memoryUsage());
+
+	// a dumped leaf holds nothing on the heap
+	leafSerializable.update(pMean, pVar);
+	EXPECT_EQ(0, leafSerializable.dataMemoryUsage());
+	EXPECT_EQ(sizeof(leafSerializable), leafSerializable.memoryUsage());
+}
+
+TEST(OctreeGPMapContainer, ClearState)
+{
+	// prediction
+	const int D = 8;
+	VectorPtr pMean(new Vector(D));
+	MatrixPtr pVar(new Matrix(D, 1));
+	pMean->setOnes();
+	pVar->setConstant(2.f);
+
+	// the point indices are kept
+	OctreeGPMapContainer<BCM> leaf;
+	leaf.setData(3);
+	leaf.update(pMean, pVar);
+	ASSERT_TRUE(leaf.isInitialized());
+	leaf.clearState();
+	EXPECT_FALSE(leaf.isInitialized());
+	EXPECT_EQ(0, leaf.dataMemoryUsage());
+	EXPECT_EQ(1, leaf.getDataTVector().size());
+
+	// a dumped leaf
+	OctreeGPMapContainer<BCM_Serializable> leafSerializable;
+	leafSerializable.update(pMean, pVar);
+	leafSerializable.clearState();
+	EXPECT_FALSE(leafSerializable.isInitialized());
+	EXPECT_EQ(0, leafSerializable.dataMemoryUsage());
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef _TEST_OCTREE_GPMAP_MERGE_HPP_
+#define _TEST_OCTREE_GPMAP_MERGE_HPP_
+
+// STL
+#include <string>
+#include <vector>
+#include <limits>			// std::numeric_limits
+
+// Boost
+#include <boost/shared_ptr.hpp>		// boost::shared_ptr
+
+// Google Test
+#include "gtest/gtest.h"
+
+// GPMap
+#include "util/data_types.hpp"				// PointNormalCloudPtrList
+#include "util/timer.hpp"						// CPU_Times
+#include "util/temp_file.hpp"				// tempFilePath
+#include "octree/saved_cells.hpp"			// loadSavedCells, expectSameCells
+#include "common/common.hpp"					// getMinMaxPointXYZ
+#include "octree/octree_gpmap.hpp"			// OctreeGPMap
+#include "octree/octree_container.hpp"		// OctreeGPMapContainer
+#include "bcm/bcm.hpp"							// BCM
+using namespace GPMap;
+
+/** @brief Save the cells of a map to a temporary file and load them back */
+template <typename OctreeGPMapT>
+void saveAndLoadCells(OctreeGPMapT &gpmap, pcl::PointCloud<pcl::PointNormal> &cells)
+{
+	const std::string strFilePathWithoutExtension(tempFilePath("octree_gpmap_merge_test", ""));
+	gpmap.saveAsPointCloud(strFilePathWithoutExtension);
+	loadSavedCells(strFilePathWithoutExtension + ".pcd", cells);
+}
+
+/** @brief Merged maps from different subsets of observations are the same as one map updated with all of them */
+TEST(OctreeGPMap, MergeMapsBuiltFromDifferentSubsets)
+{
+	typedef GP::InfExactDerObs<float, GP::MeanZeroDerObs, GP::CovMaternisoDerObs, GP::LikGaussDerObs>::Hyp Hyp;
+	typedef OctreeGPMap<GP::MeanZeroDerObs, GP::CovMaternisoDerObs, GP::LikGaussDerObs, GP::InfExactDerObs,
+							  OctreeGPMapContainer<BCM> > OctreeGPMapT;
+
+	// settings
+	const double	BLOCK_SIZE(0.01);
+	const size_t	NUM_CELLS_PER_AXIS(5);
+	const size_t	MIN_NUM_POINTS_TO_PREDICT(1);
+	const size_t	MAX_NUM_POINTS_TO_PREDICT(std::numeric_limits<int>::max());
+	const bool		INDEPENDENT_BCM(true);
+	const float		gap(0.001f);
+	const float		CELL_SIZE(static_cast<float>(BLOCK_SIZE) / static_cast<float>(NUM_CELLS_PER_AXIS));
+
+	// hyperparameters
+	Hyp logHyp;
+	logHyp.cov(0) = log(0.0539592f);
+	logHyp.cov(1) = log(0.0326716f);
+	logHyp.cov(2) = log(0.308823f);
+	logHyp.lik(0) = log(0.00493079f);
+	logHyp.lik(1) = log(0.977637f);
+
+	// three overlapping planar scans with different extents
+	// function observations: normals are ray back vectors and curvatures are -1
+	const size_t NUM_SCANS = 3;
+	const float minX[] = {0.003f, 0.031f, 0.017f};
+	const float maxX[] = {0.047f, 0.089f, 0.063f};
+	PointNormalCloudPtrList pPointNormalCloudList(NUM_SCANS);
+	for(size_t i = 0; i < NUM_SCANS; i++)
+	{
+		pPointNormalCloudList[i].reset(new pcl::PointCloud<pcl::PointNormal>());
+		for(float x = minX[i]; x <= maxX[i]; x += 0.002f)
+			for(float y = 0.004f; y <= 0.036f; y += 0.002f)
+			{
+				pcl::PointNormal pointNormal;
+				pointNormal.x = x;		pointNormal.y = y;		pointNormal.z = 0.013f + 0.1f*x + 0.001f*static_cast<float>(i);
+				pointNormal.normal_x = 0.f;	pointNormal.normal_y = 0.f;	pointNormal.normal_z = 1.f;
+				pointNormal.curvature = -1.f;
+				pPointNormalCloudList[i]->push_back(pointNormal);
+			}
+	}
+
+	// one partial map for each scan, defined by its own bounding box
+	CPU_Times t_training, t_predict, t_combine;
+	std::vector<boost::shared_ptr<OctreeGPMapT> > gpmaps(NUM_SCANS);
+	for(size_t i = 0; i < NUM_SCANS; i++)
+	{
+		gpmaps[i].reset(new OctreeGPMapT(BLOCK_SIZE, NUM_CELLS_PER_AXIS, MIN_NUM_POINTS_TO_PREDICT, MAX_NUM_POINTS_TO_PREDICT, INDEPENDENT_BCM));
+		pcl::PointXYZ min_pt, max_pt;
+		getMinMaxPointXYZ<pcl::PointNormal>(*pPointNormalCloudList[i], min_pt, max_pt);
+		gpmaps[i]->defineBoundingBox(min_pt, max_pt);
+		gpmaps[i]->setInputCloud(pPointNormalCloudList[i], gap);
+		gpmaps[i]->addPointsFromInputCloud();
+		gpmaps[i]->update(logHyp, 0, t_training, t_predict, t_combine);
+	}
+
+	// one map updated with all the scans
+	OctreeGPMapT gpmap(BLOCK_SIZE, NUM_CELLS_PER_AXIS, MIN_NUM_POINTS_TO_PREDICT, MAX_NUM_POINTS_TO_PREDICT, INDEPENDENT_BCM);
+	pcl::PointXYZ min_pt, max_pt;
+	getMinMaxPointXYZ<pcl::PointNormal>(pPointNormalCloudList, min_pt, max_pt);
+	gpmap.defineBoundingBox(min_pt, max_pt);
+	for(size_t i = 0; i < NUM_SCANS; i++)
+	{
+		gpmap.setInputCloud(pPointNormalCloudList[i], gap);
+		gpmap.addPointsFromInputCloud();
+		gpmap.update(logHyp, 0, t_training, t_predict, t_combine);
+	}
+
+	// merge more than two maps, so that a prior counted more than once would show up
+	ASSERT_TRUE(gpmaps[0]->merge(*gpmaps[1], logHyp));
+	ASSERT_TRUE(gpmaps[0]->merge(*gpmaps[2], logHyp));
+
+	// same cells with the same means and variances
+	pcl::PointCloud<pcl::PointNormal> mergedCells, expectedCells;
+	saveAndLoadCells(*gpmaps[0], mergedCells);
+	saveAndLoadCells(gpmap, expectedCells);
+	expectSameCells(expectedCells, mergedCells, CELL_SIZE, 1e-3f);
+}
+
+#endif
@@ -5,8 +5,19 @@
 #include "data/test_test_data.hpp"
 #include "bcm/test_bcm.hpp"
 #include "bcm/test_bcm_serializable.hpp"
+#include "bcm/test_bcm_mixed_precision.hpp"
 #include "plsc/test_plsc.hpp"
 #include "octree/test_data_partitioning.hpp"
+#include "octree/test_mini_batch_training.hpp"
+#include "octree/test_octree_container.hpp"
+#include "octree/test_octree_gpmap_merge.hpp"
+#include "octree/test_gpmap_streaming.hpp"
+#include "util/test_random.hpp"
+#include "util/test_bounded_queue.hpp"
+#include "util/test_trace.hpp"
+#include "util/test_async_logger.hpp"
+#include "util/test_arena.hpp"
+#include "util/test_config.hpp"
 
 //#include "octree/test_octree_gpmap.hpp"
 
@@ -0,0 +1,40 @@
+#ifndef _TEST_TEMP_FILE_HPP_
+#define _TEST_TEMP_FILE_HPP_
+
+// STL
+#include <string>
+#include <sstream>		// std::stringstream
+#include <cstdlib>		// std::getenv
+
+// Boost
+#include <boost/uuid/uuid.hpp>					// boost::uuids::uuid
+#include <boost/uuid/uuid_generators.hpp>		// boost::uuids::random_generator
+#include <boost/uuid/uuid_io.hpp>				// operator<<
+
+/** @brief		Unique file path in the temporary directory for the files written by the tests
+  * @details	Not boost::filesystem::unique_path, which is not linked to the test project (see test_octree_gpmap.hpp).
+  *				The caller removes the file at the end of the test.
+  */
+inline std::string tempFilePath(const std::string &strPrefix, const std::string &strExtension)
+{
+	// temporary directory
+	const char *strEnvNames[] = {"TMPDIR", "TEMP", "TMP"};
+	std::string strDirPath;
+	for(size_t i = 0; i < sizeof(strEnvNames)/sizeof(strEnvNames[0]) && strDirPath.empty(); i++)
+	{
+		const char *strDir = std::getenv(strEnvNames[i]);
+		if(strDir) strDirPath = strDir;
+	}
+#ifdef _WIN32
+	if(strDirPath.empty()) strDirPath = ".";
+#else
+	if(strDirPath.empty()) strDirPath = "/tmp";
+#endif
+
+	// unique file name
+	std::stringstream ss;
+	ss << strDirPath << "/" << strPrefix << "_" << boost::uuids::random_generator()() << strExtension;
+	return ss.str();
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef _TEST_ARENA_HPP_
+#define _TEST_ARENA_HPP_
+
+// Google Test
+#include "gtest/gtest.h"
+
+// GPMap
+#include "util/arena.hpp"
+using namespace GPMap;
+
+TEST(Arena, AllocateAndRewind)
+{
+	// small chunks so that a new chunk is added
+	Arena arena(64);
+
+	// aligned
+	float *p1 = arena.allocate<float>(3);
+	EXPECT_EQ(static_cast<size_t>(0), reinterpret_cast<size_t>(p1) % Arena::DEFAULT_ALIGNMENT);
+
+	// scope
+	const size_t used = arena.used();
+	{
+		ArenaScope scope(arena);
+		float *p2 = arena.allocate<float>(100);	// larger than a chunk
+		EXPECT_EQ(static_cast<size_t>(0), reinterpret_cast<size_t>(p2) % Arena::DEFAULT_ALIGNMENT);
+		EXPECT_GT(arena.used(), used);
+	}
+	EXPECT_EQ(used, arena.used());
+
+	// the chunks are kept
+	const size_t capacity = arena.capacity();
+	arena.reset();
+	EXPECT_EQ(static_cast<size_t>(0), arena.used());
+	arena.allocate<float>(100);
+	EXPECT_EQ(capacity, arena.capacity());
+	EXPECT_GE(arena.highWaterMark(), 100*sizeof(float));
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef _TEST_ASYNC_LOGGER_HPP_
+#define _TEST_ASYNC_LOGGER_HPP_
+
+// STL
+#include <string>
+#include <fstream>
+#include <cstdio>		// std::remove
+
+// Boost
+#include <boost/thread/thread.hpp>		// boost::thread
+#include <boost/bind.hpp>					// boost::bind
+
+// Google Test
+#include "gtest/gtest.h"
+
+// GPMap
+#include "util/async_logger.hpp"
+#include "util/temp_file.hpp"		// tempFilePath
+using namespace GPMap;
+
+void logMessages(const int id, const int n)
+{
+	for(int i = 0; i < n; i++) GPMAP_LOG_INFO("thread " << id << " message " << i);
+}
+
+TEST(AsyncLogger, MultipleThreads)
+{
+	// log from three threads
+	const std::string strFilePath(tempFilePath("async_logger_test", ".log"));
+	ASSERT_TRUE(AsyncLogger::open(strFilePath));
+	AsyncLogger::setLevel(LOG_INFO);
+	boost::thread thread1(boost::bind(logMessages, 1, 100));
+	boost::thread thread2(boost::bind(logMessages, 2, 100));
+	logMessages(0, 100);
+	thread1.join();
+	thread2.join();
+	GPMAP_LOG(LOG_DEBUG, "filtered at run time");
+	AsyncLogger::close();
+
+	// all records are written as whole lines
+	std::ifstream fin(strFilePath.c_str());
+	std::string line;
+	int numLines(0);
+	while(std::getline(fin, line))
+	{
+		EXPECT_NE(std::string::npos, line.find("[INFO] thread "));
+		numLines++;
+	}
+	EXPECT_EQ(300, numLines);
+	EXPECT_EQ(0, AsyncLogger::numDropped());
+	fin.close();
+	std::remove(strFilePath.c_str());
+}
+
+TEST(AsyncLogger, LogRateLimiter)
+{
+	// at most 3 records pass in a second
+	LogRateLimiter limiter(3);
+	size_t numSuppressed(0);
+	int numPassed(0);
+	for(int i = 0; i < 10; i++)
+		if(limiter.allow(numSuppressed)) numPassed++;
+	EXPECT_GE(numPassed, 3);
+	EXPECT_LE(numPassed, 6);	// the window may change once during the loop
+}
+
+void logRateLimited(const int id, const int n)
+{
+	for(int i = 0; i < n; i++) GPMAP_LOG_RATE_LIMITED(LOG_INFO, 5, "thread " << id << " message " << i);
+}
+
+TEST(AsyncLogger, RateLimitedMultipleThreads)
+{
+	// threads reach the call site for the first time at once
+	const std::string strFilePath(tempFilePath("async_logger_test", ".log"));
+	ASSERT_TRUE(AsyncLogger::open(strFilePath));
+	AsyncLogger::setLevel(LOG_INFO);
+	boost::thread thread1(boost::bind(logRateLimited, 1, 100));
+	boost::thread thread2(boost::bind(logRateLimited, 2, 100));
+	logRateLimited(0, 100);
+	thread1.join();
+	thread2.join();
+	AsyncLogger::close();
+
+	// one limiter is shared by the threads
+	std::ifstream fin(strFilePath.c_str());
+	std::string line;
+	int numLines(0);
+	while(std::getline(fin, line)) numLines++;
+	EXPECT_GE(numLines, 5);
+	EXPECT_LE(numLines, 10);	// the window may change once during the loop
+	fin.close();
+	std::remove(strFilePath.c_str());
+}
+
+#endif
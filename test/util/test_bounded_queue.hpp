@@ -0,0 +1,46 @@
+#ifndef _TEST_BOUNDED_QUEUE_HPP_
+#define _TEST_BOUNDED_QUEUE_HPP_
+
+// STL
+#include <vector>
+
+// Boost
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+// Google Test
+#include "gtest/gtest.h"
+
+// GPMap
+#include "util/bounded_queue.hpp"
+using namespace GPMap;
+
+/** @brief Push 0, 1, ..., n-1 and close */
+inline void produceIntegers(BoundedQueue<int> *pQueue, const int n)
+{
+	for(int i = 0; i < n; i++) pQueue->push(i);
+	pQueue->close();
+}
+
+TEST(BoundedQueue, ProducerConsumer)
+{
+	// small capacity so that the producer blocks
+	BoundedQueue<int> queue(2);
+	EXPECT_EQ(static_cast<size_t>(2), queue.capacity());
+
+	// producer
+	const int N = 1000;
+	boost::thread producer(boost::bind(&produceIntegers, &queue, N));
+
+	// consumer: in order and drained after closing
+	int item, expected(0);
+	while(queue.pop(item)) EXPECT_EQ(expected++, item);
+	EXPECT_EQ(N, expected);
+	producer.join();
+
+	// closed
+	EXPECT_FALSE(queue.push(0));
+	EXPECT_FALSE(queue.pop(item));
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef _TEST_CONFIG_HPP_
+#define _TEST_CONFIG_HPP_
+
+// STL
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>		// std::remove
+
+// Google Test
+#include "gtest/gtest.h"
+
+// GPMap
+#include "util/config.hpp"
+using namespace GPMap;
+
+TEST(Config, FileAndArguments)
+{
+	// config file
+	const std::string strFilePath("test_config.cfg");
+	{
+		std::ofstream fout(strFilePath.c_str());
+		fout << "# comment" << std::endl;
+		fout << "block_size = 0.01, 0.02   # list" << std::endl;
+		fout << "num_cells_per_axis = 10" << std::endl;
+		fout << "bcm_mode = iBCM, BCM" << std::endl;
+	}
+
+	// the later arguments override the file
+	std::string strArg0("main"), strArg1("config=" + strFilePath), strArg2("--num_cells_per_axis=5"), strArg3("interactive=false");
+	char *argv[] = {&strArg0[0], &strArg1[0], &strArg2[0], &strArg3[0]};
+	Config config;
+	config.parse(4, argv);
+
+	// values
+	size_t numCellsPerAxis(0);
+	EXPECT_TRUE(config.get("num_cells_per_axis", numCellsPerAxis));
+	EXPECT_EQ(static_cast<size_t>(5), numCellsPerAxis);
+	EXPECT_FALSE(config.isInteractive());
+	EXPECT_FALSE(config.has("gap"));
+
+	// lists
+	std::vector<double> blockSizeList;
+	EXPECT_TRUE(config.getList("block_size", blockSizeList));
+	ASSERT_EQ(static_cast<size_t>(2), blockSizeList.size());
+	EXPECT_DOUBLE_EQ(0.02, blockSizeList[1]);
+	std::vector<std::string> bcmModeList;
+	EXPECT_TRUE(config.getList("bcm_mode", bcmModeList));
+	ASSERT_EQ(static_cast<size_t>(2), bcmModeList.size());
+	EXPECT_EQ("BCM", bcmModeList[1]);
+
+	// parse error
+	std::vector<int> intList;
+	EXPECT_FALSE(config.getList("bcm_mode", intList));
+
+	std::remove(strFilePath.c_str());
+}
+
+TEST(Config, AskNonInteractive)
+{
+	// the global config is not interactive
+	Config::global().set("interactive", "0");
+	Config::global().set("max_iter", "7");
+
+	// from the config or the default without asking
+	EXPECT_EQ(7,	ask<int>("max_iter",		"Max iterations? ",		50));
+	EXPECT_EQ(3,	ask<int>("num_blocks",	"Number of blocks? ",	3));
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef _TEST_RANDOM_HPP_
+#define _TEST_RANDOM_HPP_
+
+// STL
+#include <vector>
+#include <algorithm>
+
+// Google Test
+#include "gtest/gtest.h"
+
+// GPMap
+#include "util/random.hpp"
+using namespace GPMap;
+
+TEST(Random, RandomGenerator)
+{
+	// the same seed gives the same sequence
+	RandomGenerator rng1(123), rng2(123), rng3(124);
+	bool fDifferent(false);
+	for(int i = 0; i < 100; i++)
+	{
+		const boost::uint64_t r1 = rng1();
+		EXPECT_EQ(r1, rng2());
+		if(r1 != rng3()) fDifferent = true;
+	}
+	EXPECT_TRUE(fDifferent);
+
+	// uniform integers in [0, n)
+	std::vector<int> counts(10, 0);
+	for(int i = 0; i < 10000; i++)
+	{
+		const size_t r = rng1.uniform(10);
+		ASSERT_LT(r, 10);
+		counts[r]++;
+	}
+	for(int i = 0; i < 10; i++) EXPECT_GT(counts[i], 800);
+
+	// uniform real numbers in [0, 1)
+	for(int i = 0; i < 1000; i++)
+	{
+		const double r = rng1.uniform01();
+		EXPECT_GE(r, 0.0);
+		EXPECT_LT(r, 1.0);
+	}
+}
+
+TEST(Random, RandomStreams)
+{
+	// streams depend only on (seed, key, call site)
+	RandomStreams streams(42);
+	RandomGenerator a1 = streams.stream(7, RANDOM_STREAM_PREDICTION_PARTITION);
+	RandomGenerator b  = streams.stream(8, RANDOM_STREAM_PREDICTION_PARTITION);
+	RandomGenerator c  = streams.stream(7, RANDOM_STREAM_TRAINING_PARTITION);
+	RandomGenerator a2 = streams.stream(7, RANDOM_STREAM_PREDICTION_PARTITION);
+	const boost::uint64_t r = a1();
+	EXPECT_EQ(r, a2());
+	EXPECT_NE(r, b());
+	EXPECT_NE(r, c());
+
+	// neighboring blocks at neighboring call sites
+	EXPECT_NE(streams.stream(7, RANDOM_STREAM_TRAINING_PARTITION)(),
+				 streams.stream(8, RANDOM_STREAM_BLOCK_SAMPLING)());
+	EXPECT_NE(streams.stream(7, RANDOM_STREAM_PREDICTION_PARTITION)(),
+				 streams.stream(8, RANDOM_STREAM_TRAINING_PARTITION)());
+
+	// different seeds
+	RandomStreams otherStreams(43);
+	EXPECT_NE(r, otherStreams.stream(7, RANDOM_STREAM_PREDICTION_PARTITION)());
+
+	// the same stream gives the same shuffle
+	std::vector<int> v1(20), v2(20);
+	for(int i = 0; i < 20; i++) v1[i] = v2[i] = i;
+	RandomGenerator s1 = streams.stream(1, RANDOM_STREAM_BLOCK_SAMPLING);
+	RandomGenerator s2 = streams.stream(1, RANDOM_STREAM_BLOCK_SAMPLING);
+	fisher_yates_shuffle(v1.begin(), v1.end(), s1);
+	fisher_yates_shuffle(v2.begin(), v2.end(), s2);
+	EXPECT_TRUE(v1 == v2);
+
+	// it is a permutation
+	std::sort(v1.begin(), v1.end());
+	for(int i = 0; i < 20; i++) EXPECT_EQ(i, v1[i]);
+}
+
+TEST(Random, FloydSampling)
+{
+	RandomGenerator rng(7);
+	std::vector<int> indices;
+
+	// all
+	floyd_sampling(10, 20, rng, indices);
+	ASSERT_EQ(10, indices.size());
+	for(int i = 0; i < 10; i++) EXPECT_EQ(i, indices[i]);
+
+	// m out of n: sorted unique indices in [0, n) with uniform frequencies
+	std::vector<int> counts(20, 0);
+	for(int trial = 0; trial < 10000; trial++)
+	{
+		floyd_sampling(20, 5, rng, indices);
+		ASSERT_EQ(5, indices.size());
+		for(size_t i = 0; i < indices.size(); i++)
+		{
+			ASSERT_GE(indices[i], 0);
+			ASSERT_LT(indices[i], 20);
+			if(i > 0) { ASSERT_LT(indices[i-1], indices[i]); }
+			counts[indices[i]]++;
+		}
+	}
+	for(int i = 0; i < 20; i++) EXPECT_GT(counts[i], 2200);
+}
+
+#endif
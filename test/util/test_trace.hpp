@@ -0,0 +1,71 @@
+#ifndef _TEST_TRACE_HPP_
+#define _TEST_TRACE_HPP_
+
+// STL
+#include <string>
+#include <fstream>
+#include <iterator>		// std::istreambuf_iterator
+#include <cstdio>			// std::remove
+
+// Google Test
+#include "gtest/gtest.h"
+
+// GPMap
+#include "util/trace.hpp"
+#include "util/temp_file.hpp"		// tempFilePath
+using namespace GPMap;
+
+TEST(Trace, TraceBuffer)
+{
+	// ring buffer with the capacity of 3
+	TraceBuffer buffer(3, 0);
+	TraceEvent event = {"zone", 0, 0, 0, 0};
+	for(int i = 0; i < 5; i++)
+	{
+		event.argValue = i;
+		buffer.push(event);
+	}
+
+	// the oldest two are overwritten
+	EXPECT_EQ(3, buffer.size());
+	EXPECT_EQ(2, buffer.numDropped());
+	EXPECT_EQ(2, buffer[0].argValue);
+	EXPECT_EQ(3, buffer[1].argValue);
+	EXPECT_EQ(4, buffer[2].argValue);
+
+	// clear
+	buffer.clear();
+	EXPECT_EQ(0, buffer.size());
+}
+
+TEST(Trace, TraceZone)
+{
+	// nested zones
+	Tracer::enable();
+	Tracer::clear();
+	{
+		TraceZone outer("outer", "n", 7);
+		{
+			TraceZone inner("inner");
+		}
+	}
+	Tracer::enable(false);
+	{
+		TraceZone ignored("ignored");
+	}
+
+	// the inner zone is completed first and lies in the outer zone
+	const std::string strFilePath(tempFilePath("trace_test", ".json"));
+	EXPECT_EQ(2, Tracer::saveAsChromeTrace(strFilePath));
+	std::ifstream fin(strFilePath.c_str());
+	const std::string strTrace((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+	EXPECT_NE(std::string::npos, strTrace.find("\"name\": \"inner\""));
+	EXPECT_NE(std::string::npos, strTrace.find("\"args\": {\"n\": 7}"));
+	EXPECT_EQ(std::string::npos, strTrace.find("ignored"));
+	EXPECT_LT(strTrace.find("inner"), strTrace.find("outer"));
+	Tracer::clear();
+	fin.close();
+	std::remove(strFilePath.c_str());
+}
+
+#endif